@@ -5,6 +5,8 @@
 #include "Engine/SkeletalMeshSocket.h"
 #include "Engine/StaticMesh.h"
 #include "Engine/Texture2D.h"
+#include "Engine/Texture2DArray.h"
+#include "VatiDefines.h"
 
 int32 UMyAnimToTextureDataAsset::GetIndexFromAnimSequence(const UAnimSequence* Sequence)
 {
@@ -28,7 +30,7 @@ bool UMyAnimToTextureDataAsset::DoesSocketExist(FName InSocketName) const
 #if !UE_BUILD_SHIPPING
 	if (AnimSequences.Num() == 0)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("UMyAnimToTextureDataAsset on %s: Animations array is empty. Cannot check for socket %s."), *GetName(), *InSocketName.ToString());
+		UE_LOG(LogVATInstancing, Warning, TEXT("UMyAnimToTextureDataAsset on %s: Animations array is empty. Cannot check for socket %s."), *GetName(), *InSocketName.ToString());
 		return false;
 	}
 #endif
@@ -85,62 +87,419 @@ void UMyAnimToTextureDataAsset::QuerySupportedSockets(TArray<FComponentSocketDes
 
 }
 
-bool UMyAnimToTextureDataAsset::GetSocketTransform(FName InSocketName, int32 AnimIndex, float AnimTime, FTransform& Out) const
+// Components other than the largest one are within [-1/sqrt(2), 1/sqrt(2)]
+static constexpr float SmallestThreeSteps = 32767.f;
+
+static void PackQuaternion(const FQuat4f& InRotation, uint16* Out)
 {
-	check(AnimSequences.IsValidIndex(AnimIndex));
+	const FQuat4f Rotation = InRotation.GetNormalized();
+	const float Components[4] = { Rotation.X, Rotation.Y, Rotation.Z, Rotation.W };
 
-	int32 j = BoneOrSocketsOfInterestForAllAnimSequences.Find(InSocketName);
+	int32 Largest = 0;
+	for (int32 Index = 1; Index < 4; ++Index)
+	{
+		if (FMath::Abs(Components[Index]) > FMath::Abs(Components[Largest]))
+		{
+			Largest = Index;
+		}
+	}
 
-	if (INDEX_NONE == j)
+	// q与-q是同一个旋转，保证被丢弃的分量为正
+	const float Sign = Components[Largest] < 0.f ? -1.f : 1.f;
+
+	int32 Packed = 0;
+	for (int32 Index = 0; Index < 4; ++Index)
+	{
+		if (Index != Largest)
+		{
+			const float Normalized = Components[Index] * Sign * UE_SQRT_2 * 0.5f + 0.5f;
+			Out[Packed++] = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(Normalized * SmallestThreeSteps), 0, static_cast<int32>(SmallestThreeSteps)));
+		}
+	}
+	Out[0] |= static_cast<uint16>((Largest & 1) << 15);
+	Out[1] |= static_cast<uint16>((Largest >> 1) << 15);
+}
+
+static FQuat UnpackQuaternion(const uint16* In)
+{
+	const int32 Largest = (In[0] >> 15) | ((In[1] >> 15) << 1);
+
+	float Components[4];
+	float SumSquared = 0.f;
+	int32 Packed = 0;
+	for (int32 Index = 0; Index < 4; ++Index)
+	{
+		if (Index != Largest)
+		{
+			const float Normalized = (In[Packed++] & 0x7FFF) / SmallestThreeSteps;
+			Components[Index] = (Normalized * 2.f - 1.f) * UE_INV_SQRT_2;
+			SumSquared += Components[Index] * Components[Index];
+		}
+	}
+	Components[Largest] = FMath::Sqrt(FMath::Max(1.f - SumSquared, 0.f));
+
+	return FQuat(FQuat4f(Components[0], Components[1], Components[2], Components[3]).GetNormalized());
+}
+
+void FAnim2TextureAnimSequenceInfo::PackSocketTransforms(const TArray<FTransform>& Transforms, int32 NumTracks, int32 FrameStep)
+{
+	SocketTrackMins.Reset();
+	SocketTrackSizes.Reset();
+	PackedSocketTransforms.Reset();
+	SocketFrameStep = FMath::Max(FrameStep, 1);
+
+	if (NumTracks <= 0 || Transforms.IsEmpty())
+	{
+		return;
+	}
+	check(Transforms.Num() % NumTracks == 0);
+
+	// 每SocketFrameStep帧一个关键帧，最后一帧总是关键帧
+	const int32 NumFrames = Transforms.Num() / NumTracks;
+	const int32 NumKeys = (NumFrames - 1 + SocketFrameStep - 1) / SocketFrameStep + 1;
+	auto GetKeyTransform = [&](int32 Key, int32 Track) -> const FTransform&
+	{
+		return Transforms[FMath::Min(Key * SocketFrameStep, NumFrames - 1) * NumTracks + Track];
+	};
+
+	// 每条轨道在所有关键帧上的位置范围
+	TArray<FVector3f> TrackMaxs;
+	SocketTrackMins.Init(FVector3f(TNumericLimits<float>::Max()), NumTracks);
+	TrackMaxs.Init(FVector3f(TNumericLimits<float>::Lowest()), NumTracks);
+	for (int32 Key = 0; Key < NumKeys; ++Key)
+	{
+		for (int32 Track = 0; Track < NumTracks; ++Track)
+		{
+			const FVector3f Position(GetKeyTransform(Key, Track).GetLocation());
+			SocketTrackMins[Track] = SocketTrackMins[Track].ComponentMin(Position);
+			TrackMaxs[Track] = TrackMaxs[Track].ComponentMax(Position);
+		}
+	}
+
+	SocketTrackSizes.SetNumUninitialized(NumTracks);
+	for (int32 Track = 0; Track < NumTracks; ++Track)
 	{
-		j = AnimSequences[AnimIndex].BoneOrSocketsOfInterest.Find(InSocketName);
-		if (INDEX_NONE == j)
+		SocketTrackSizes[Track] = TrackMaxs[Track] - SocketTrackMins[Track];
+	}
+
+	PackedSocketTransforms.SetNumUninitialized(NumKeys * NumTracks * PackedSocketTransformStride);
+	for (int32 Key = 0; Key < NumKeys; ++Key)
+	{
+		for (int32 Track = 0; Track < NumTracks; ++Track)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("UMyAnimToTextureDataAsset on %s: Socket %s not found in AnimSequence %s."), *GetName(), *InSocketName.ToString(), *AnimSequences[AnimIndex].AnimSequence->GetName());
-			return false;
+			const FTransform& Transform = GetKeyTransform(Key, Track);
+			const FVector3f Position(Transform.GetLocation());
+			uint16* Packed = &PackedSocketTransforms[(Key * NumTracks + Track) * PackedSocketTransformStride];
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				const float Size = SocketTrackSizes[Track][Axis];
+				const float Normalized = Size > 0.f ? (Position[Axis] - SocketTrackMins[Track][Axis]) / Size : 0.f;
+				Packed[Axis] = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(Normalized * MAX_uint16), 0, static_cast<int32>(MAX_uint16)));
+			}
+			PackQuaternion(FQuat4f(Transform.GetRotation()), Packed + 3);
 		}
-		j += BoneOrSocketsOfInterestForAllAnimSequences.Num();
+	}
+}
+
+FTransform FAnim2TextureAnimSequenceInfo::UnpackSocketTransform(int32 Key, int32 Track) const
+{
+	const uint16* Packed = &PackedSocketTransforms[(Key * SocketTrackMins.Num() + Track) * PackedSocketTransformStride];
+	const FVector3f Position = SocketTrackMins[Track] + SocketTrackSizes[Track] * FVector3f(Packed[0], Packed[1], Packed[2]) / MAX_uint16;
+	return FTransform(UnpackQuaternion(Packed + 3), FVector(Position));
+}
+
+FTransform FAnim2TextureAnimSequenceInfo::SampleSocketTransform(float Frame, int32 LastFrame, int32 Track) const
+{
+	const int32 LastKey = GetNumSocketKeys() - 1;
+	check(LastKey >= 0);
+
+	const float Key = FMath::Clamp(Frame / SocketFrameStep, 0.f, static_cast<float>(LastKey));
+	const int32 KeyA = FMath::Min(FMath::FloorToInt(Key), LastKey);
+	const int32 KeyB = FMath::Min(KeyA + 1, LastKey);
+	const FTransform A = UnpackSocketTransform(KeyA, Track);
+	if (KeyA == KeyB)
+	{
+		return A;
+	}
+
+	// 最后一个关键帧(LastFrame)可能离前一个不足SocketFrameStep帧
+	const int32 FrameA = KeyA * SocketFrameStep;
+	const int32 FrameB = FMath::Max(FMath::Min(KeyB * SocketFrameStep, LastFrame), FrameA + 1);
+	const float Alpha = FMath::Clamp((Frame - FrameA) / (FrameB - FrameA), 0.f, 1.f);
+
+	const FTransform B = UnpackSocketTransform(KeyB, Track);
+	return FTransform(FQuat::Slerp(A.GetRotation(), B.GetRotation(), Alpha), FMath::Lerp(A.GetLocation(), B.GetLocation(), Alpha));
+}
+
+int32 UMyAnimToTextureDataAsset::FindSocketTrack(FName InSocketName, int32 AnimIndex) const
+{
+	const int32 Track = BoneOrSocketsOfInterestForAllAnimSequences.Find(InSocketName);
+	if (INDEX_NONE != Track)
+	{
+		return Track;
+	}
+
+	const int32 AnimTrack = AnimSequences[AnimIndex].BoneOrSocketsOfInterest.Find(InSocketName);
+	return INDEX_NONE == AnimTrack ? INDEX_NONE : AnimTrack + BoneOrSocketsOfInterestForAllAnimSequences.Num();
+}
+
+bool UMyAnimToTextureDataAsset::GetSocketTransform(FName InSocketName, int32 AnimIndex, float AnimTime, FTransform& Out) const
+{
+	check(AnimSequences.IsValidIndex(AnimIndex));
+
+	const int32 j = FindSocketTrack(InSocketName, AnimIndex);
+	if (INDEX_NONE == j)
+	{
+		UE_LOG(LogVATInstancing, Warning, TEXT("UMyAnimToTextureDataAsset on %s: Socket %s not found in AnimSequence %s."), *GetName(), *InSocketName.ToString(), *AnimSequences[AnimIndex].AnimSequence->GetName());
+		return false;
 	}
 
-	auto& CachedTransform = AnimSequences[AnimIndex].BoneComponentSpaceTransforms;
+	const FAnim2TextureAnimSequenceInfo& SequenceInfo = AnimSequences[AnimIndex];
+	if (j >= SequenceInfo.GetNumSocketTracks())
+	{
+		UE_LOG(LogVATInstancing, Warning, TEXT("UMyAnimToTextureDataAsset on %s: Socket %s was not baked, rebake the DataAsset."), *GetName(), *InSocketName.ToString());
+		return false;
+	}
+
+	// 总是在关键帧间插值: 关键帧可以比贴图稀疏，且Socket不会在帧边界跳变
 	const int32 AnimLength = Animations[AnimIndex].EndFrame - Animations[AnimIndex].StartFrame;
-	const int32 FrameIndex = FMath::Clamp(FMath::RoundHalfToZero(AnimTime * SampleRate), 0, AnimLength);
+	const float Frame = FMath::Clamp(AnimTime * GetAnimSampleRate(Animations[AnimIndex]), 0.f, static_cast<float>(AnimLength));
+
+	const FTransform Transform = SequenceInfo.SampleSocketTransform(Frame, AnimLength, j);
+	Out.SetLocation(Transform.GetLocation());
+	Out.SetRotation(Transform.GetRotation());
+	return true;
+}
+
+FVATSocketHandle UMyAnimToTextureDataAsset::ResolveSocket(FName InSocketName) const
+{
+	FVATSocketHandle Socket;
+	Socket.SocketName = InSocketName;
+	Socket.DataAsset = this;
+	Socket.AnimTracks.SetNumUninitialized(AnimSequences.Num());
+	for (int32 AnimIndex = 0; AnimIndex < AnimSequences.Num(); ++AnimIndex)
+	{
+		const int32 Track = FindSocketTrack(InSocketName, AnimIndex);
+		Socket.AnimTracks[AnimIndex] = Track < AnimSequences[AnimIndex].GetNumSocketTracks() ? Track : INDEX_NONE;
+	}
+	return Socket;
+}
 
-	const int32 TotalNum = AnimSequences[AnimIndex].BoneOrSocketsOfInterest.Num() + BoneOrSocketsOfInterestForAllAnimSequences.Num();
-	const int32 FrameOffset = FrameIndex * TotalNum;
+bool UMyAnimToTextureDataAsset::GetSocketTransform(const FVATSocketHandle& Socket, int32 AnimIndex, float AnimTime, FTransform& Out) const
+{
+	if (Socket.DataAsset.Get() != this || !Socket.AnimTracks.IsValidIndex(AnimIndex) || Socket.AnimTracks[AnimIndex] == INDEX_NONE)
+	{
+		return false;
+	}
 
+	const FAnim2TextureAnimInfo& AnimInfo = Animations[AnimIndex];
+	const int32 AnimLength = AnimInfo.EndFrame - AnimInfo.StartFrame;
+	const float Frame = FMath::Clamp(AnimTime * GetAnimSampleRate(AnimInfo), 0.f, static_cast<float>(AnimLength));
 
-	const auto& [Location, Rotation] = CachedTransform[FrameOffset + j];
-	Out.SetLocation(Location);
-	Out.SetRotation(Rotation);
+	const FTransform Transform = AnimSequences[AnimIndex].SampleSocketTransform(Frame, AnimLength, Socket.AnimTracks[AnimIndex]);
+	Out.SetLocation(Transform.GetLocation());
+	Out.SetRotation(Transform.GetRotation());
 	return true;
 }
 
+float UMyAnimToTextureDataAsset::GetTextureFrame(const FAnim2TextureAnimInfo& AnimInfo, float AnimTime) const
+{
+	const float StartFrameOfAnim = static_cast<float>(AnimInfo.StartFrame);
+	const float FrameInCurrentAnimSegment = AnimTime * GetAnimSampleRate(AnimInfo);
+
+	if (!bInterpolateFrames)
+	{
+		const float TotalAnimDurationInFrames = static_cast<float>(AnimInfo.EndFrame - AnimInfo.StartFrame + 1);
+
+		//由于贴图采样用nearest，浮点误差容易导致采到上一帧
+		float AbsoluteFrame = FMath::Clamp(StartFrameOfAnim + FrameInCurrentAnimSegment + 1e-2f, StartFrameOfAnim, StartFrameOfAnim + TotalAnimDurationInFrames - 1e-2f);
+
+		// 去重后的贴图中，帧需要先映射到实际储存的位置
+		if (FrameRemap.Num())
+		{
+			const int32 Frame = FMath::FloorToInt(AbsoluteFrame);
+			AbsoluteFrame += GetStoredFrame(Frame) - Frame;
+		}
+		return AbsoluteFrame + AnimInfo.TextureFrameOffset;
+	}
+
+	// 小数部分是与下一帧的混合权重，最后一帧不再向后混合(下一行属于别的动画或RefPose)
+	const float AbsoluteFrame = FMath::Clamp(StartFrameOfAnim + FrameInCurrentAnimSegment, StartFrameOfAnim, static_cast<float>(AnimInfo.EndFrame));
+	if (!FrameRemap.Num())
+	{
+		return AbsoluteFrame + AnimInfo.TextureFrameOffset;
+	}
+
+	// 去重后下一帧不一定储存在下一行: 相同则不需要混合，不相邻则退化为取最近的一帧
+	const int32 FrameA = FMath::FloorToInt(AbsoluteFrame);
+	float Alpha = AbsoluteFrame - FrameA;
+	int32 StoredFrameA = GetStoredFrame(FrameA);
+	if (Alpha > 0.f)
+	{
+		const int32 StoredFrameB = GetStoredFrame(FrameA + 1);
+		if (StoredFrameB != StoredFrameA + 1)
+		{
+			StoredFrameA = Alpha < 0.5f ? StoredFrameA : StoredFrameB;
+			Alpha = 0.f;
+		}
+	}
+	return StoredFrameA + Alpha;
+}
+
+FBox UMyAnimToTextureDataAsset::GetAnimationBounds(const FAnim2TextureAnimInfo& AnimInfo, float AnimTime) const
+{
+	const int32 NumRanges = AnimInfo.FrameRangeBounds.Num();
+	if (!AnimInfo.Bounds.IsValid || !NumRanges || BoundsFramesPerRange <= 0)
+	{
+		return FBox(AnimInfo.Bounds);
+	}
+
+	const float Frame = FMath::Clamp(AnimTime * GetAnimSampleRate(AnimInfo), 0.f, static_cast<float>(AnimInfo.EndFrame - AnimInfo.StartFrame));
+	const int32 RangeA = FMath::Min(FMath::FloorToInt(Frame) / BoundsFramesPerRange, NumRanges - 1);
+	const int32 RangeB = FMath::Min(FMath::CeilToInt(Frame) / BoundsFramesPerRange, NumRanges - 1);
+
+	FBox3f Bounds = AnimInfo.FrameRangeBounds[RangeA];
+	if (RangeB != RangeA)
+	{
+		Bounds += AnimInfo.FrameRangeBounds[RangeB];
+	}
+	return FBox(Bounds);
+}
+
+FTransform UMyAnimToTextureDataAsset::GetRootMotionTransform(const FAnim2TextureAnimInfo& AnimInfo, float AnimTime) const
+{
+	const int32 NumKeys = AnimInfo.RootMotion.Num();
+	if (!NumKeys)
+	{
+		return FTransform::Identity;
+	}
+
+	// 根运动总是在相邻两帧之间插值，与bInterpolateFrames无关
+	const float Frame = FMath::Clamp(AnimTime * GetAnimSampleRate(AnimInfo), 0.f, static_cast<float>(NumKeys - 1));
+	const int32 KeyA = FMath::FloorToInt(Frame);
+	const int32 KeyB = FMath::Min(KeyA + 1, NumKeys - 1);
+	const FVector4f Key = FMath::Lerp(AnimInfo.RootMotion[KeyA], AnimInfo.RootMotion[KeyB], Frame - KeyA);
+
+	return FTransform(FRotator(0.f, Key.W, 0.f), FVector(Key.X, Key.Y, Key.Z));
+}
+
+FTransform UMyAnimToTextureDataAsset::ExtractRootMotion(const FAnim2TextureAnimInfo& AnimInfo, float StartTime, float EndTime) const
+{
+	if (AnimInfo.RootMotion.IsEmpty())
+	{
+		return FTransform::Identity;
+	}
+	return GetRootMotionTransform(AnimInfo, EndTime).GetRelativeTransform(GetRootMotionTransform(AnimInfo, StartTime));
+}
+
+bool UMyAnimToTextureDataAsset::IsStreamingTexturePages() const
+{
+	return bStreamTexturePages && NumTextureSlices > 0
+		&& BonePositionTexturePages.Num() == NumTextureSlices && BoneRotationTexturePages.Num() == NumTextureSlices;
+}
+
+int32 UMyAnimToTextureDataAsset::GetFallbackTexturePage() const
+{
+	return Animations.IsValidIndex(StreamingFallbackAnimIndex) ? Animations[StreamingFallbackAnimIndex].TextureSlice : 0;
+}
+
+float UMyAnimToTextureDataAsset::GetFallbackTextureFrame() const
+{
+	if (Animations.IsValidIndex(StreamingFallbackAnimIndex))
+	{
+		return GetTextureFrame(Animations[StreamingFallbackAnimIndex], 0.f);
+	}
+
+	// 每个Slice都有自己的RefPose
+	return GetNumStoredFrames() + (bInterpolateFrames ? 0.f : 1e-2f);
+}
+
 void UMyAnimToTextureDataAsset::ResetInfo()
 {
 	// Common Info.
 	NumFrames = 0;
+	BakeGuid.Invalidate();
+	AnimationLibraryBakeGuid.Invalidate();
+	NumUniqueFrames = 0;
+	FrameRemap.Reset();
+	NumTextureSlices = 0;
+	NumSliceFrames = 0;
+	NumLookupFrames = 0;
 	Animations.Reset();
+	BonePositionTexturePages.Reset();
+	BoneRotationTexturePages.Reset();
 
 	// Vertex Info
 	VertexRowsPerFrame = 1;
 	VertexMinBBox = FVector3f::ZeroVector;
 	VertexSizeBBox = FVector3f::ZeroVector;
+	NumVertexBasis = 0;
 
 	// Bone Info
 	NumBones = 0;
+	BakedBones.Reset();
 	BoneRowsPerFrame = 1;
 	BoneWeightRowsPerFrame = 1;
 	BoneMinBBox = FVector3f::ZeroVector;
 	BoneSizeBBox = FVector3f::ZeroVector;
+	BoneDualQuaternionScale = 0.f;
+	NumMorphVertices = 0;
+	MorphRowsPerFrame = 1;
+
+#if WITH_EDITORONLY_DATA
+	// Bake Report
+	BakePeakMemoryMB = 0.f;
+	MaxRotationErrorDegrees = 0.f;
+	MaxPositionError = 0.f;
+	RMSPositionError = 0.f;
+	AnimationErrors.Reset();
+	BoneErrors.Reset();
+	VertexErrors.Reset();
+	BoneRangeBounds.Reset();
+	BakedLODNumVertices.Reset();
+#endif
 
 	// Cached Anim Transform
 	for (FAnim2TextureAnimSequenceInfo& AnimSequence : AnimSequences)
 	{
-		AnimSequence.BoneComponentSpaceTransforms.Reset();
+		AnimSequence.SocketTrackMins.Reset();
+		AnimSequence.SocketTrackSizes.Reset();
+		AnimSequence.PackedSocketTransforms.Reset();
+		AnimSequence.BoneComponentSpaceTransforms_DEPRECATED.Reset();
 	}
 };
 
+void UMyAnimToTextureDataAsset::PostLoad()
+{
+	Super::PostLoad();
+
+	// 旧资产的Transform未量化，加载时转换
+	for (FAnim2TextureAnimSequenceInfo& AnimSequence : AnimSequences)
+	{
+		if (AnimSequence.BoneComponentSpaceTransforms_DEPRECATED.IsEmpty())
+		{
+			continue;
+		}
+
+		const int32 NumTracks = BoneOrSocketsOfInterestForAllAnimSequences.Num() + AnimSequence.BoneOrSocketsOfInterest.Num();
+		if (NumTracks > 0 && AnimSequence.BoneComponentSpaceTransforms_DEPRECATED.Num() % NumTracks == 0)
+		{
+			TArray<FTransform> Transforms;
+			Transforms.Reserve(AnimSequence.BoneComponentSpaceTransforms_DEPRECATED.Num());
+			for (const FVtxAnimComponentSpaceTransform& Transform : AnimSequence.BoneComponentSpaceTransforms_DEPRECATED)
+			{
+				Transforms.Add(FTransform(Transform.Rotation, Transform.Location));
+			}
+			AnimSequence.PackSocketTransforms(Transforms, NumTracks);
+		}
+		else
+		{
+			UE_LOG(LogVATInstancing, Warning, TEXT("UMyAnimToTextureDataAsset on %s: BoneOrSocketsOfInterest changed since the last bake, rebake the DataAsset."), *GetName());
+		}
+		AnimSequence.BoneComponentSpaceTransforms_DEPRECATED.Empty();
+	}
+}
+
 // If we weren't in a plugin, we could unify this in a base class
 template<typename AssetType>
 static AssetType* GetAsset(const TSoftObjectPtr<AssetType>& AssetPointer)
@@ -181,12 +540,49 @@ UTexture2D* UMyAnimToTextureDataAsset::GetVertexNormalTexture() const
 	return GetAsset(VertexNormalTexture);
 }
 
+UTexture2D* UMyAnimToTextureDataAsset::GetVertexCoefficientTexture() const
+{
+	return GetAsset(VertexCoefficientTexture);
+}
+
 UTexture2D* UMyAnimToTextureDataAsset::GetBonePositionTexture() const
 {
 	return GetAsset(BonePositionTexture);
 }
 
+UTexture2D* UMyAnimToTextureDataAsset::GetMorphDeltaTexture() const
+{
+	return GetAsset(MorphDeltaTexture);
+}
+
 UTexture2D* UMyAnimToTextureDataAsset::GetBoneRotationTexture() const
 {
 	return GetAsset(BoneRotationTexture);
 }
+
+UMyAnimToTextureDataAsset* UMyAnimToTextureDataAsset::GetAnimationLibrary() const
+{
+	return Mode == EAnim2TextureMode::Bone ? GetAsset(AnimationLibrary) : nullptr;
+}
+
+bool UMyAnimToTextureDataAsset::IsAnimationLibraryUpToDate() const
+{
+	if (Mode != EAnim2TextureMode::Bone || AnimationLibrary.IsNull())
+	{
+		return true;
+	}
+
+	// Both invalid for assets baked before BakeGuid existed
+	const UMyAnimToTextureDataAsset* Library = GetAnimationLibrary();
+	return Library && Library->BakeGuid == AnimationLibraryBakeGuid;
+}
+
+UTexture2DArray* UMyAnimToTextureDataAsset::GetBonePositionTextureArray() const
+{
+	return GetAsset(BonePositionTextureArray);
+}
+
+UTexture2DArray* UMyAnimToTextureDataAsset::GetBoneRotationTextureArray() const
+{
+	return GetAsset(BoneRotationTextureArray);
+}
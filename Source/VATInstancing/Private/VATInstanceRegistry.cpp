@@ -48,6 +48,14 @@ namespace VATInstanceRegistry
 		}
 	}
 
+	void NotifyProxyBoundsChanged(UObject* WorldContextObject, FVATProxyId ProxyId, const FBox& NewLocalBounds)
+	{
+		if (IVATInstanceRendererInterface* Renderer = GetRendererForWorld(WorldContextObject))
+		{
+			Renderer->UpdateProxyBounds(ProxyId, NewLocalBounds);
+		}
+	}
+
 	void RegisterRenderer(UWorld* World, UObject* Renderer)
 	{
 		if (!World || !Renderer)
@@ -2,6 +2,8 @@
 #include "Components/InstancedStaticMeshComponent.h"
 #include "Engine/World.h"
 #include "MyAnimToTextureDataAsset.h"
+#include "VATInstancedStaticMeshComponent.h"
+#include "VATTexturePageStreaming.h"
 #include "VATInstanceRegistry.h"
 #include "Materials/MaterialInstanceDynamic.h"
 
@@ -110,15 +112,32 @@ void UVATInstanceRenderer::UpdateProxyBatchKey(FVATProxyId ProxyId, const FBatch
 	}
 
 	FTransform CurrentTransform = FTransform::Identity;
+	FBox CurrentBounds(ForceInit);
 	TArray<float> CurrentCustomData;
 
 	if (UInstancedStaticMeshComponent* OldIsmc = Info->Ismc.Get())
 	{
 		OldIsmc->GetInstanceTransform(Info->InstanceIndex, CurrentTransform);
+		if (const UVATInstancedStaticMeshComponent* OldVatIsmc = Cast<UVATInstancedStaticMeshComponent>(OldIsmc))
+		{
+			CurrentBounds = OldVatIsmc->GetInstanceLocalBounds(Info->InstanceIndex);
+		}
 	}
 	
 	UnregisterProxy(ProxyId);
 	RegisterProxy(ProxyId, NewBatchKey, CurrentTransform, CurrentCustomData);
+	UpdateProxyBounds(ProxyId, CurrentBounds);
+}
+
+void UVATInstanceRenderer::UpdateProxyBounds(FVATProxyId ProxyId, const FBox& NewLocalBounds)
+{
+	if (FProxyInstanceInfo* Info = InstanceInfos.Find(ProxyId))
+	{
+		if (UVATInstancedStaticMeshComponent* Ismc = Cast<UVATInstancedStaticMeshComponent>(Info->Ismc.Get()))
+		{
+			Ismc->SetInstanceLocalBounds(Info->InstanceIndex, NewLocalBounds);
+		}
+	}
 }
 
 
@@ -136,13 +155,14 @@ UInstancedStaticMeshComponent* UVATInstanceRenderer::FindOrCreateIsmcForBatch(co
 	}
 
 	// The ISMC is owned by this renderer instance.
-	UInstancedStaticMeshComponent* NewIsmc = NewObject<UInstancedStaticMeshComponent>(this);
+	UInstancedStaticMeshComponent* NewIsmc = NewObject<UVATInstancedStaticMeshComponent>(this);
 	NewIsmc->SetStaticMesh(BatchKey.VisualTypeAsset->GetStaticMesh());
 	NewIsmc->NumCustomDataFloats = BatchKey.VisualTypeAsset->NumCustomDataFloatsForVAT;
 
 	for (int32 i = 0; i < BatchKey.BaseMaterials.Num(); ++i)
 	{
-		NewIsmc->SetMaterial(i, BatchKey.BaseMaterials[i]);
+		// 流式加载页面的DataAsset需要用MID绑定常驻的TextureArray
+		NewIsmc->SetMaterial(i, VATTexturePageStreaming::GetStreamingMaterial(BatchKey.VisualTypeAsset, BatchKey.BaseMaterials[i], NewIsmc));
 	}
 	if (BatchKey.OverlayMaterial)
 	{
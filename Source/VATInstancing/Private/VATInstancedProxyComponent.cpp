@@ -3,6 +3,8 @@
 #include "Animation/AnimNotifies/AnimNotifyState.h"
 #include "Animation/AnimSequence.h"
 #include "Animation/AnimNotifyQueue.h"
+#include "Async/ParallelFor.h"
+#include "Engine/StaticMesh.h"
 #include "GameFramework/Actor.h"
 #include "Logging/LogMacros.h"
 #include "Materials/MaterialInstanceDynamic.h"
@@ -11,6 +13,7 @@
 #include "PerInstanceCustomDataLayout.h"
 #include "VATInstanceRegistry.h"
 #include "VATMaterialParameterName.h"
+#include "VATTexturePageStreaming.h"
 #include "VertexAnimationNotifyInterface.h"
 #include "VertexAnimationNotifyStateInterface.h"
 #include "VisualLogger/VisualLogger.h"
@@ -52,6 +55,14 @@ void UVATInstancedProxyComponent::RegisterWithVATSystem()
 		ensure(false);
 		return;
 	}
+
+	// Animations copied from a rebaked AnimationLibrary would index the wrong texture rows
+	if (!VisualTypeAsset->IsAnimationLibraryUpToDate())
+	{
+		UE_LOG(LogVATInstancing, Error, TEXT("AnimationLibrary %s was rebaked after %s, rebake it. %s is not rendered."),
+			*VisualTypeAsset->AnimationLibrary.ToString(), *VisualTypeAsset->GetName(), *GetPathName());
+		return;
+	}
 #endif
 
 	if (UStaticMesh* Mesh = VisualTypeAsset->GetStaticMesh())
@@ -80,6 +91,7 @@ void UVATInstancedProxyComponent::RegisterWithVATSystem()
 
 	FBatchKey BatchKey(VisualTypeAsset, CurrentBaseMaterials, CurrentOverlayMaterial);
 	VATInstanceRegistry::RegisterProxy(this, ProxyId, BatchKey, GetComponentTransform(), CurrentVATCustomData);
+	VATInstanceRegistry::NotifyProxyBoundsChanged(this, ProxyId, GetAnimatedLocalBounds());
 }
 
 void UVATInstancedProxyComponent::UnregisterFromVATSystem()
@@ -88,6 +100,7 @@ void UVATInstancedProxyComponent::UnregisterFromVATSystem()
 	{
 		VATInstanceRegistry::UnregisterProxy(this, ProxyId);
 	}
+	ReleaseTexturePageRefs();
 }
 
 void UVATInstancedProxyComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
@@ -97,10 +110,21 @@ void UVATInstancedProxyComponent::TickComponent(float DeltaTime, ELevelTick Tick
 	if (bIsPlayingAnimation && Primary.AnimInfo && VisualTypeAsset)
 	{
 		UpdateAnimation(DeltaTime * PlayRate);
+		if (RootMotionMode == EVATRootMotionMode::ApplyToOwner)
+		{
+			ApplyRootMotionToOwner();
+		}
 		PopulateVATCustomData();
 		
 		// Push the updated data to the renderer
 		VATInstanceRegistry::NotifyProxyVisualsChanged(this, ProxyId, GetComponentTransform(), CurrentVATCustomData);
+		OnPoseChanged.Broadcast(this);
+	}
+	else if (bWaitingForTexturePages && VisualTypeAsset)
+	{
+		// 动画已停止，但页面到达后仍要从Fallback切换过去
+		PopulateVATCustomData();
+		VATInstanceRegistry::NotifyProxyVisualsChanged(this, ProxyId, GetComponentTransform(), CurrentVATCustomData);
 	}
 
 #if WITH_EDITOR
@@ -137,11 +161,22 @@ void UVATInstancedProxyComponent::SetOverlayMaterial(UMaterialInterface* NewOver
 		FMaterialParameterInfo Para_BoneRotation(AnimToTextureParamNames::BoneRotationTexture, EMaterialParameterAssociation::LayerParameter, 0);
 		MID->SetTextureParameterValueByInfo(Para_BonePosition, VisualTypeAsset->BonePositionTexture.Get());
 		MID->SetTextureParameterValueByInfo(Para_BoneRotation, VisualTypeAsset->BoneRotationTexture.Get());
+		if (VATTexturePageStreaming::IsStreamed(VisualTypeAsset))
+		{
+			VATTexturePageStreaming::BindResidentTextures(VisualTypeAsset, MID);
+		}
+		else if (VisualTypeAsset->NumTextureSlices)
+		{
+			FMaterialParameterInfo Para_BonePositionArray(AnimToTextureParamNames::BonePositionTextureArray, EMaterialParameterAssociation::LayerParameter, 0);
+			FMaterialParameterInfo Para_BoneRotationArray(AnimToTextureParamNames::BoneRotationTextureArray, EMaterialParameterAssociation::LayerParameter, 0);
+			MID->SetTextureParameterValueByInfo(Para_BonePositionArray, VisualTypeAsset->BonePositionTextureArray.Get());
+			MID->SetTextureParameterValueByInfo(Para_BoneRotationArray, VisualTypeAsset->BoneRotationTextureArray.Get());
+		}
 
 		FMaterialParameterInfo Para_MinBBox(AnimToTextureParamNames::MinBBox, EMaterialParameterAssociation::LayerParameter, 0);
 		FMaterialParameterInfo Para_SizeBBox(AnimToTextureParamNames::SizeBBox, EMaterialParameterAssociation::LayerParameter, 0);
-		MID->SetVectorParameterValueByInfo(Para_MinBBox, VisualTypeAsset->BoneMinBBox);
-		MID->SetVectorParameterValueByInfo(Para_SizeBBox, VisualTypeAsset->BoneSizeBBox);
+		MID->SetVectorParameterValueByInfo(Para_MinBBox, VisualTypeAsset->GetMaterialMinBBox());
+		MID->SetVectorParameterValueByInfo(Para_SizeBBox, VisualTypeAsset->GetMaterialSizeBBox());
 
 		CurrentOverlayMaterial = MID;
 	}
@@ -195,6 +230,11 @@ void UVATInstancedProxyComponent::PlayTexturedAnim(int32 NewAnimIndex, bool bSho
 	// Initial update
 	PopulateVATCustomData();
 	VATInstanceRegistry::NotifyProxyVisualsChanged(this, ProxyId, GetComponentTransform(), CurrentVATCustomData);
+	OnPoseChanged.Broadcast(this);
+
+	// 包围盒覆盖整个动画，只在切换动画时更新，不需要每帧UpdateBounds
+	UpdateBounds();
+	VATInstanceRegistry::NotifyProxyBoundsChanged(this, ProxyId, GetAnimatedLocalBounds());
 }
 
 void UVATInstancedProxyComponent::StopTexturedAnim()
@@ -255,12 +295,15 @@ void UVATInstancedProxyComponent::PopulateVATCustomData()
 		return;
 	}
 
+	bWaitingForTexturePages = false;
+	UpdateTexturePageRefs();
+
 	// Calculate frame for CurrentPrimaryAnimInfo
-	float FrameA = CalculateAbsoluteFrame(Primary.AnimInfo, Primary.AnimTime, VisualTypeAsset->SampleRate);
+	float FrameA = CalculateAbsoluteFrame(Primary.AnimInfo, Primary.AnimTime);
 
 	if (bIsBlending && Secondary.AnimInfo)
 	{
-		float FrameB = CalculateAbsoluteFrame(Secondary.AnimInfo, Secondary.AnimTime, VisualTypeAsset->SampleRate);
+		float FrameB = CalculateAbsoluteFrame(Secondary.AnimInfo, Secondary.AnimTime);
 		CurrentVATCustomData[0] = FrameA;
 		CurrentVATCustomData[1] = FrameB;  // This should be the frame of the *previous* animation
 		CurrentVATCustomData[2] = CurrentBlendAlpha;
@@ -271,6 +314,131 @@ void UVATInstancedProxyComponent::PopulateVATCustomData()
 		CurrentVATCustomData[1] = FrameA;
 		CurrentVATCustomData[2] = 1.0f;
 	}
+
+	if (bWaitingForTexturePages)
+	{
+		SetComponentTickEnabled(true);
+	}
+}
+
+FBox UVATInstancedProxyComponent::GetAnimatedLocalBounds() const
+{
+	FBox LocalBounds(ForceInit);
+	if (!VisualTypeAsset)
+	{
+		return LocalBounds;
+	}
+
+	if (Primary.AnimInfo)
+	{
+		LocalBounds = FBox(Primary.AnimInfo->Bounds);
+		if (LocalBounds.IsValid && bIsBlending && Secondary.AnimInfo)
+		{
+			const FBox SecondaryBounds(Secondary.AnimInfo->Bounds);
+			LocalBounds = SecondaryBounds.IsValid ? LocalBounds + SecondaryBounds : FBox(ForceInit);
+		}
+	}
+
+	// 没有烘焙动画包围盒(或还未播放动画)时，使用StaticMesh包围盒(此时烘焙会把它扩大到所有动画)
+	if (!LocalBounds.IsValid)
+	{
+		if (const UStaticMesh* Mesh = VisualTypeAsset->GetStaticMesh())
+		{
+			LocalBounds = Mesh->GetBounds().GetBox();
+		}
+	}
+	return LocalBounds;
+}
+
+FBoxSphereBounds UVATInstancedProxyComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	const FBox LocalBounds = GetAnimatedLocalBounds();
+	return LocalBounds.IsValid ? FBoxSphereBounds(LocalBounds).TransformBy(LocalToWorld) : Super::CalcBounds(LocalToWorld);
+}
+
+bool UVATInstancedProxyComponent::GetSocketTransform(const FVATSocketHandle& Socket, FTransform& ComponentSpaceOut) const
+{
+	if (!VisualTypeAsset || Primary.AnimIndex < 0 || !VisualTypeAsset->GetSocketTransform(Socket, Primary.AnimIndex, Primary.AnimTime, ComponentSpaceOut))
+	{
+		return false;
+	}
+
+	FTransform SecondaryTransform = FTransform::Identity;
+	if (bIsBlending && Secondary.AnimIndex >= 0 && VisualTypeAsset->GetSocketTransform(Socket, Secondary.AnimIndex, Secondary.AnimTime, SecondaryTransform))
+	{
+		ComponentSpaceOut.BlendWith(SecondaryTransform, 1.f - CurrentBlendAlpha);
+	}
+	return true;
+}
+
+void UVATInstancedProxyComponent::GetSocketWorldTransforms(const FVATSocketHandle& Socket, const TArray<UVATInstancedProxyComponent*>& Proxies,
+	TArray<FTransform>& OutWorldTransforms, bool bParallel)
+{
+	OutWorldTransforms.SetNumUninitialized(Proxies.Num());
+	if (!Socket.IsValid())
+	{
+		for (FTransform& WorldTransform : OutWorldTransforms)
+		{
+			WorldTransform = FTransform::Identity;
+		}
+		return;
+	}
+
+	// 每个Proxy只读自身状态，写入各自的输出位置
+	ParallelFor(Proxies.Num(), [&Socket, &Proxies, &OutWorldTransforms](int32 Index)
+	{
+		const UVATInstancedProxyComponent* Proxy = Proxies[Index];
+		FTransform SocketTransform = FTransform::Identity;
+		if (Proxy && Proxy->GetSocketTransform(Socket, SocketTransform))
+		{
+			OutWorldTransforms[Index] = SocketTransform * Proxy->GetComponentTransform();
+		}
+		else
+		{
+			OutWorldTransforms[Index] = FTransform::Identity;
+		}
+	}, bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+}
+
+void UVATInstancedProxyComponent::UpdateTexturePageRefs()
+{
+	if (!VATTexturePageStreaming::IsStreamed(VisualTypeAsset))
+	{
+		return;
+	}
+
+	const int32 NewPages[2] = {
+		Primary.AnimInfo ? Primary.AnimInfo->TextureSlice : INDEX_NONE,
+		bIsBlending && Secondary.AnimInfo ? Secondary.AnimInfo->TextureSlice : INDEX_NONE };
+	if (NewPages[0] == ReferencedTexturePages[0] && NewPages[1] == ReferencedTexturePages[1])
+	{
+		return;
+	}
+
+	// 先加引用再释放，避免同一页面的引用计数短暂归零
+	for (const int32 Page : NewPages)
+	{
+		if (Page != INDEX_NONE)
+		{
+			VATTexturePageStreaming::AddPageRef(VisualTypeAsset, Page);
+		}
+	}
+	ReleaseTexturePageRefs();
+
+	ReferencedTexturePages[0] = NewPages[0];
+	ReferencedTexturePages[1] = NewPages[1];
+}
+
+void UVATInstancedProxyComponent::ReleaseTexturePageRefs()
+{
+	for (int32& Page : ReferencedTexturePages)
+	{
+		if (Page != INDEX_NONE)
+		{
+			VATTexturePageStreaming::ReleasePageRef(VisualTypeAsset, Page);
+			Page = INDEX_NONE;
+		}
+	}
 }
 
 void UVATInstancedProxyComponent::UpdateAnimation(float DeltaTime)
@@ -280,6 +448,10 @@ void UVATInstancedProxyComponent::UpdateAnimation(float DeltaTime)
 		return;
 	}
 
+	const AnimPlayState PreviousPrimary = Primary;
+	const AnimPlayState PreviousSecondary = Secondary;
+	const bool bWasBlending = bIsBlending;
+
 	Primary.AnimTime += DeltaTime;
 	if (bIsBlending)
 	{
@@ -293,12 +465,17 @@ void UVATInstancedProxyComponent::UpdateAnimation(float DeltaTime)
 		}
 	}
 
+	if (RootMotionMode != EVATRootMotionMode::Ignore)
+	{
+		AccumulateRootMotion(PreviousPrimary, PreviousSecondary, bWasBlending);
+	}
+
 	ProcessNotifiesForState(Primary, DeltaTime);
 
 	// Note: NumOfInterval = NumOfFrame - 1
-	const float SampleInterval = 1.f / VisualTypeAsset->SampleRate;
+	const float PrimarySampleInterval = 1.f / VisualTypeAsset->GetAnimSampleRate(*Primary.AnimInfo);
 	const int32 PrimaryFrameNumInRange = (Primary.AnimInfo->EndFrame - Primary.AnimInfo->StartFrame + 1);
-	const float PrimaryAnimDuration = (PrimaryFrameNumInRange - 1) * SampleInterval;
+	const float PrimaryAnimDuration = (PrimaryFrameNumInRange - 1) * PrimarySampleInterval;
 	
 	const bool ShouldTransitionToNextAnim = (bTransitionToNextOnEnd && NextAnimIndexToPlayOnEnd != -1);
 
@@ -332,24 +509,73 @@ void UVATInstancedProxyComponent::UpdateAnimation(float DeltaTime)
 
 	if (Secondary.AnimInfo)
 	{
-		const float SecondaryAnimDuration = (Secondary.AnimInfo->EndFrame - Secondary.AnimInfo->StartFrame) * SampleInterval;
+		const float SecondarySampleInterval = 1.f / VisualTypeAsset->GetAnimSampleRate(*Secondary.AnimInfo);
+		const float SecondaryAnimDuration = (Secondary.AnimInfo->EndFrame - Secondary.AnimInfo->StartFrame) * SecondarySampleInterval;
 		Secondary.AnimTime = FMath::Clamp(Secondary.AnimTime, 0.0f, SecondaryAnimDuration);
 	}
 }
 
-float UVATInstancedProxyComponent::CalculateAbsoluteFrame(const FAnim2TextureAnimInfo* AnimInfo, float AnimTime, float SampleRate)
+void UVATInstancedProxyComponent::AccumulateRootMotion(const AnimPlayState& PreviousPrimary, const AnimPlayState& PreviousSecondary, bool bWasBlending)
+{
+	// ExtractRootMotion clamps the times to the baked frames, a frozen animation has no root motion
+	FTransform RootMotionDelta = VisualTypeAsset->ExtractRootMotion(*Primary.AnimInfo, PreviousPrimary.AnimTime, Primary.AnimTime);
+
+	// 混合期间按当前权重混合两个动画的根运动
+	if (bWasBlending && PreviousSecondary.AnimInfo)
+	{
+		const float SecondaryAnimTime = Secondary.AnimInfo ? Secondary.AnimTime : PreviousSecondary.AnimTime + (Primary.AnimTime - PreviousPrimary.AnimTime);
+		const FTransform SecondaryDelta = VisualTypeAsset->ExtractRootMotion(*PreviousSecondary.AnimInfo, PreviousSecondary.AnimTime, SecondaryAnimTime);
+		RootMotionDelta.BlendWith(SecondaryDelta, 1.f - CurrentBlendAlpha);
+	}
+
+	PendingRootMotion = RootMotionDelta * PendingRootMotion;
+}
+
+FTransform UVATInstancedProxyComponent::ConsumeRootMotion()
+{
+	const FTransform RootMotion = PendingRootMotion;
+	PendingRootMotion = FTransform::Identity;
+	return RootMotion;
+}
+
+void UVATInstancedProxyComponent::ApplyRootMotionToOwner()
+{
+	AActor* Owner = GetOwner();
+	const FTransform RootMotion = ConsumeRootMotion();
+	if (!Owner || RootMotion.Equals(FTransform::Identity))
+	{
+		return;
+	}
+
+	// Root motion is in the StaticMesh space of this component
+	const FQuat ComponentRotation = GetComponentQuat();
+	const FVector WorldTranslation = GetComponentTransform().TransformVector(RootMotion.GetTranslation());
+	const FQuat WorldRotation = ComponentRotation * RootMotion.GetRotation() * ComponentRotation.Inverse();
+	Owner->SetActorLocationAndRotation(Owner->GetActorLocation() + WorldTranslation, WorldRotation * Owner->GetActorQuat());
+}
+
+float UVATInstancedProxyComponent::CalculateAbsoluteFrame(const FAnim2TextureAnimInfo* AnimInfo, float AnimTime)
 {
 	if (!AnimInfo) return 0.0f;
 
-	const float TotalAnimDurationInFrames = static_cast<float>(AnimInfo->EndFrame - AnimInfo->StartFrame + 1);
-	const float StartFrameOfAnim = static_cast<float>(AnimInfo->StartFrame);  //+ 1.f;  // In texture, frame 0 is reserved for refpose
-	float FrameInCurrentAnimSegment = AnimTime * SampleRate + 1e-2;                 //由于贴图采样用nearest，浮点误差容易导致采到上一帧
+	float AbsoluteFrame = VisualTypeAsset->GetTextureFrame(*AnimInfo, AnimTime);
+	int32 Slice = AnimInfo->TextureSlice;
 
-	float AbsoluteFrame = FMath::Clamp(StartFrameOfAnim + FrameInCurrentAnimSegment, StartFrameOfAnim, StartFrameOfAnim + TotalAnimDurationInFrames - 1e-2);
+	// 流式加载时Slice是页面在常驻TextureArray中的位置，页面加载完之前采样Fallback
+	if (VATTexturePageStreaming::IsStreamed(VisualTypeAsset))
+	{
+		Slice = VATTexturePageStreaming::GetResidentSlot(VisualTypeAsset, AnimInfo->TextureSlice);
+		if (Slice == INDEX_NONE)
+		{
+			bWaitingForTexturePages = true;
+			AbsoluteFrame = VisualTypeAsset->GetFallbackTextureFrame();
+			Slice = VATTexturePageStreaming::GetFallbackSlot(VisualTypeAsset);
+		}
+	}
 
-	// 将Frame转换为SampleUV.y
-	AbsoluteFrame /= (1.0 + VisualTypeAsset->NumFrames);
-	return AbsoluteFrame;
+	// 将Frame转换为SampleUV.y, 整数部分是TextureArray的Slice
+	AbsoluteFrame /= VisualTypeAsset->GetNumTextureFrames();
+	return AbsoluteFrame + Slice;
 }
 
 
@@ -0,0 +1,59 @@
+#include "VATInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+
+void UVATInstancedStaticMeshComponent::SetInstanceLocalBounds(int32 InstanceIndex, const FBox& LocalBounds)
+{
+	if (!PerInstanceSMData.IsValidIndex(InstanceIndex))
+	{
+		return;
+	}
+
+	while (InstanceLocalBounds.Num() <= InstanceIndex)
+	{
+		InstanceLocalBounds.Add(FBox(ForceInit));
+	}
+	if (InstanceLocalBounds[InstanceIndex] == LocalBounds)
+	{
+		return;
+	}
+
+	// 包围盒在重建渲染状态时更新，同一帧内多次修改只重建一次
+	InstanceLocalBounds[InstanceIndex] = LocalBounds;
+	MarkRenderStateDirty();
+}
+
+FBox UVATInstancedStaticMeshComponent::GetInstanceLocalBounds(int32 InstanceIndex) const
+{
+	return InstanceLocalBounds.IsValidIndex(InstanceIndex) ? InstanceLocalBounds[InstanceIndex] : FBox(ForceInit);
+}
+
+bool UVATInstancedStaticMeshComponent::RemoveInstance(int32 InstanceIndex)
+{
+	// Same order as PerInstanceSMData
+	if (InstanceLocalBounds.IsValidIndex(InstanceIndex))
+	{
+		InstanceLocalBounds.RemoveAt(InstanceIndex);
+	}
+	return Super::RemoveInstance(InstanceIndex);
+}
+
+FBoxSphereBounds UVATInstancedStaticMeshComponent::CalcBounds(const FTransform& BoundTransform) const
+{
+	const UStaticMesh* Mesh = GetStaticMesh();
+	if (!Mesh || PerInstanceSMData.IsEmpty())
+	{
+		return Super::CalcBounds(BoundTransform);
+	}
+
+	const FMatrix BoundTransformMatrix = BoundTransform.ToMatrixWithScale();
+	const FBox MeshBounds = Mesh->GetBounds().GetBox();
+
+	FBox Bounds(ForceInit);
+	for (int32 InstanceIndex = 0; InstanceIndex < PerInstanceSMData.Num(); ++InstanceIndex)
+	{
+		const FBox& LocalBounds = InstanceLocalBounds.IsValidIndex(InstanceIndex) && InstanceLocalBounds[InstanceIndex].IsValid
+			? InstanceLocalBounds[InstanceIndex] : MeshBounds;
+		Bounds += LocalBounds.TransformBy(PerInstanceSMData[InstanceIndex].Transform * BoundTransformMatrix);
+	}
+	return FBoxSphereBounds(Bounds);
+}
@@ -1,6 +1,8 @@
 ﻿#include "VATInstancingModule.h"
 
+#include "Engine/World.h"
 #include "Logging/LogMacros.h"
+#include "VATTexturePageStreaming.h"
 
 #define LOCTEXT_NAMESPACE "FVATInstancingModule"
 
@@ -8,12 +10,17 @@ void FVATInstancingModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
 	UE_LOG(LogTemp, Log, TEXT("VATInstancing module has started."));
+
+	OnPostWorldCleanupHandle = FWorldDelegates::OnPostWorldCleanup.AddStatic(&VATTexturePageStreaming::OnWorldCleanup);
 }
 
 void FVATInstancingModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FWorldDelegates::OnPostWorldCleanup.Remove(OnPostWorldCleanupHandle);
+	OnPostWorldCleanupHandle.Reset();
+
 	UE_LOG(LogTemp, Log, TEXT("VATInstancing module has shut down."));
 }
 
@@ -0,0 +1,409 @@
+﻿#include "VATTexturePageStreaming.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/Texture2D.h"
+#include "Engine/Texture2DArray.h"
+#include "Engine/World.h"
+#include "Logging/LogMacros.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "MyAnimToTextureDataAsset.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "TextureResource.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/StrongObjectPtr.h"
+#include "VATMaterialParameterName.h"
+#if WITH_EDITOR
+#include "TextureCompiler.h"
+#endif
+
+DECLARE_STATS_GROUP(TEXT("VAT Texture Pages"), STATGROUP_VATTexturePages, STATCAT_Advanced);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Referenced Pages"), STAT_VATReferencedTexturePages, STATGROUP_VATTexturePages);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Resident Pages"), STAT_VATResidentTexturePages, STATGROUP_VATTexturePages);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pending Pages"), STAT_VATPendingTexturePages, STATGROUP_VATTexturePages);
+DECLARE_MEMORY_STAT(TEXT("Resident Texture Arrays"), STAT_VATResidentTextureArrayMemory, STATGROUP_VATTexturePages);
+DECLARE_MEMORY_STAT(TEXT("Baked Texture Arrays (not resident)"), STAT_VATBakedTextureArrayMemory, STATGROUP_VATTexturePages);
+
+namespace VATTexturePageStreaming
+{
+	struct FTexturePage
+	{
+		/** Proxies sampling this page. The fallback page holds one extra reference so it is never evicted */
+		int32 NumRefs = 0;
+
+		/** Slice of the resident Texture Arrays, INDEX_NONE when not resident */
+		int32 Slot = INDEX_NONE;
+
+		/** Referenced but not resident yet: loading, or loaded and waiting for a free slot */
+		bool bPending = false;
+
+		/** Keeps the page Texture2Ds loaded until they are copied into Slot */
+		TSharedPtr<FStreamableHandle> LoadHandle;
+	};
+
+	struct FResidentPages
+	{
+		TArray<FTexturePage> Pages;
+
+		/** Slot -> Page, INDEX_NONE when empty */
+		TArray<int32> SlotPages;
+		TArray<uint64> SlotLastUsed;
+
+		/** Loaded pages waiting for a slot, oldest first */
+		TArray<int32> WaitingPages;
+
+		TStrongObjectPtr<UTexture2DArray> PositionArray;
+		TStrongObjectPtr<UTexture2DArray> RotationArray;
+
+		int64 ResidentMemory = 0;
+		int64 BakedMemory = 0;
+	};
+
+	static TMap<TObjectKey<UMyAnimToTextureDataAsset>, FResidentPages> AllResidentPages;
+	static uint64 UseCounter = 0;
+
+	static UTexture2DArray* CreateResidentArray(const UTexture2D* Page, const int32 NumSlots)
+	{
+		UTexture2DArray* Array = UTexture2DArray::CreateTransient(Page->GetSizeX(), Page->GetSizeY(), NumSlots, Page->GetPixelFormat());
+		if (Array)
+		{
+			Array->SRGB = false;
+			Array->Filter = TextureFilter::TF_Nearest;
+			Array->NeverStream = true;
+			Array->UpdateResource();
+		}
+		return Array;
+	}
+
+	static void CopyTextureToSlice(UTexture2D* Source, UTexture2DArray* Dest, const int32 Slice)
+	{
+		FTextureResource* SourceResource = Source->GetResource();
+		FTextureResource* DestResource = Dest->GetResource();
+		if (!SourceResource || !DestResource)
+		{
+			return;
+		}
+
+		// Source的Resource在UObject销毁时才由渲染线程释放，排在这条命令之后
+		ENQUEUE_RENDER_COMMAND(VATCopyTexturePage)(
+			[SourceResource, DestResource, Slice](FRHICommandListImmediate& RHICmdList)
+			{
+				FRHITexture* SourceRHI = SourceResource->TextureRHI;
+				FRHITexture* DestRHI = DestResource->TextureRHI;
+				if (!SourceRHI || !DestRHI || SourceRHI->GetFormat() != DestRHI->GetFormat()
+					|| SourceRHI->GetSizeXYZ().X != DestRHI->GetSizeXYZ().X || SourceRHI->GetSizeXYZ().Y != DestRHI->GetSizeXYZ().Y)
+				{
+					return;
+				}
+
+				FRHICopyTextureInfo CopyInfo;
+				CopyInfo.Size = FIntVector(SourceRHI->GetSizeXYZ().X, SourceRHI->GetSizeXYZ().Y, 1);
+				CopyInfo.DestSliceIndex = Slice;
+
+				RHICmdList.Transition({
+					FRHITransitionInfo(SourceRHI, ERHIAccess::Unknown, ERHIAccess::CopySrc),
+					FRHITransitionInfo(DestRHI, ERHIAccess::Unknown, ERHIAccess::CopyDest) });
+				RHICmdList.CopyTexture(SourceRHI, DestRHI, CopyInfo);
+				RHICmdList.Transition({
+					FRHITransitionInfo(SourceRHI, ERHIAccess::CopySrc, ERHIAccess::SRVMask),
+					FRHITransitionInfo(DestRHI, ERHIAccess::CopyDest, ERHIAccess::SRVMask) });
+			});
+	}
+
+	/** Copies the loaded page Texture2Ds into Slot, evicting the page that was there */
+	static void MakeResident(const UMyAnimToTextureDataAsset* DataAsset, FResidentPages& Entry, const int32 Page, const int32 Slot)
+	{
+		FTexturePage& TexturePage = Entry.Pages[Page];
+		UTexture2D* PositionPage = DataAsset->BonePositionTexturePages[Page].Get();
+		UTexture2D* RotationPage = DataAsset->BoneRotationTexturePages[Page].Get();
+
+		if (TexturePage.bPending)
+		{
+			TexturePage.bPending = false;
+			DEC_DWORD_STAT(STAT_VATPendingTexturePages);
+		}
+
+		if (!PositionPage || !RotationPage)
+		{
+			UE_LOG(LogVATInstancing, Warning, TEXT("VATTexturePageStreaming: Failed to load page %d of %s, the fallback animation is sampled instead."), Page, *DataAsset->GetName());
+			TexturePage.LoadHandle.Reset();
+			return;
+		}
+
+#if WITH_EDITOR
+		FTextureCompilingManager::Get().FinishCompilation({ PositionPage, RotationPage });
+#endif
+
+		const int32 EvictedPage = Entry.SlotPages[Slot];
+		if (EvictedPage != INDEX_NONE)
+		{
+			Entry.Pages[EvictedPage].Slot = INDEX_NONE;
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_VATResidentTexturePages);
+		}
+
+		CopyTextureToSlice(PositionPage, Entry.PositionArray.Get(), Slot);
+		CopyTextureToSlice(RotationPage, Entry.RotationArray.Get(), Slot);
+
+		Entry.SlotPages[Slot] = Page;
+		Entry.SlotLastUsed[Slot] = ++UseCounter;
+		TexturePage.Slot = Slot;
+
+		// Stream out: 拷贝后就不再需要Texture2D了
+		TexturePage.LoadHandle.Reset();
+	}
+
+	/** Empty slot, or the least recently used one of an unreferenced page */
+	static int32 FindFreeSlot(const FResidentPages& Entry)
+	{
+		int32 BestSlot = INDEX_NONE;
+		for (int32 Slot = 0; Slot < Entry.SlotPages.Num(); ++Slot)
+		{
+			const int32 Page = Entry.SlotPages[Slot];
+			if (Page == INDEX_NONE)
+			{
+				return Slot;
+			}
+			if (Entry.Pages[Page].NumRefs == 0 && (BestSlot == INDEX_NONE || Entry.SlotLastUsed[Slot] < Entry.SlotLastUsed[BestSlot]))
+			{
+				BestSlot = Slot;
+			}
+		}
+		return BestSlot;
+	}
+
+	static void OnPageLoaded(TObjectKey<UMyAnimToTextureDataAsset> DataAssetKey, int32 Page)
+	{
+		const UMyAnimToTextureDataAsset* DataAsset = DataAssetKey.ResolveObjectPtr();
+		FResidentPages* Entry = AllResidentPages.Find(DataAssetKey);
+		if (!DataAsset || !Entry || !Entry->Pages.IsValidIndex(Page) || !Entry->Pages[Page].bPending)
+		{
+			return;
+		}
+
+		const int32 Slot = FindFreeSlot(*Entry);
+		if (Slot == INDEX_NONE)
+		{
+			// 所有Slot都被引用着，等某个页面不再被引用
+			Entry->WaitingPages.AddUnique(Page);
+			return;
+		}
+		MakeResident(DataAsset, *Entry, Page, Slot);
+	}
+
+	static FResidentPages* FindOrAddResidentPages(const UMyAnimToTextureDataAsset* DataAsset)
+	{
+		if (!IsStreamed(DataAsset))
+		{
+			return nullptr;
+		}
+		if (FResidentPages* Found = AllResidentPages.Find(DataAsset))
+		{
+			return Found;
+		}
+
+		// The fallback page is loaded synchronously: it gives the size and format of the resident Texture Arrays,
+		// and it is sampled until the other pages are streamed in
+		const int32 FallbackPage = DataAsset->GetFallbackTexturePage();
+		UTexture2D* PositionPage = DataAsset->BonePositionTexturePages[FallbackPage].LoadSynchronous();
+		UTexture2D* RotationPage = DataAsset->BoneRotationTexturePages[FallbackPage].LoadSynchronous();
+		if (!PositionPage || !RotationPage)
+		{
+			UE_LOG(LogVATInstancing, Error, TEXT("VATTexturePageStreaming: Failed to load the fallback page of %s, rebake it."), *DataAsset->GetName());
+			return nullptr;
+		}
+
+#if WITH_EDITOR
+		FTextureCompilingManager::Get().FinishCompilation({ PositionPage, RotationPage });
+#endif
+
+		const int32 NumSlots = FMath::Clamp(DataAsset->MaxResidentTexturePages, 1, DataAsset->NumTextureSlices);
+		UTexture2DArray* PositionArray = CreateResidentArray(PositionPage, NumSlots);
+		UTexture2DArray* RotationArray = CreateResidentArray(RotationPage, NumSlots);
+		if (!PositionArray || !RotationArray)
+		{
+			UE_LOG(LogVATInstancing, Error, TEXT("VATTexturePageStreaming: Failed to create the resident Texture Arrays of %s."), *DataAsset->GetName());
+			return nullptr;
+		}
+
+		FResidentPages& Entry = AllResidentPages.Add(DataAsset);
+		Entry.Pages.SetNum(DataAsset->NumTextureSlices);
+		Entry.SlotPages.Init(INDEX_NONE, NumSlots);
+		Entry.SlotLastUsed.Init(0, NumSlots);
+		Entry.PositionArray.Reset(PositionArray);
+		Entry.RotationArray.Reset(RotationArray);
+
+		Entry.Pages[FallbackPage].NumRefs = 1;
+		MakeResident(DataAsset, Entry, FallbackPage, 0);
+
+		Entry.ResidentMemory = PositionArray->CalcTextureMemorySizeEnum(TMC_AllMips) + RotationArray->CalcTextureMemorySizeEnum(TMC_AllMips);
+		Entry.BakedMemory = Entry.ResidentMemory / NumSlots * DataAsset->NumTextureSlices;
+		INC_MEMORY_STAT_BY(STAT_VATResidentTextureArrayMemory, Entry.ResidentMemory);
+		INC_MEMORY_STAT_BY(STAT_VATBakedTextureArrayMemory, Entry.BakedMemory);
+
+		UE_LOG(LogVATInstancing, Log, TEXT("VATTexturePageStreaming: %s streams %d pages into %d slots (%.2f of %.2f MB)."),
+			*DataAsset->GetName(), DataAsset->NumTextureSlices, NumSlots, Entry.ResidentMemory / (1024.f * 1024.f), Entry.BakedMemory / (1024.f * 1024.f));
+		return &Entry;
+	}
+
+	bool IsStreamed(const UMyAnimToTextureDataAsset* DataAsset)
+	{
+		return DataAsset && DataAsset->IsStreamingTexturePages();
+	}
+
+	void AddPageRef(const UMyAnimToTextureDataAsset* DataAsset, int32 Page)
+	{
+		FResidentPages* Entry = FindOrAddResidentPages(DataAsset);
+		if (!Entry || !Entry->Pages.IsValidIndex(Page))
+		{
+			return;
+		}
+
+		FTexturePage& TexturePage = Entry->Pages[Page];
+		if (TexturePage.NumRefs++ > 0)
+		{
+			return;
+		}
+		INC_DWORD_STAT(STAT_VATReferencedTexturePages);
+
+		// Still resident from the last time it was referenced
+		if (TexturePage.Slot != INDEX_NONE || TexturePage.bPending)
+		{
+			return;
+		}
+
+		TexturePage.bPending = true;
+		INC_DWORD_STAT(STAT_VATPendingTexturePages);
+
+		TSharedPtr<FStreamableHandle> LoadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+			{ DataAsset->BonePositionTexturePages[Page].ToSoftObjectPath(), DataAsset->BoneRotationTexturePages[Page].ToSoftObjectPath() },
+			FStreamableDelegate::CreateStatic(&OnPageLoaded, TObjectKey<UMyAnimToTextureDataAsset>(DataAsset), Page));
+
+		// 已加载的资源可能同步回调，此时页面已经常驻，不需要再持有Handle
+		if (TexturePage.bPending)
+		{
+			TexturePage.LoadHandle = LoadHandle;
+		}
+	}
+
+	void ReleasePageRef(const UMyAnimToTextureDataAsset* DataAsset, int32 Page)
+	{
+		FResidentPages* Entry = AllResidentPages.Find(DataAsset);
+		if (!Entry || !Entry->Pages.IsValidIndex(Page) || !ensure(Entry->Pages[Page].NumRefs > 0))
+		{
+			return;
+		}
+
+		FTexturePage& TexturePage = Entry->Pages[Page];
+		if (--TexturePage.NumRefs > 0)
+		{
+			return;
+		}
+		DEC_DWORD_STAT(STAT_VATReferencedTexturePages);
+
+		if (TexturePage.bPending)
+		{
+			// Streamed out before it arrived
+			if (TexturePage.LoadHandle.IsValid())
+			{
+				TexturePage.LoadHandle->CancelHandle();
+				TexturePage.LoadHandle.Reset();
+			}
+			TexturePage.bPending = false;
+			Entry->WaitingPages.Remove(Page);
+			DEC_DWORD_STAT(STAT_VATPendingTexturePages);
+		}
+		else if (TexturePage.Slot != INDEX_NONE && Entry->WaitingPages.Num())
+		{
+			// Its slot can take the oldest page waiting for one
+			const int32 WaitingPage = Entry->WaitingPages[0];
+			Entry->WaitingPages.RemoveAt(0);
+			MakeResident(DataAsset, *Entry, WaitingPage, TexturePage.Slot);
+		}
+	}
+
+	int32 GetResidentSlot(const UMyAnimToTextureDataAsset* DataAsset, int32 Page)
+	{
+		FResidentPages* Entry = FindOrAddResidentPages(DataAsset);
+		if (!Entry || !Entry->Pages.IsValidIndex(Page))
+		{
+			return INDEX_NONE;
+		}
+
+		const int32 Slot = Entry->Pages[Page].Slot;
+		if (Slot != INDEX_NONE)
+		{
+			Entry->SlotLastUsed[Slot] = ++UseCounter;
+		}
+		return Slot;
+	}
+
+	int32 GetFallbackSlot(const UMyAnimToTextureDataAsset* DataAsset)
+	{
+		const FResidentPages* Entry = FindOrAddResidentPages(DataAsset);
+		return Entry ? FMath::Max(0, Entry->Pages[DataAsset->GetFallbackTexturePage()].Slot) : 0;
+	}
+
+	void BindResidentTextures(const UMyAnimToTextureDataAsset* DataAsset, UMaterialInstanceDynamic* MID)
+	{
+		const FResidentPages* Entry = FindOrAddResidentPages(DataAsset);
+		if (!Entry || !MID)
+		{
+			return;
+		}
+
+		// Base Materials use global parameters, Material Layers (e.g. Overlay Materials) the ones of the first layer
+		for (const EMaterialParameterAssociation Association : { EMaterialParameterAssociation::GlobalParameter, EMaterialParameterAssociation::LayerParameter })
+		{
+			const int32 Index = Association == EMaterialParameterAssociation::LayerParameter ? 0 : INDEX_NONE;
+			MID->SetTextureParameterValueByInfo(FMaterialParameterInfo(AnimToTextureParamNames::BonePositionTextureArray, Association, Index), Entry->PositionArray.Get());
+			MID->SetTextureParameterValueByInfo(FMaterialParameterInfo(AnimToTextureParamNames::BoneRotationTextureArray, Association, Index), Entry->RotationArray.Get());
+		}
+	}
+
+	UMaterialInterface* GetStreamingMaterial(const UMyAnimToTextureDataAsset* DataAsset, UMaterialInterface* Material, UObject* Outer)
+	{
+		if (!Material || !IsStreamed(DataAsset))
+		{
+			return Material;
+		}
+
+		UMaterialInstanceDynamic* MID = UMaterialInstanceDynamic::Create(Material, Outer);
+		BindResidentTextures(DataAsset, MID);
+		return MID;
+	}
+
+	void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+	{
+		for (auto It = AllResidentPages.CreateIterator(); It; ++It)
+		{
+			FResidentPages& Entry = It.Value();
+			const UMyAnimToTextureDataAsset* DataAsset = It.Key().ResolveObjectPtr();
+			const int32 FallbackPage = DataAsset ? DataAsset->GetFallbackTexturePage() : INDEX_NONE;
+
+			// 除了Fallback页面自己的引用，还有proxy引用着
+			const bool bReferenced = DataAsset && Entry.Pages.ContainsByPredicate([&](const FTexturePage& TexturePage)
+			{
+				return TexturePage.NumRefs > (&TexturePage - Entry.Pages.GetData() == FallbackPage ? 1 : 0);
+			});
+			if (bReferenced)
+			{
+				continue;
+			}
+
+			for (const FTexturePage& TexturePage : Entry.Pages)
+			{
+				if (TexturePage.Slot != INDEX_NONE)
+				{
+					DEC_DWORD_STAT(STAT_VATResidentTexturePages);
+				}
+			}
+			DEC_MEMORY_STAT_BY(STAT_VATResidentTextureArrayMemory, Entry.ResidentMemory);
+			DEC_MEMORY_STAT_BY(STAT_VATBakedTextureArrayMemory, Entry.BakedMemory);
+			It.RemoveCurrent();
+		}
+	}
+
+}  // namespace VATTexturePageStreaming
@@ -3,6 +3,8 @@
 #include "Components/InstancedStaticMeshComponent.h"
 #include "Engine/World.h"
 #include "MyAnimToTextureDataAsset.h"
+#include "VATInstancedStaticMeshComponent.h"
+#include "VATTexturePageStreaming.h"
 
 UVatiRenderSubsystem::UVatiRenderSubsystem()
 {
@@ -93,6 +95,11 @@ void UVatiRenderSubsystem::UnregisterProxy(FVATProxyId ProxyId)
 		float* DestCustomData = Ismc->PerInstanceSMCustomData.GetData() + IndexToRemove * NumFloats;
 		FMemory::Memcpy(DestCustomData, SrcCustomData, NumFloats * sizeof(float));
 
+		if (UVATInstancedStaticMeshComponent* VatIsmc = Cast<UVATInstancedStaticMeshComponent>(Ismc))
+		{
+			VatIsmc->SetInstanceLocalBounds(IndexToRemove, VatIsmc->GetInstanceLocalBounds(LastIndex));
+		}
+
 		// Update the map for the actor that was moved
 		auto& LastInstanceInfo = InstanceInfos.FindChecked(LastId);
 		LastInstanceInfo.InstanceIndex = IndexToRemove;
@@ -126,16 +133,33 @@ void UVatiRenderSubsystem::UpdateProxyBatchKey(FVATProxyId ProxyId, const FBatch
 	}
 
 	FTransform CurrentTransform = FTransform::Identity;
+	FBox CurrentBounds(ForceInit);
 	TArray<float> CurrentCustomData; // This data will be lost and needs re-populating.
 
 	if (UInstancedStaticMeshComponent* OldIsmc = Info->Ismc.Get())
 	{
 		OldIsmc->GetInstanceTransform(Info->InstanceIndex, CurrentTransform);
+		if (const UVATInstancedStaticMeshComponent* OldVatIsmc = Cast<UVATInstancedStaticMeshComponent>(OldIsmc))
+		{
+			CurrentBounds = OldVatIsmc->GetInstanceLocalBounds(Info->InstanceIndex);
+		}
 	}
 
 	// Unregister from the old batch and re-register with the new one.
 	UnregisterProxy(ProxyId);
 	RegisterProxy(ProxyId, NewBatchKey, CurrentTransform, CurrentCustomData);
+	UpdateProxyBounds(ProxyId, CurrentBounds);
+}
+
+void UVatiRenderSubsystem::UpdateProxyBounds(FVATProxyId ProxyId, const FBox& NewLocalBounds)
+{
+	if (FProxyInstanceInfo* Info = InstanceInfos.Find(ProxyId))
+	{
+		if (UVATInstancedStaticMeshComponent* Ismc = Cast<UVATInstancedStaticMeshComponent>(Info->Ismc.Get()))
+		{
+			Ismc->SetInstanceLocalBounds(Info->InstanceIndex, NewLocalBounds);
+		}
+	}
 }
 
 UInstancedStaticMeshComponent* UVatiRenderSubsystem::FindOrCreateIsmcForBatch(const FBatchKey& BatchKey)
@@ -151,13 +175,14 @@ UInstancedStaticMeshComponent* UVatiRenderSubsystem::FindOrCreateIsmcForBatch(co
 		return nullptr;
 	}
 
-	UInstancedStaticMeshComponent* NewIsmc = NewObject<UInstancedStaticMeshComponent>(this);
+	UInstancedStaticMeshComponent* NewIsmc = NewObject<UVATInstancedStaticMeshComponent>(this);
 	NewIsmc->SetStaticMesh(BatchKey.VisualTypeAsset->GetStaticMesh());
 	NewIsmc->NumCustomDataFloats = BatchKey.VisualTypeAsset->NumCustomDataFloatsForVAT;
 
 	for (int32 i = 0; i < BatchKey.BaseMaterials.Num(); ++i)
 	{
-		NewIsmc->SetMaterial(i, BatchKey.BaseMaterials[i]);
+		// 流式加载页面的DataAsset需要用MID绑定常驻的TextureArray
+		NewIsmc->SetMaterial(i, VATTexturePageStreaming::GetStreamingMaterial(BatchKey.VisualTypeAsset, BatchKey.BaseMaterials[i], NewIsmc));
 	}
 	if (BatchKey.OverlayMaterial)
 	{
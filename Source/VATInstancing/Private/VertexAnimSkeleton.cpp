@@ -7,27 +7,27 @@
 // Sets default values for this component's properties
 UVertexAnimSkeleton::UVertexAnimSkeleton()
 {
-	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bCanEverTick = false;
 }
 
 void UVertexAnimSkeleton::SetInstanceProxy(UVATInstancedProxyComponent* proxy)
 {
 	InstanceProxy = proxy;
+	SocketHandles.Reset();
+	UpdatePoseChangedBinding();
 }
 
 FTransform UVertexAnimSkeleton::GetSocketTransform(FName InSocketName, ERelativeTransformSpace TransformSpace) const
 {
-	if (InSocketName == NAME_None || !InstanceProxy.IsValid())
+	if (InSocketName == NAME_None || !InstanceProxy.IsValid() || !InstanceProxy->VisualTypeAsset || InstanceProxy->Primary.AnimIndex < 0)
 	{
 		UE_LOG(LogTemp, Log, TEXT("VertexAnimSkeleton::GetSocketTransform failed. InSocketName is None or InstanceProxy is null."));
 		return FTransform::Identity;
 	}
 
-	int32 PrimaryAnimIndex = InstanceProxy->Primary.AnimIndex;
-	float PrimaryAnimTime = InstanceProxy->Primary.AnimTime;
-
+	// Proxy按CurrentBlendAlpha混合Primary与Secondary，与材质一致
 	FTransform SocketComponentSpaceTrans = FTransform::Identity;
-	if (!InstanceProxy->VisualTypeAsset->GetSocketTransform(InSocketName, PrimaryAnimIndex, PrimaryAnimTime, SocketComponentSpaceTrans))
+	if (!InstanceProxy->GetSocketTransform(GetSocketHandle(InSocketName), SocketComponentSpaceTrans))
 	{
 		UE_LOG(LogTemp, Log, TEXT("VertexAnimSkeleton::GetSocketTransform failed. "));
 		return FTransform::Identity;
@@ -53,6 +53,17 @@ FTransform UVertexAnimSkeleton::GetSocketTransform(FName InSocketName, ERelative
 	return SocketComponentSpaceTrans;
 }
 
+const FVATSocketHandle& UVertexAnimSkeleton::GetSocketHandle(FName InSocketName) const
+{
+	const UMyAnimToTextureDataAsset* DataAsset = InstanceProxy->VisualTypeAsset;
+	FVATSocketHandle* Socket = SocketHandles.Find(InSocketName);
+	if (!Socket || Socket->DataAsset.Get() != DataAsset)
+	{
+		Socket = &SocketHandles.Add(InSocketName, DataAsset->ResolveSocket(InSocketName));
+	}
+	return *Socket;
+}
+
 FVector UVertexAnimSkeleton::GetSocketLocation(FName InSocketName) const
 {
 	return GetSocketTransform(InSocketName, ERelativeTransformSpace::RTS_World).GetTranslation();
@@ -106,11 +117,65 @@ void UVertexAnimSkeleton::BeginPlay()
 	
 }
 
-void UVertexAnimSkeleton::TickComponent(float DeltaTime, enum ELevelTick TickType,
-	FActorComponentTickFunction* ThisTickFunction)
+void UVertexAnimSkeleton::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (BoundProxy.IsValid())
+	{
+		BoundProxy->OnPoseChanged.Remove(PoseChangedHandle);
+	}
+	BoundProxy.Reset();
+	PoseChangedHandle.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UVertexAnimSkeleton::OnChildAttached(USceneComponent* ChildComponent)
+{
+	Super::OnChildAttached(ChildComponent);
+	UpdatePoseChangedBinding();
+}
+
+void UVertexAnimSkeleton::OnChildDetached(USceneComponent* ChildComponent)
+{
+	Super::OnChildDetached(ChildComponent);
+	UpdatePoseChangedBinding();
+}
+
+bool UVertexAnimSkeleton::HasSocketAttachedChildren() const
 {
-	//Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	for (const USceneComponent* Child : GetAttachChildren())
+	{
+		if (Child && Child->GetAttachSocketName() != NAME_None)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void UVertexAnimSkeleton::UpdatePoseChangedBinding()
+{
+	UVATInstancedProxyComponent* Proxy = HasSocketAttachedChildren() ? InstanceProxy.Get() : nullptr;
+	if (BoundProxy.Get() == Proxy)
+	{
+		return;
+	}
 
+	if (BoundProxy.IsValid())
+	{
+		BoundProxy->OnPoseChanged.Remove(PoseChangedHandle);
+	}
+	PoseChangedHandle.Reset();
+	BoundProxy = Proxy;
+
+	if (Proxy)
+	{
+		PoseChangedHandle = Proxy->OnPoseChanged.AddUObject(this, &UVertexAnimSkeleton::OnProxyPoseChanged);
+	}
+}
+
+void UVertexAnimSkeleton::OnProxyPoseChanged(UVATInstancedProxyComponent* Proxy)
+{
 	UpdateChildTransforms(EUpdateTransformFlags::OnlyUpdateIfUsingSocket);
 }
 
@@ -8,9 +8,11 @@
 #include "MyAnimToTextureDataAsset.generated.h"
 
 class UAnimSequence;
+class UMyAnimToTextureDataAsset;
 class USkeletalMesh;
 class UStaticMesh;
 class UTexture2D;
+class UTexture2DArray;
 
 UENUM(Blueprintable)
 enum class EAnim2TextureMode : uint8
@@ -28,6 +30,29 @@ enum class EAnim2TexturePrecision : uint8
 	EightBits,
 	/* 16 bits */
 	SixteenBits,
+	/* 16 bits float (RGBA16F). Positions are stored as they are, without Bounding Box normalization */
+	HalfFloat,
+};
+
+UENUM(Blueprintable)
+enum class EAnim2TextureRotationFormat : uint8
+{
+	/* Axis in RGB, Angle in A. Uses RotationPrecision */
+	AxisAngle,
+	/* Smallest-three Quaternion packed as 10:10:10:2 in a 8 bits RGBA texel */
+	Quaternion,
+	/* Rotation and position together as a Dual Quaternion, two texels per Bone in the Bone Position Texture (PositionPrecision).
+	*  No Bone Rotation Texture and no RefPose fetch, influences are blended with Dual Quaternion Skinning. Requires Global PositionRangeMode */
+	DualQuaternion,
+};
+
+UENUM(Blueprintable)
+enum class EAnim2TextureRangeMode : uint8
+{
+	/* Single bounding box for all bones (or vertices) and frames */
+	Global,
+	/* Bounding box per bone (or vertex), stored in lookup rows after the RefPose */
+	PerElement,
 };
 
 UENUM(Blueprintable)
@@ -74,13 +99,58 @@ struct FAnim2TextureAnimSequenceInfo
 	UPROPERTY(EditAnywhere, Category = Default, BlueprintReadWrite, meta = (EditCondition = "bUseCustomRange", EditConditionHides))
 	int32 EndFrame = 0;
 
+	/* Use Custom SampleRate instead of the DataAsset SampleRate */
+	UPROPERTY(EditAnywhere, Category = Default, BlueprintReadWrite)
+	bool bOverrideSampleRate = false;
+
+	/* 慢动作(如Idle)可以用更低的采样率，节约贴图行数 */
+	UPROPERTY(EditAnywhere, Category = Default, BlueprintReadWrite, meta = (EditCondition = "bOverrideSampleRate", EditConditionHides, ClampMin = "1.0"))
+	float SampleRate = 30.0f;
+
 	/* 预计算这些骨骼的ComponentSpaceTransform，运行时可以读取以获取Socket在动画某时刻的位置 */
 	UPROPERTY(EditAnywhere, Category = Default, BlueprintReadWrite)
 	TArray<FName> BoneOrSocketsOfInterest;
 
-	/* 假设共N帧动画、M个骨骼，则对于第i帧、第j个骨骼的下标为(i*M+j) */
+	/* 每个骨骼/Socket一条轨道，位置相对轨道的Min/Size量化 */
 	UPROPERTY(VisibleAnywhere)
-	TArray<FVtxAnimComponentSpaceTransform> BoneComponentSpaceTransforms;
+	TArray<FVector3f> SocketTrackMins;
+
+	UPROPERTY(VisibleAnywhere)
+	TArray<FVector3f> SocketTrackSizes;
+
+	/* Baked frames between two socket keys (SocketFramesPerKey at bake time). The last frame is always a key */
+	UPROPERTY(VisibleAnywhere)
+	int32 SocketFrameStep = 1;
+
+	/**
+	* 假设共N个关键帧、M个骨骼，则对于第i个关键帧、第j个骨骼的Transform为下标(i*M+j)*PackedSocketTransformStride开始的uint16:
+	* Position XYZ (16 bits, relative to the track range),
+	* Rotation as the three smallest Quaternion components (15 bits each, index of the dropped one in the top bits of the first two).
+	*/
+	UPROPERTY(VisibleAnywhere)
+	TArray<uint16> PackedSocketTransforms;
+
+	/* Assets baked before the transforms were quantized, packed on PostLoad */
+	UPROPERTY()
+	TArray<FVtxAnimComponentSpaceTransform> BoneComponentSpaceTransforms_DEPRECATED;
+
+	static constexpr int32 PackedSocketTransformStride = 6;
+
+	int32 GetNumSocketTracks() const { return SocketTrackMins.Num(); }
+
+	bool HasSocketTransforms() const { return !PackedSocketTransforms.IsEmpty(); }
+
+	int32 GetNumSocketKeys() const { return SocketTrackMins.Num() ? PackedSocketTransforms.Num() / (SocketTrackMins.Num() * PackedSocketTransformStride) : 0; }
+
+	/* Quantizes every FrameStep-th frame (and the last one) of Transforms, indexed (Frame * NumTracks + Track). Scale is not stored */
+	VATINSTANCING_API void PackSocketTransforms(const TArray<FTransform>& Transforms, int32 NumTracks, int32 FrameStep = 1);
+
+	/* Component Space Transform of Track at a socket Key */
+	VATINSTANCING_API FTransform UnpackSocketTransform(int32 Key, int32 Track) const;
+
+	/* Component Space Transform of Track at a (fractional) baked Frame of the AnimSequence, interpolated between the keys around it.
+	*  LastFrame is the last baked frame, relative to the start of the AnimSequence */
+	VATINSTANCING_API FTransform SampleSocketTransform(float Frame, int32 LastFrame, int32 Track) const;
 };
 
 USTRUCT(Blueprintable)
@@ -94,6 +164,67 @@ struct FAnim2TextureAnimInfo
 	// inclusive
 	UPROPERTY(VisibleAnywhere, Category = Default, BlueprintReadOnly)
 	int32 EndFrame = 0;
+
+	/* Frames per second this animation was baked at. Zero on assets baked before it was stored, use GetAnimSampleRate */
+	UPROPERTY(VisibleAnywhere, Category = Default, BlueprintReadOnly)
+	float SampleRate = 0.f;
+
+	/* Texture Array slice storing this animation */
+	UPROPERTY(VisibleAnywhere, Category = Default, BlueprintReadOnly)
+	int32 TextureSlice = 0;
+
+	/* Texture frame of StartFrame (in its slice) minus StartFrame */
+	UPROPERTY(VisibleAnywhere, Category = Default, BlueprintReadOnly)
+	int32 TextureFrameOffset = 0;
+
+	/* Local bounds of the animated StaticMesh over all frames. Invalid on assets baked before it was stored */
+	UPROPERTY(VisibleAnywhere, Category = Default, BlueprintReadOnly)
+	FBox3f Bounds = FBox3f(ForceInit);
+
+	/* Local bounds of every BoundsFramesPerRange frames. Empty when BoundsFramesPerRange is zero */
+	UPROPERTY(VisibleAnywhere, Category = Default)
+	TArray<FBox3f> FrameRangeBounds;
+
+	/* Root motion of every baked frame relative to the first one, in StaticMesh space: XYZ translation, W yaw in degrees (unwound).
+	*  Empty when the AnimSequence has no root motion or bBakeRootMotion is disabled */
+	UPROPERTY(VisibleAnywhere, Category = Default)
+	TArray<FVector4f> RootMotion;
+};
+
+/* Socket resolved once with UMyAnimToTextureDataAsset::ResolveSocket, queries with it skip the name lookups */
+USTRUCT(BlueprintType)
+struct FVATSocketHandle
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = Default)
+	FName SocketName;
+
+	/* Socket track in every AnimSequence, INDEX_NONE where the socket was not baked */
+	UPROPERTY()
+	TArray<int32> AnimTracks;
+
+	/* DataAsset the tracks were resolved from. Native only: Blueprints pass the handle back unchanged */
+	TWeakObjectPtr<const UMyAnimToTextureDataAsset> DataAsset;
+
+	bool IsValid() const { return DataAsset.IsValid() && !AnimTracks.IsEmpty(); }
+};
+
+/* Skinned position error of an AnimSequence, Bone or Vertex, measured by the bake */
+USTRUCT(Blueprintable)
+struct FAnim2TextureErrorInfo
+{
+	GENERATED_BODY()
+
+	/* AnimSequence or Bone name, None for Vertices */
+	UPROPERTY(VisibleAnywhere, Category = Default, BlueprintReadOnly)
+	FName Name;
+
+	UPROPERTY(VisibleAnywhere, Category = Default, BlueprintReadOnly, Meta = (DisplayName = "Max Error (cm)"))
+	float MaxError = 0.f;
+
+	UPROPERTY(VisibleAnywhere, Category = Default, BlueprintReadOnly, Meta = (DisplayName = "RMS Error (cm)"))
+	float RMSError = 0.f;
 };
 
 
@@ -139,6 +270,13 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "StaticMesh", Meta = (DisplayName = "LODIndex"))
 	int32 StaticLODIndex = 0;
 
+	/**
+	* Also bakes Skin Weights and Bone Id UVs into every other StaticMesh LOD, against the same Bone Textures.
+	* Each LOD gets its own mapping to the SkeletalMesh LOD, so distant instances render the cheaper LODs.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "StaticMesh", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
+	bool bBakeAllStaticMeshLODs = false;
+
 	/**
 	* StaticMesh UVChannel Index for storing vertex information.
 	* Make sure this index does not conflict with the Lightmap UV Index.
@@ -163,6 +301,14 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "StaticMesh|Mapping")
 	float Sigma = 1.f;
 
+	/**
+	* Weld Threshold
+	* StaticMesh vertices closer than this distance will share the same SkinWeights.
+	* Zero will only merge vertices with exactly the same position.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "StaticMesh|Mapping", meta = (ClampMin = "0.0"))
+	float WeldThreshold = 0.f;
+
 	// ------------------------------------------------------
 	// Texture
 
@@ -177,6 +323,8 @@ public:
 
 	/**
 	* Texture Precision
+	* HalfFloat Positions keep their relative precision however large the Bounding Box is (e.g. root motion), they require Global PositionRangeMode.
+	* HalfFloat Rotations and Normals are still normalized to [0-1].
 	*/
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture")
 	EAnim2TexturePrecision PositionPrecision = EAnim2TexturePrecision::SixteenBits;
@@ -184,6 +332,78 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture")
 	EAnim2TexturePrecision RotationPrecision = EAnim2TexturePrecision::SixteenBits;
 
+	/**
+	* Bone Rotation Format
+	* AxisAngle: 4 channels with RotationPrecision bits each.
+	* Quaternion: smallest-three quaternion, 32 bits per texel and less than 0.25 degree error. RotationPrecision is ignored.
+	* DualQuaternion: whole Bone transform in the Bone Position Texture, read with VATDualQuaternion.ush. RotationPrecision is ignored.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
+	EAnim2TextureRotationFormat RotationFormat = EAnim2TextureRotationFormat::AxisAngle;
+
+	/**
+	* Position Quantization Range
+	* Global: positions are normalized with one bounding box, small-motion bones lose most of their precision.
+	* PerElement: each bone (or vertex) is normalized with its own bounding box, which is stored in two extra rows.
+	*             Usually allows EightBits PositionPrecision at the same error.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture")
+	EAnim2TextureRangeMode PositionRangeMode = EAnim2TextureRangeMode::Global;
+
+	/**
+	* Overrides PositionPrecision, PositionRangeMode, RotationFormat and RotationPrecision with the cheapest encoding
+	* whose max skinned position error stays under PositionErrorBudget (or the most accurate one if none does).
+	* Every encoding is measured by reconstructing the StaticMesh from quantized texels, which adds a sampling pass to the bake.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture")
+	bool bSelectPrecisionFromErrorBudget = false;
+
+	/* Max skinned position error allowed, in centimetres */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "bSelectPrecisionFromErrorBudget", EditConditionHides, ClampMin = "0.0", Units = "Centimeters"))
+	float PositionErrorBudget = 0.1f;
+
+	/**
+	* Frames whose texels are identical to an already stored frame (holds, idle loops, sequences baked twice) are stored once.
+	* FrameRemap translates animation frames to the frames stored in the textures.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "!bUseTextureArray"))
+	bool bRemoveDuplicateFrames = false;
+
+	/**
+	* Bake Bone Textures into Texture2DArrays, so animations are not limited by MaxHeight.
+	* Animations are packed in slices of MaxHeight at most, each slice has its own RefPose and lookup frames.
+	* The slice is the integer part of the frame sent to the material.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
+	bool bUseTextureArray = false;
+
+	/**
+	* Only bake the Bones that influence the StaticMesh vertices (and BoneOrSocketsOfInterest) in the Bone Textures.
+	* Twist helpers, IK targets and end bones get no column, the Bone Ids in the UVs are remapped to the baked Bones.
+	* DataAssets using this one as AnimationLibrary fail to bake if their vertices are influenced by a stripped Bone.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
+	bool bStripUnusedBones = false;
+
+	/**
+	* Vertex Mode always bakes the Morph Targets driven by the animation curves.
+	* Bone Mode bakes them to MorphDeltaTexture: the RefPose delta of every vertex moved by a Morph Target, per frame,
+	* added to the vertex before skinning (VATMorphTargets.ush). Vertices get their slot in MorphUVChannel.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
+	bool bBakeMorphTargets = false;
+
+	/* StaticMesh UVChannel Index for storing the Morph slot of every vertex. Must not overlap the Bone Id UVChannels */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone && bBakeMorphTargets", EditConditionHides))
+	int32 MorphUVChannel = 3;
+
+	/**
+	* Texture for storing Morph Target deltas (HalfFloat)
+	* This is only used on Bone Mode with bBakeMorphTargets
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone && bBakeMorphTargets", EditConditionHides))
+	TSoftObjectPtr<UTexture2D> MorphDeltaTexture;
+
 	/**
 	* Storage Mode.
 	* Vertex: will store per-vertex position and normal.
@@ -207,6 +427,38 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Vertex", EditConditionHides))
 	TSoftObjectPtr<UTexture2D> VertexNormalTexture;
 
+	/**
+	* Compresses Vertex frames with PCA: the Position and Normal Textures store a few basis frames (mean and principal components),
+	* VertexCoefficientTexture stores the weight of every basis per frame. Reconstructed with VATVertexPCA.ush.
+	* Uses the fewest components whose max position error stays under VertexCompressionErrorBudget.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Vertex", EditConditionHides))
+	bool bCompressVertexFrames = false;
+
+	/* Max position error of the compressed frames decoded from the texels, in centimetres */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Vertex && bCompressVertexFrames", EditConditionHides, ClampMin = "0.0", Units = "Centimeters"))
+	float VertexCompressionErrorBudget = 0.1f;
+
+	/* Max principal components, the mean frame is always stored on top of them */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Vertex && bCompressVertexFrames", EditConditionHides, ClampMin = "1", ClampMax = "256"))
+	int32 MaxVertexComponents = 32;
+
+	/**
+	* Texture for storing the per-frame PCA coefficients
+	* This is only used on Vertex Mode with bCompressVertexFrames
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Vertex && bCompressVertexFrames", EditConditionHides))
+	TSoftObjectPtr<UTexture2D> VertexCoefficientTexture;
+
+	/**
+	* Bone Textures only depend on the Skeleton and the AnimSequences, so meshes of the same Skeleton can share them.
+	* When set, Bone Textures, AnimSequences and their GeneratedInfo are taken from this (already baked) DataAsset,
+	* and only the Skin Weights of this StaticMesh are baked. Both SkeletalMeshes need the same Bones.
+	* Rebake the DataAssets using a Library after rebaking the Library: until then their proxies are not rendered (see IsAnimationLibraryUpToDate).
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
+	TSoftObjectPtr<UMyAnimToTextureDataAsset> AnimationLibrary;
+
 	/**
 	* Texture for storing bone positions
 	* This is only used on Bone Mode
@@ -221,6 +473,35 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
 	TSoftObjectPtr<UTexture2D> BoneRotationTexture;
 
+	/**
+	* Texture Arrays for storing bone positions and rotations
+	* This is only used on Bone Mode with bUseTextureArray
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone && bUseTextureArray", EditConditionHides))
+	TSoftObjectPtr<UTexture2DArray> BonePositionTextureArray;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone && bUseTextureArray", EditConditionHides))
+	TSoftObjectPtr<UTexture2DArray> BoneRotationTextureArray;
+
+	/**
+	* Only keep the Texture Array slices (pages) of animations played by live proxies in memory.
+	* Each slice is also baked to a Texture2D page next to the Texture Arrays, pages are streamed into MaxResidentTexturePages slots
+	* of transient Texture Arrays which are bound to the Materials at runtime. See VATTexturePageStreaming.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture|Streaming", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone && bUseTextureArray", EditConditionHides))
+	bool bStreamTexturePages = false;
+
+	/* Number of pages resident at once, including the page of the fallback animation */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture|Streaming", meta = (EditCondition = "bStreamTexturePages", EditConditionHides, ClampMin = "2"))
+	int32 MaxResidentTexturePages = 4;
+
+	/**
+	* Animation sampled (at its first frame) while the page of a proxy's animation is streamed in. Its page is always resident.
+	* -1 samples the RefPose of the first page instead.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Texture|Streaming", meta = (EditCondition = "bStreamTexturePages", EditConditionHides, ClampMin = "-1"))
+	int32 StreamingFallbackAnimIndex = INDEX_NONE;
+
 
 	// ------------------------------------------------------
 	// Animation
@@ -239,9 +520,39 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Animation", meta = (EditCondition = "Mode == EAnim2TextureMode::Bone"))
 	FName AttachToSocket;
 
+	/* Default SampleRate, AnimSequences can override it */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Animation")
 	float SampleRate = 30.0f;
 
+	/**
+	* Blend between the two texture frames around the current time instead of sampling the nearest one.
+	* Gives the same motion quality at about half the SampleRate, at the cost of twice the texture fetches.
+	* The Material needs InterpolateFrames enabled (set by UpdateMaterialInstanceFromDataAsset).
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Animation")
+	bool bInterpolateFrames = false;
+
+	/**
+	* Frames per bounding box of FAnim2TextureAnimInfo::FrameRangeBounds, so the large motion of a few frames
+	* (attacks, deaths) only inflates the bounds of those frames. Zero only bakes one bounding box per animation.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Animation", meta = (ClampMin = "0"))
+	int32 BoundsFramesPerRange = 0;
+
+	/**
+	* AnimSequences with EnableRootMotion are baked with their root locked (RootMotionRootLock), their root motion
+	* (translation and yaw) is stored per frame in FAnim2TextureAnimInfo::RootMotion. UVATInstancedProxyComponent::RootMotionMode consumes it.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Animation")
+	bool bBakeRootMotion = false;
+
+	/**
+	* Frames between two baked transforms of BoneOrSocketsOfInterest. Socket queries always interpolate between them,
+	* slow or smooth sockets can be stored at a fraction of the texture SampleRate.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Animation", meta = (ClampMin = "1"))
+	int32 SocketFramesPerKey = 1;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Animation")
 	TArray<FAnim2TextureAnimSequenceInfo> AnimSequences;
 
@@ -264,10 +575,22 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo")
 	int32 NumFrames = 0;
 
-	/* Total Number of Bones */
+	/* New on every bake of the animation textures */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo")
+	FGuid BakeGuid;
+
+	/* BakeGuid of the AnimationLibrary its GeneratedInfo was copied from. A rebaked Library no longer matches it */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
+	FGuid AnimationLibraryBakeGuid;
+
+	/* Number of Bones in the Bone Textures */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
 	int32 NumBones = 0;
 
+	/* Raw Bone index of every Bone Texture column, baked with bStripUnusedBones. Empty when all Bones are baked */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (EditCondition = "bStripUnusedBones", EditConditionHides))
+	TArray<int32> BakedBones;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (EditCondition = "Mode == EAnim2TextureMode::Vertex", EditConditionHides))
 	int32 VertexRowsPerFrame = 1;
 
@@ -277,6 +600,10 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (DisplayName = "SizeBBox", EditCondition = "Mode == EAnim2TextureMode::Vertex", EditConditionHides))
 	FVector3f VertexSizeBBox;
 
+	/* Basis stored in the Vertex Textures by bCompressVertexFrames, mean included. Zero when frames are stored as they are */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (EditCondition = "Mode == EAnim2TextureMode::Vertex && bCompressVertexFrames", EditConditionHides))
+	int32 NumVertexBasis = 0;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
 	int32 BoneWeightRowsPerFrame = 1;
 
@@ -289,9 +616,85 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (DisplayName = "SizeBBox", EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
 	FVector3f BoneSizeBBox;
 
+	/* Dual parts of DualQuaternion Bones are stored as Dual / (2 * BoneDualQuaternionScale) + 0.5 */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (EditCondition = "RotationFormat == EAnim2TextureRotationFormat::DualQuaternion", EditConditionHides))
+	float BoneDualQuaternionScale = 0.f;
+
+	/* Vertices with a slot in MorphDeltaTexture. Zero when no Morph Target moves the StaticMesh */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (EditCondition = "bBakeMorphTargets", EditConditionHides))
+	int32 NumMorphVertices = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (EditCondition = "bBakeMorphTargets", EditConditionHides))
+	int32 MorphRowsPerFrame = 1;
+
+	/* Number of unique animation frames stored in the textures. Only valid when FrameRemap is not empty */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo")
+	int32 NumUniqueFrames = 0;
+
+	/* Animation Frame -> Texture Frame. Empty when frames are stored as they are */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo")
+	TArray<int32> FrameRemap;
+
+	/* Number of Texture Array slices. Zero when baked to a Texture2D */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo")
+	int32 NumTextureSlices = 0;
+
+	/* Number of animation frames in each Texture Array slice, including padding */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (EditCondition = "NumTextureSlices > 0", EditConditionHides))
+	int32 NumSliceFrames = 0;
+
+	/* Number of lookup frames stored after the RefPose frame (e.g. PerElement quantization ranges) */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo")
+	int32 NumLookupFrames = 0;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo")
 	TArray<FAnim2TextureAnimInfo> Animations;
 
+	/* One Texture2D per Texture Array slice, baked with bStreamTexturePages */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (EditCondition = "bStreamTexturePages", EditConditionHides))
+	TArray<TSoftObjectPtr<UTexture2D>> BonePositionTexturePages;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GeneratedInfo", Meta = (EditCondition = "bStreamTexturePages", EditConditionHides))
+	TArray<TSoftObjectPtr<UTexture2D>> BoneRotationTexturePages;
+
+#if WITH_EDITORONLY_DATA
+	/* Memory used by the last bake: pixel buffers and their copies in the texture sources, per-frame scratch buffers,
+	*  the StaticMesh -> SkeletalMesh Mapping and Skin Weights. Engine allocations (skinning, texture compression) are not counted */
+	UPROPERTY(VisibleAnywhere, Category = "GeneratedInfo", Meta = (DisplayName = "Peak Bake Memory (MB)"))
+	float BakePeakMemoryMB = 0.f;
+
+	/* Max angular error of the baked Bone Rotations, measured by decoding the texels */
+	UPROPERTY(VisibleAnywhere, Category = "GeneratedInfo", Meta = (DisplayName = "Max Rotation Error (Degrees)", EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
+	float MaxRotationErrorDegrees = 0.f;
+
+	/* Error of the positions reconstructed from the texels (StaticMesh vertices skinned with the decoded bones in Bone Mode)
+	*  against the unquantized ones, over all baked frames */
+	UPROPERTY(VisibleAnywhere, Category = "GeneratedInfo|Error", Meta = (DisplayName = "Max Position Error (cm)"))
+	float MaxPositionError = 0.f;
+
+	UPROPERTY(VisibleAnywhere, Category = "GeneratedInfo|Error", Meta = (DisplayName = "RMS Position Error (cm)"))
+	float RMSPositionError = 0.f;
+
+	UPROPERTY(VisibleAnywhere, Category = "GeneratedInfo|Error")
+	TArray<FAnim2TextureErrorInfo> AnimationErrors;
+
+	/* Vertices are attributed to the Bone with the highest weight */
+	UPROPERTY(VisibleAnywhere, Category = "GeneratedInfo|Error", Meta = (EditCondition = "Mode == EAnim2TextureMode::Bone", EditConditionHides))
+	TArray<FAnim2TextureErrorInfo> BoneErrors;
+
+	UPROPERTY(VisibleAnywhere, AdvancedDisplay, Category = "GeneratedInfo|Error")
+	TArray<FAnim2TextureErrorInfo> VertexErrors;
+
+	/* Bounding box of every baked Bone position, per frame range (or animation) and Bone.
+	*  DataAssets using this one as AnimationLibrary bound their own vertices with it */
+	UPROPERTY()
+	TArray<FBox3f> BoneRangeBounds;
+
+	/* Vertices of every StaticMesh LOD baked by the last bake, by LOD index. Zero for the LODs that were not baked */
+	UPROPERTY(VisibleAnywhere, Category = "GeneratedInfo", Meta = (DisplayName = "Baked LOD Vertices"))
+	TArray<int32> BakedLODNumVertices;
+#endif
+
 	/* Finds AnimSequence Index in the Animations Array. 
 	*  Only Enabled elements are returned.
 	*  Returns -1 if not found.
@@ -300,22 +703,97 @@ public:
 	int32 GetIndexFromAnimSequence(const UAnimSequence* Sequence);
 
 
+	/* Number of animation frames stored in the textures (or in each slice), the RefPose frame follows them */
+	int32 GetNumStoredFrames() const { return FrameRemap.Num() ? NumUniqueFrames : (NumTextureSlices ? NumSliceFrames : NumFrames); }
+
+	/* Number of frames the Position and Rotation Textures (or each slice) are divided in: stored animation frames, RefPose and lookup frames */
+	int32 GetNumTextureFrames() const { return GetNumStoredFrames() + 1 + NumLookupFrames; }
+
+	/* Range the Material denormalizes Positions with (MinBBox + Texel * SizeBBox). HalfFloat Positions are not normalized: Min 0, Size 1 */
+	FVector3f GetMaterialMinBBox() const
+	{
+		return PositionPrecision == EAnim2TexturePrecision::HalfFloat ? FVector3f::ZeroVector : (Mode == EAnim2TextureMode::Vertex ? VertexMinBBox : BoneMinBBox);
+	}
+	FVector3f GetMaterialSizeBBox() const
+	{
+		return PositionPrecision == EAnim2TexturePrecision::HalfFloat ? FVector3f::OneVector : (Mode == EAnim2TextureMode::Vertex ? VertexSizeBBox : BoneSizeBBox);
+	}
+
+	/* Texels of a Bone frame in the Bone Position Texture: DualQuaternion stores Real and Dual parts of each Bone */
+	int32 GetNumBoneTexels() const { return RotationFormat == EAnim2TextureRotationFormat::DualQuaternion ? NumBones * 2 : NumBones; }
+
+	/* Frames per second of a baked animation */
+	float GetAnimSampleRate(const FAnim2TextureAnimInfo& AnimInfo) const { return AnimInfo.SampleRate > 0.f ? AnimInfo.SampleRate : SampleRate; }
+
+	/* Translates an animation frame (as in Animations) to the frame it is stored at in the textures */
+	int32 GetStoredFrame(int32 Frame) const { return FrameRemap.Num() ? FrameRemap[Frame] : Frame; }
+
+	/**
+	* Texture frame of an animation at AnimTime, as sent to the material. It is relative to the TextureSlice of the animation.
+	* With bInterpolateFrames the fractional part is the blend weight towards the next texture frame,
+	* otherwise it only keeps the nearest sampling away from the previous frame.
+	*/
+	float GetTextureFrame(const FAnim2TextureAnimInfo& AnimInfo, float AnimTime) const;
+
+	/**
+	* Local bounds of the StaticMesh playing an animation at AnimTime: the bounds of its frame range, or of the whole animation.
+	* Also covers the next frame, which is blended with bInterpolateFrames. Invalid if the animation bounds were not baked.
+	*/
+	FBox GetAnimationBounds(const FAnim2TextureAnimInfo& AnimInfo, float AnimTime) const;
+
+	/* Baked root motion of an animation at AnimTime, relative to its first frame. Identity without root motion */
+	FTransform GetRootMotionTransform(const FAnim2TextureAnimInfo& AnimInfo, float AnimTime) const;
+
+	/* Root motion between StartTime and EndTime, relative to the root at StartTime (as UAnimSequenceBase::ExtractRootMotionFromRange) */
+	FTransform ExtractRootMotion(const FAnim2TextureAnimInfo& AnimInfo, float StartTime, float EndTime) const;
+
+	/* False when the AnimationLibrary was rebaked after this DataAsset copied its Animations, FrameRemap and ranges:
+	*  they no longer match the Library textures, rebake this DataAsset. True without AnimationLibrary */
+	bool IsAnimationLibraryUpToDate() const;
+
+	/* Whether the Texture Array slices are streamed as pages instead of binding the whole Texture Arrays */
+	bool IsStreamingTexturePages() const;
+
+	/* Page that stays resident while any page of this DataAsset is streamed: the one of StreamingFallbackAnimIndex */
+	int32 GetFallbackTexturePage() const;
+
+	/* Texture frame sampled in the fallback page while a page is streamed in, relative to the slice like GetTextureFrame */
+	float GetFallbackTextureFrame() const;
+
 	bool DoesSocketExist(FName InSocketName) const;
 
 	void QuerySupportedSockets(TArray<FComponentSocketDescription>& OutSockets) const;
 
+	/* Socket track of InSocketName in the AnimSequence, INDEX_NONE if it is not one of its BoneOrSocketsOfInterest */
+	int32 FindSocketTrack(FName InSocketName, int32 AnimIndex) const;
+
+	/* Component Space Transform of a baked socket at AnimTime, interpolated between its keys */
 	bool GetSocketTransform(FName InSocketName, int32 AnimIndex, float AnimTime, FTransform& ComponentSpaceOut) const;
 
+	/* Resolves the socket tracks of every AnimSequence once, for the batched queries of UVATInstancedProxyComponent::GetSocketWorldTransforms */
+	UFUNCTION(BlueprintCallable, Category = Default)
+	FVATSocketHandle ResolveSocket(FName InSocketName) const;
+
+	/* GetSocketTransform without name lookups. False if the socket was not baked for AnimIndex or Socket belongs to another DataAsset */
+	bool GetSocketTransform(const FVATSocketHandle& Socket, int32 AnimIndex, float AnimTime, FTransform& ComponentSpaceOut) const;
+
 	UFUNCTION()
 	void ResetInfo();
 
+	virtual void PostLoad() override;
+
 	
 	UStaticMesh* GetStaticMesh() const;
 	USkeletalMesh* GetSkeletalMesh() const;
 	UTexture2D* GetVertexPositionTexture() const;
 	UTexture2D* GetVertexNormalTexture() const;
+	UTexture2D* GetVertexCoefficientTexture() const;
 	UTexture2D* GetBonePositionTexture() const;
 	UTexture2D* GetBoneRotationTexture() const; 
+	UTexture2D* GetMorphDeltaTexture() const;
+	UMyAnimToTextureDataAsset* GetAnimationLibrary() const;
+	UTexture2DArray* GetBonePositionTextureArray() const;
+	UTexture2DArray* GetBoneRotationTextureArray() const;
 
 	UFUNCTION(BlueprintPure, Category = Default, meta = (DisplayName = "Get Static Mesh"))
 	UStaticMesh* BP_GetStaticMesh() { return GetStaticMesh(); }
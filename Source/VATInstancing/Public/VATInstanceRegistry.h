@@ -33,6 +33,9 @@ namespace VATInstanceRegistry
 	/** Changes the batch key for an existing proxy. */
 	void NotifyProxyBatchKeyChanged(UObject* WorldContextObject, FVATProxyId ProxyId, const FBatchKey& NewBatchKey);
 
+	/** Updates the local bounds of an existing proxy. */
+	void NotifyProxyBoundsChanged(UObject* WorldContextObject, FVATProxyId ProxyId, const FBox& NewLocalBounds);
+
 	// --- Internal Functions (for Renderers to register/unregister themselves) ---
 
 	/**
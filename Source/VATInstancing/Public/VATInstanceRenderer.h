@@ -35,6 +35,7 @@ public:
 	virtual void UnregisterProxy(FVATProxyId ProxyId) override;
 	virtual void UpdateProxyVisuals(FVATProxyId ProxyId, const FTransform& NewTransform, const TArray<float>& NewCustomData) override;
 	virtual void UpdateProxyBatchKey(FVATProxyId ProxyId, const FBatchKey& NewBatchKey) override;
+	virtual void UpdateProxyBounds(FVATProxyId ProxyId, const FBox& NewLocalBounds) override;
 	//~ End IVATInstanceRendererInterface
 
 	virtual void DumpDebugInfo(FOutputDevice& Ar) const override;
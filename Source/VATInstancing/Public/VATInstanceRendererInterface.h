@@ -50,6 +50,14 @@ public:
 	 */
 	virtual void UpdateProxyBatchKey(FVATProxyId ProxyId, const FBatchKey& NewBatchKey) = 0;
 
+	/**
+	 * Updates the local bounds of a proxy, the bounds of the animations it plays.
+	 * Called when the played animations change, the instance is culled with them instead of the StaticMesh bounds.
+	 * @param ProxyId The unique ID of the proxy to update.
+	 * @param NewLocalBounds Bounds relative to the proxy transform. Invalid to use the StaticMesh bounds.
+	 */
+	virtual void UpdateProxyBounds(FVATProxyId ProxyId, const FBox& NewLocalBounds) = 0;
+
 	/**
 	 * Dumps the current state of the renderer to the output log for debugging purposes.
 	 * @param Ar The output device to write the log to.
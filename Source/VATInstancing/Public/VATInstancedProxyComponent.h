@@ -7,6 +7,7 @@
 #include "CustomDataRecord.h"
 #include "UObject/NameTypes.h"
 #include "Animation/AnimTypes.h"
+#include "MyAnimToTextureDataAsset.h"
 #include "VATInstancedProxyComponent.generated.h"
 
 class UPerInstanceCustomDataLayout;
@@ -19,6 +20,19 @@ DECLARE_STATS_GROUP(TEXT("VAT Instance Proxy"), STATGROUP_VATInstanceProxy, STAT
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnAnimPlayToEnd, UVATInstancedProxyComponent*, ProxyComp);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnAnimInterrupted, UVATInstancedProxyComponent*, ProxyComp);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnVATPoseChanged, UVATInstancedProxyComponent*);
+
+/* How the root motion baked with bBakeRootMotion is consumed */
+UENUM(BlueprintType)
+enum class EVATRootMotionMode : uint8
+{
+	/* Baked root motion is ignored */
+	Ignore,
+	/* Root motion accumulates until ConsumeRootMotion, for gameplay movement code */
+	Accumulate,
+	/* Root motion moves the owning Actor every tick (no sweep) */
+	ApplyToOwner,
+};
 
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
 class VATINSTANCING_API UVATInstancedProxyComponent : public USceneComponent
@@ -72,6 +86,31 @@ public:
 	// Helper to update CurrentVATCustomData based on animation state
 	void PopulateVATCustomData();
 
+	/**
+	* Local bounds of the StaticMesh over the animations currently played (both while blending), from the bounds baked per animation.
+	* They stay valid until the next PlayTexturedAnim, which is the only place the component and ISMC instance bounds are updated.
+	* Falls back to the StaticMesh bounds, which the bake only grows to every animation when no animation bounds were baked.
+	* Use GetAnimationBounds of the DataAsset for the current frame range.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "VAT Instancing")
+	FBox GetAnimatedLocalBounds() const;
+
+	//~ Begin USceneComponent Interface
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+	//~ End USceneComponent Interface
+
+	/* Component space transform of a resolved socket, Primary and Secondary blended with CurrentBlendAlpha like the material */
+	bool GetSocketTransform(const FVATSocketHandle& Socket, FTransform& ComponentSpaceOut) const;
+
+	/**
+	* World transforms of one resolved socket on many proxies, without name lookups. Proxies of another DataAsset,
+	* not playing or without the socket get Identity. With bParallel the proxies are split across task threads:
+	* call it from the game thread, after the proxies ticked.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "VAT Instancing")
+	static void GetSocketWorldTransforms(const FVATSocketHandle& Socket, const TArray<UVATInstancedProxyComponent*>& Proxies,
+		TArray<FTransform>& OutWorldTransforms, bool bParallel = false);
+
 	UFUNCTION(BlueprintCallable, Category = "VAT Instancing")
 	void SetMaterialForSlot(int32 SlotIndex, UMaterialInterface* NewMaterial);
 
@@ -98,6 +137,9 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "VAT Instancing|Events")
 	FOnAnimInterrupted OnAnimInterrupted;
 
+	/* Broadcast right after the animation state advanced or changed, so sockets are read without a frame of delay */
+	FOnVATPoseChanged OnPoseChanged;
+
 	bool bIsPlayingAnimation = false;
 
 	bool bIsBlending = false;
@@ -109,6 +151,21 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "VAT Instancing")
 	float PlayRate = 1.f;
 
+	/* Consumes the root motion of animations baked with bBakeRootMotion. Blended like the poses while blending */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "VAT Instancing")
+	EVATRootMotionMode RootMotionMode = EVATRootMotionMode::Ignore;
+
+	/* Root motion accumulated since the last call, in the local space of this component. Resets it */
+	UFUNCTION(BlueprintCallable, Category = "VAT Instancing")
+	FTransform ConsumeRootMotion();
+
+	/* Root motion of the animation(s) between their previous and current times, added to PendingRootMotion */
+	void AccumulateRootMotion(const AnimPlayState& PreviousPrimary, const AnimPlayState& PreviousSecondary, bool bWasBlending);
+
+	void ApplyRootMotionToOwner();
+
+	FTransform PendingRootMotion = FTransform::Identity;
+
 
 	int16 NextAnimIndexToPlayOnEnd;  //Index of animation to play when Primary Anim finishes
 	bool bTransitionToNextOnEnd;     //Flag to enable this auto-transition
@@ -119,7 +176,16 @@ public:
 	UPROPERTY(transient)
 	TArray<FAnimNotifyEvent> ActiveAnimNotifyStates;
 
-	float CalculateAbsoluteFrame(const FAnim2TextureAnimInfo* AnimInfo, float AnimTime, float SampleRate);
+	float CalculateAbsoluteFrame(const FAnim2TextureAnimInfo* AnimInfo, float AnimTime);
+
+	/** Texture pages (see VATTexturePageStreaming) of the Primary and Secondary animations, INDEX_NONE if none */
+	int32 ReferencedTexturePages[2] = { INDEX_NONE, INDEX_NONE };
+
+	/** A page is still streamed in, the fallback animation is sampled and CurrentVATCustomData is refreshed every tick until it arrives */
+	bool bWaitingForTexturePages = false;
+
+	void UpdateTexturePageRefs();
+	void ReleaseTexturePageRefs();
 
 	FORCEINLINE void UpdateRegistry() const;
 
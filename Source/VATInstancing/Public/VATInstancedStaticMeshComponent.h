@@ -0,0 +1,29 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "VATInstancedStaticMeshComponent.generated.h"
+
+/**
+ * ISMC of a render batch, bounded by the animation each instance plays (UVATInstancedProxyComponent::GetAnimatedLocalBounds)
+ * instead of the StaticMesh bounds. Instances without local bounds use the StaticMesh bounds.
+ */
+UCLASS(ClassGroup = Rendering)
+class VATINSTANCING_API UVATInstancedStaticMeshComponent : public UInstancedStaticMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	/* Local bounds of an instance, an invalid box falls back to the StaticMesh bounds */
+	void SetInstanceLocalBounds(int32 InstanceIndex, const FBox& LocalBounds);
+	FBox GetInstanceLocalBounds(int32 InstanceIndex) const;
+
+	//~ Begin UInstancedStaticMeshComponent Interface
+	virtual bool RemoveInstance(int32 InstanceIndex) override;
+	virtual FBoxSphereBounds CalcBounds(const FTransform& BoundTransform) const override;
+	//~ End UInstancedStaticMeshComponent Interface
+
+private:
+	// By instance index, like PerInstanceSMData. Shorter when the last instances have no local bounds
+	TArray<FBox> InstanceLocalBounds;
+};
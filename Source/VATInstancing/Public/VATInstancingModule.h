@@ -10,4 +10,7 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+private:
+	FDelegateHandle OnPostWorldCleanupHandle;
 };
\ No newline at end of file
@@ -11,9 +11,14 @@ namespace AnimToTextureParamNames
 	inline static const FName EndFrame = TEXT("EndFrame");
 	inline static const FName SampleRate = TEXT("SampleRate");
 	inline static const FName NumFrames = TEXT("NumFrames");
+	inline static const FName NumTextureFrames = TEXT("NumTextureFrames");
 	
+	// HalfFloat 位置贴图不归一化, 此时 MinBBox = 0, SizeBBox = 1 (GetMaterialMinBBox/GetMaterialSizeBBox)
 	inline static const FName MinBBox = TEXT("MinBBox");
 	inline static const FName SizeBBox = TEXT("SizeBBox");
+	// BoneId UV = (BoneId + 0.5) / NumBones. 骨骼数超过贴图宽度时每帧占RowsPerFrame行:
+	// BoneId = floor(UV * NumBones), Width = ceil(NumBones / RowsPerFrame), 列 = BoneId % Width, 行 = BoneId / Width. 见 Shaders/Private/VATBoneTexture.ush
+	// Content/Materials 的材质函数只支持 RowsPerFrame = 1, 烘焙时拒绝更宽的骨骼
 	inline static const FName NumBones = TEXT("NumBones");
 	inline static const FName RowsPerFrame = TEXT("RowsPerFrame");
 	inline static const FName BoneWeightRowsPerFrame = TEXT("BoneWeightsRowsPerFrame");
@@ -21,6 +26,8 @@ namespace AnimToTextureParamNames
 	inline static const FName VertexNormalTexture = TEXT("NormalTexture");
 	inline static const FName BonePositionTexture = TEXT("BonePositionTexture");
 	inline static const FName BoneRotationTexture = TEXT("BoneRotationTexture");
+	inline static const FName BonePositionTextureArray = TEXT("BonePositionTextureArray");
+	inline static const FName BoneRotationTextureArray = TEXT("BoneRotationTextureArray");
 	
 	// 从勾选的通道开始，使用1个或2个通道来储存BoneInfluence信息。
 	// 当UseBoneInfluenceTexture=true时，用1个通道储存BoneInfluenceTexture的采样UV。
@@ -30,6 +37,36 @@ namespace AnimToTextureParamNames
 	inline static const FName UseUV2 = TEXT("UseUV2");
 	inline static const FName UseUV3 = TEXT("UseUV3");
 	
+	// 每个骨骼(或顶点)的包围盒储存在RefPose之后的两帧: Min, Size (相对于MinBBox/SizeBBox归一化)
+	inline static const FName UsePerElementRanges = TEXT("UsePerElementRanges");
+
+	// BoneRotationTexture 储存smallest-three四元数, RGBA8 的32位按 10:10:10:2 拆分:
+	// a = R + (G%4)*256, b = G/4 + (B%16)*64, c = B/16 + (A%64)*16, 被丢弃分量的下标 = A/64. 见 Shaders/Private/VATQuaternion.ush
+	inline static const FName UseQuaternionRotation = TEXT("UseQuaternionRotation");
+
+	// BonePositionTexture 每个骨骼两个texel: Real * 0.5 + 0.5, Dual / (2 * DualQuaternionScale) + 0.5. 见 Shaders/Private/VATDualQuaternion.ush
+	inline static const FName UseDualQuaternion = TEXT("UseDualQuaternion");
+	inline static const FName DualQuaternionScale = TEXT("DualQuaternionScale");
+
+	// Vertex PCA: PositionTexture/NormalTexture 储存NumVertexBasis个基, 每个基占RowsPerFrame行, Basis = Texel * 2 - 1.
+	// VertexCoefficientTexture (HalfFloat) 每帧一行, 第k/2个texel: k为偶数时 RG, 奇数时 BA (位置系数, 法线系数). 见 Shaders/Private/VATVertexPCA.ush
+	inline static const FName UseVertexPCA = TEXT("UseVertexPCA");
+	inline static const FName NumVertexBasis = TEXT("NumVertexBasis");
+	inline static const FName VertexCoefficientTexture = TEXT("VertexCoefficientTexture");
+
+	// Bone模式的Morph Target: MorphUVChannel.x = (Slot + 0.5) / NumMorphVertices, 不受影响的顶点为 -1.
+	// MorphDeltaTexture (HalfFloat) 列 = Slot % Width, 行 = Frame * MorphRowsPerFrame + Slot / Width, 蒙皮前加到顶点上. 见 Shaders/Private/VATMorphTargets.ush
+	inline static const FName UseMorphTargets = TEXT("UseMorphTargets");
+	inline static const FName NumMorphVertices = TEXT("NumMorphVertices");
+	inline static const FName MorphRowsPerFrame = TEXT("MorphRowsPerFrame");
+	inline static const FName MorphDeltaTexture = TEXT("MorphDeltaTexture");
+
+	// 在相邻两帧之间插值: F = UV.y * NumTextureFrames, Row = floor(F + 1e-3), Alpha = saturate(F - Row), 采样Row与Row+1
+	inline static const FName InterpolateFrames = TEXT("InterpolateFrames");
+
+	// 使用Texture2DArray: Frame的整数部分是Slice, 小数部分是该Slice内的UV.y. 每个Slice都有自己的RefPose与lookup帧
+	inline static const FName UseTextureArray = TEXT("UseTextureArray");
+
 	inline static const FName UseTwoInfluences = TEXT("UseTwoInfluences");
 	inline static const FName UseFourInfluences = TEXT("UseFourInfluences");
 };  // namespace AnimToTextureParamNames
@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include "VatiDefines.h"
+
+class UMaterialInstanceDynamic;
+class UMaterialInterface;
+class UMyAnimToTextureDataAsset;
+class UObject;
+class UWorld;
+
+/**
+ * Streams the Bone Texture Array slices ("pages") of DataAssets baked with bStreamTexturePages.
+ * 
+ * Live proxies reference the pages of the animations they sample. Referenced pages are loaded (one Texture2D per page)
+ * and copied into a slot of small transient Texture Arrays, which are the ones bound to the Materials.
+ * Unreferenced pages release their Texture2Ds at once, their slots are reused least recently used first.
+ * The page of the DataAsset's fallback animation is pinned in a slot and sampled while a page is streamed in.
+ * 
+ * Resident set size is reported by "stat VATTexturePages".
+ */
+namespace VATTexturePageStreaming
+{
+	/** Whether the pages of DataAsset are streamed instead of binding its whole Texture Arrays. */
+	VATINSTANCING_API bool IsStreamed(const UMyAnimToTextureDataAsset* DataAsset);
+
+	/** A proxy starts sampling Page. Streams it in if it is not resident. */
+	void AddPageRef(const UMyAnimToTextureDataAsset* DataAsset, int32 Page);
+
+	/** A proxy stops sampling Page. Unreferenced pages can be evicted by the next page streamed in. */
+	void ReleasePageRef(const UMyAnimToTextureDataAsset* DataAsset, int32 Page);
+
+	/** Slice of the resident Texture Arrays holding Page, INDEX_NONE while it is streamed in. */
+	int32 GetResidentSlot(const UMyAnimToTextureDataAsset* DataAsset, int32 Page);
+
+	/** Slice of the resident Texture Arrays holding the fallback page. */
+	int32 GetFallbackSlot(const UMyAnimToTextureDataAsset* DataAsset);
+
+	/** Sets the resident Texture Arrays of DataAsset on MID (global and first Material Layer parameters). */
+	VATINSTANCING_API void BindResidentTextures(const UMyAnimToTextureDataAsset* DataAsset, UMaterialInstanceDynamic* MID);
+
+	/** A MID of Material (outered to Outer) sampling the resident Texture Arrays, Material itself when DataAsset is not streamed. */
+	VATINSTANCING_API UMaterialInterface* GetStreamingMaterial(const UMyAnimToTextureDataAsset* DataAsset, UMaterialInterface* Material, UObject* Outer);
+
+	/** Frees the resident Texture Arrays of DataAssets no proxy references anymore. Bound to OnPostWorldCleanup by FVATInstancingModule. */
+	void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+
+}  // namespace VATTexturePageStreaming
@@ -2,13 +2,14 @@
 
 #include "CoreMinimal.h"
 #include "Components/SceneComponent.h"
+#include "MyAnimToTextureDataAsset.h"
 #include "VertexAnimSkeleton.generated.h"
 
 
 /* 挂载在对应的Actor上，并设置由哪个VATInstancedProxyComponent来驱动这个骨骼
  * GetSocketTransform是Lazy的，只要没有挂载物体，且没人询问，理论上没有开销。
  * 只有当主动调用时，才会根据VATInstancedProxyComponent的状态来计算对应骨骼的Transform。
- * (TODO:注意GetSocketTransform在ProxyComponent::UpdateAnimation的前还是后，是否会造成一帧的delay？)
+ * 不Tick: 有子组件挂在Socket上时，由Proxy动画推进后的OnPoseChanged更新子组件，因此没有一帧的延迟。
  */
 
 class UVATInstancedProxyComponent;
@@ -42,6 +43,24 @@ public:
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
-	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
-		
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void OnChildAttached(USceneComponent* ChildComponent) override;
+	virtual void OnChildDetached(USceneComponent* ChildComponent) override;
+
+private:
+	bool HasSocketAttachedChildren() const;
+
+	// 只有存在挂在Socket上的子组件时才监听Proxy的OnPoseChanged
+	void UpdatePoseChangedBinding();
+
+	void OnProxyPoseChanged(UVATInstancedProxyComponent* Proxy);
+
+	// Socket名只解析一次，DataAsset变化时重新解析
+	const FVATSocketHandle& GetSocketHandle(FName InSocketName) const;
+
+	mutable TMap<FName, FVATSocketHandle> SocketHandles;
+
+	TWeakObjectPtr<UVATInstancedProxyComponent> BoundProxy;
+	FDelegateHandle PoseChangedHandle;
 };
@@ -33,6 +33,8 @@ public class VATInstancing : ModuleRules
             {
                 "CoreUObject",
                 "Engine",
+                "RenderCore",
+                "RHI",
 			}
             );
     }
@@ -0,0 +1,189 @@
+﻿#include "AnimToTextureBounds.h"
+#include "BakingUtil.h"
+
+namespace AnimToTexture_Private
+{
+
+// Ranges of an animation of NumFrames, a single one when FramesPerRange is zero
+static int32 GetNumRanges(const int32 NumFrames, const int32 FramesPerRange)
+{
+	return FramesPerRange > 0 ? FMath::DivideAndRoundUp(NumFrames, FramesPerRange) : 1;
+}
+
+void FAnimationBoundsBuilder::Init(const UMyAnimToTextureDataAsset* DataAsset, const int32 InNumBones)
+{
+	check(DataAsset);
+
+	FramesPerRange = FMath::Max(0, DataAsset->BoundsFramesPerRange);
+	NumBones = InNumBones;
+
+	int32 NumRanges = 0;
+	AnimFirstRanges.Reset(DataAsset->Animations.Num());
+	for (const FAnim2TextureAnimInfo& AnimInfo : DataAsset->Animations)
+	{
+		AnimFirstRanges.Add(NumRanges);
+		NumRanges += GetNumRanges(AnimInfo.EndFrame - AnimInfo.StartFrame + 1, FramesPerRange);
+	}
+
+	RangeBounds.Init(FBox3f(ForceInit), NumRanges * FMath::Max(1, NumBones));
+	MorphExtents.Reset();
+}
+
+int32 FAnimationBoundsBuilder::GetRange(const int32 AnimIndex, const int32 SampleIndex) const
+{
+	return AnimFirstRanges[AnimIndex] + (FramesPerRange > 0 ? SampleIndex / FramesPerRange : 0);
+}
+
+void FAnimationBoundsBuilder::AddBoneFrame(const int32 AnimIndex, const int32 SampleIndex, const TArray<FVector3f>& BoneRefPositions, const TArray<FVector3f>& BonePositions)
+{
+	check(BonePositions.Num() == NumBones && BoneRefPositions.Num() == NumBones);
+
+	FBox3f* BoneBounds = &RangeBounds[GetRange(AnimIndex, SampleIndex) * NumBones];
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		BoneBounds[BoneIndex] += BoneRefPositions[BoneIndex] + BonePositions[BoneIndex];
+	}
+}
+
+void FAnimationBoundsBuilder::AddVertexFrame(const int32 AnimIndex, const int32 SampleIndex, const TArray<FVector3f>& Vertices, const TArray<FVector3f>& VertexDeltas)
+{
+	check(Vertices.Num() == VertexDeltas.Num());
+
+	FBox3f& Bounds = RangeBounds[GetRange(AnimIndex, SampleIndex)];
+	for (int32 VertexIndex = 0; VertexIndex < Vertices.Num(); ++VertexIndex)
+	{
+		Bounds += Vertices[VertexIndex] + VertexDeltas[VertexIndex];
+	}
+}
+
+void FAnimationBoundsBuilder::AddMorphDeltas(const TArray<int32>& VertexSlots, const TArray<FVector3f>& MorphDeltas)
+{
+	MorphExtents.SetNumZeroed(VertexSlots.Num());
+	for (int32 VertexIndex = 0; VertexIndex < VertexSlots.Num(); ++VertexIndex)
+	{
+		if (VertexSlots[VertexIndex] != INDEX_NONE)
+		{
+			MorphExtents[VertexIndex] = FMath::Max(MorphExtents[VertexIndex], MorphDeltas[VertexSlots[VertexIndex]].Length());
+		}
+	}
+}
+
+void FAnimationBoundsBuilder::GetBoneRadii(const TArray<FVector3f>& Vertices, const TArray<VertexSkinWeightFour>& SkinWeights, const int32 NumInfluences,
+	const TArray<FVector3f>& BoneRefPositions, TArray<float>& OutRadii) const
+{
+	check(Vertices.Num() == SkinWeights.Num());
+
+	OutRadii.Init(-1.f, BoneRefPositions.Num());
+	for (int32 VertexIndex = 0; VertexIndex < Vertices.Num(); ++VertexIndex)
+	{
+		const float MorphExtent = MorphExtents.IsValidIndex(VertexIndex) ? MorphExtents[VertexIndex] : 0.f;
+		for (int32 Influence = 0; Influence < NumInfluences; ++Influence)
+		{
+			if (SkinWeights[VertexIndex].BoneWeights[Influence] > 0)
+			{
+				const int32 BoneIndex = SkinWeights[VertexIndex].MeshBoneIndices[Influence];
+				OutRadii[BoneIndex] = FMath::Max(OutRadii[BoneIndex], FVector3f::Distance(Vertices[VertexIndex], BoneRefPositions[BoneIndex]) + MorphExtent);
+			}
+		}
+	}
+}
+
+// Union of the spheres of every Bone skinning a vertex, over the Bone bounds of a range
+static FBox3f GetSkinnedBounds(const FBox3f* BoneBounds, const TArray<float>& BoneRadii)
+{
+	FBox3f Bounds(ForceInit);
+	for (int32 BoneIndex = 0; BoneIndex < BoneRadii.Num(); ++BoneIndex)
+	{
+		if (BoneRadii[BoneIndex] >= 0.f && BoneBounds[BoneIndex].IsValid)
+		{
+			Bounds += BoneBounds[BoneIndex].ExpandBy(BoneRadii[BoneIndex]);
+		}
+	}
+	return Bounds;
+}
+
+void FAnimationBoundsBuilder::WriteRangeBounds(UMyAnimToTextureDataAsset* DataAsset, const TArray<FBox3f>& InRangeBounds)
+{
+	const int32 FramesPerRange = FMath::Max(0, DataAsset->BoundsFramesPerRange);
+
+	int32 Range = 0;
+	for (FAnim2TextureAnimInfo& AnimInfo : DataAsset->Animations)
+	{
+		const int32 NumRanges = GetNumRanges(AnimInfo.EndFrame - AnimInfo.StartFrame + 1, FramesPerRange);
+
+		AnimInfo.Bounds = FBox3f(ForceInit);
+		AnimInfo.FrameRangeBounds.Reset();
+		for (int32 AnimRange = 0; AnimRange < NumRanges; ++AnimRange, ++Range)
+		{
+			AnimInfo.Bounds += InRangeBounds[Range];
+			if (FramesPerRange > 0)
+			{
+				AnimInfo.FrameRangeBounds.Add(InRangeBounds[Range]);
+			}
+		}
+	}
+}
+
+void FAnimationBoundsBuilder::WriteBoneBounds(UMyAnimToTextureDataAsset* DataAsset, const TArray<FVector3f>& Vertices, const TArray<VertexSkinWeightFour>& SkinWeights,
+	const int32 NumInfluences, const TArray<FVector3f>& BoneRefPositions) const
+{
+	check(DataAsset && BoneRefPositions.Num() == NumBones);
+
+	TArray<float> BoneRadii;
+	GetBoneRadii(Vertices, SkinWeights, NumInfluences, BoneRefPositions, BoneRadii);
+
+	const int32 NumRanges = RangeBounds.Num() / FMath::Max(1, NumBones);
+	TArray<FBox3f> SkinnedRangeBounds;
+	SkinnedRangeBounds.SetNumUninitialized(NumRanges);
+	for (int32 Range = 0; Range < NumRanges; ++Range)
+	{
+		SkinnedRangeBounds[Range] = GetSkinnedBounds(&RangeBounds[Range * NumBones], BoneRadii);
+	}
+	WriteRangeBounds(DataAsset, SkinnedRangeBounds);
+
+#if WITH_EDITORONLY_DATA
+	DataAsset->BoneRangeBounds = RangeBounds;
+#endif
+}
+
+void FAnimationBoundsBuilder::WriteVertexBounds(UMyAnimToTextureDataAsset* DataAsset) const
+{
+	check(DataAsset);
+	WriteRangeBounds(DataAsset, RangeBounds);
+}
+
+bool FAnimationBoundsBuilder::WriteBoundsFromLibrary(UMyAnimToTextureDataAsset* DataAsset, const TArray<FVector3f>& Vertices, const TArray<VertexSkinWeightFour>& SkinWeights)
+{
+	const UMyAnimToTextureDataAsset* Library = DataAsset->GetAnimationLibrary();
+	check(Library);
+
+#if WITH_EDITORONLY_DATA
+	// Skinning uses the RefPose stored in the Library Bone Textures
+	TArray<FVector3f> BoneRefPositions;
+	TArray<FVector4f> BoneRefRotations_NoUse;
+	GetRefBonePositionsAndRotations(Library->GetSkeletalMesh(), BoneRefPositions, BoneRefRotations_NoUse);
+	if (!Library->BakedBones.IsEmpty())
+	{
+		CompactBoneFrame(Library->BakedBones, BoneRefPositions, BoneRefRotations_NoUse);
+	}
+
+	FAnimationBoundsBuilder Builder;
+	Builder.Init(DataAsset, Library->NumBones);
+	if (BoneRefPositions.Num() == Library->NumBones && Library->BoneRangeBounds.Num() == Builder.RangeBounds.Num())
+	{
+		Builder.RangeBounds = Library->BoneRangeBounds;
+		Builder.WriteBoneBounds(DataAsset, Vertices, SkinWeights, GetNumBoneInfluences(DataAsset), BoneRefPositions);
+		return true;
+	}
+#endif
+
+	// Bounds of the Library StaticMesh do not fit this one
+	for (FAnim2TextureAnimInfo& AnimInfo : DataAsset->Animations)
+	{
+		AnimInfo.Bounds = FBox3f(ForceInit);
+		AnimInfo.FrameRangeBounds.Reset();
+	}
+	return false;
+}
+
+} // end namespace AnimToTexture_Private
@@ -0,0 +1,497 @@
+﻿#include "AnimToTextureErrorAnalysis.h"
+#include "AnimToTextureUtils.h"
+#include "BakingUtil.h"
+#include "Algo/StableSort.h"
+#include "Animation/AnimSequence.h"
+
+namespace AnimToTexture_Private
+{
+
+FTextureEncoding FTextureEncoding::FromDataAsset(const UMyAnimToTextureDataAsset* DataAsset)
+{
+	FTextureEncoding Encoding;
+	Encoding.PositionPrecision = DataAsset->PositionPrecision;
+	Encoding.PositionRangeMode = DataAsset->PositionRangeMode;
+	Encoding.RotationFormat = DataAsset->RotationFormat;
+	Encoding.RotationPrecision = DataAsset->RotationPrecision;
+	return Encoding;
+}
+
+void FTextureEncoding::ApplyToDataAsset(UMyAnimToTextureDataAsset* DataAsset) const
+{
+	DataAsset->PositionPrecision = PositionPrecision;
+	DataAsset->PositionRangeMode = PositionRangeMode;
+	DataAsset->RotationFormat = RotationFormat;
+	DataAsset->RotationPrecision = RotationPrecision;
+}
+
+int32 FTextureEncoding::GetBytesPerElement(const EAnim2TextureMode Mode) const
+{
+	// RGBA texels
+	const int32 PositionBytes = PositionPrecision == EAnim2TexturePrecision::EightBits ? 4 : 8;
+	if (Mode == EAnim2TextureMode::Vertex)
+	{
+		return PositionBytes;
+	}
+
+	// Real and Dual texels, no Rotation Texture
+	if (RotationFormat == EAnim2TextureRotationFormat::DualQuaternion)
+	{
+		return PositionBytes * 2;
+	}
+
+	// Packed Quaternions always use 8 bits texels
+	const int32 RotationBytes = RotationFormat == EAnim2TextureRotationFormat::AxisAngle && RotationPrecision != EAnim2TexturePrecision::EightBits ? 8 : 4;
+	return PositionBytes + RotationBytes;
+}
+
+FString FTextureEncoding::ToString(const EAnim2TextureMode Mode) const
+{
+	auto PrecisionToString = [](const EAnim2TexturePrecision Precision)
+	{
+		switch (Precision)
+		{
+			case EAnim2TexturePrecision::EightBits:
+				return TEXT("8 bits");
+			case EAnim2TexturePrecision::HalfFloat:
+				return TEXT("16 bits float");
+			default:
+				return TEXT("16 bits");
+		}
+	};
+
+	FString String = FString::Printf(TEXT("%s %s Positions"), PrecisionToString(PositionPrecision),
+		PositionRangeMode == EAnim2TextureRangeMode::PerElement ? TEXT("PerElement") : TEXT("Global"));
+
+	if (Mode == EAnim2TextureMode::Bone && RotationFormat == EAnim2TextureRotationFormat::DualQuaternion)
+	{
+		return FString::Printf(TEXT("%s Dual Quaternions"), PrecisionToString(PositionPrecision));
+	}
+
+	if (Mode == EAnim2TextureMode::Bone)
+	{
+		String += RotationFormat == EAnim2TextureRotationFormat::Quaternion
+			? TEXT(", Quaternion Rotations")
+			: FString::Printf(TEXT(", %s AxisAngle Rotations"), PrecisionToString(RotationPrecision));
+	}
+	return String;
+}
+
+TArray<FTextureEncoding> GetCandidateEncodings(const UMyAnimToTextureDataAsset* DataAsset)
+{
+	const FTextureEncoding BaseEncoding = FTextureEncoding::FromDataAsset(DataAsset);
+
+	TArray<FTextureEncoding> Candidates;
+
+	// Dual Quaternions only have a precision, they are always in a Global range
+	if (DataAsset->Mode == EAnim2TextureMode::Bone && BaseEncoding.RotationFormat == EAnim2TextureRotationFormat::DualQuaternion)
+	{
+		for (const EAnim2TexturePrecision PositionPrecision : { EAnim2TexturePrecision::EightBits, EAnim2TexturePrecision::SixteenBits, EAnim2TexturePrecision::HalfFloat })
+		{
+			FTextureEncoding Encoding = BaseEncoding;
+			Encoding.PositionPrecision = PositionPrecision;
+			Encoding.PositionRangeMode = EAnim2TextureRangeMode::Global;
+			Candidates.Add(Encoding);
+		}
+		return Candidates;
+	}
+
+	for (const EAnim2TexturePrecision PositionPrecision : { EAnim2TexturePrecision::EightBits, EAnim2TexturePrecision::SixteenBits, EAnim2TexturePrecision::HalfFloat })
+	{
+		for (const EAnim2TextureRangeMode PositionRangeMode : { EAnim2TextureRangeMode::Global, EAnim2TextureRangeMode::PerElement })
+		{
+			// HalfFloat Positions are not normalized
+			if (PositionPrecision == EAnim2TexturePrecision::HalfFloat && PositionRangeMode == EAnim2TextureRangeMode::PerElement)
+			{
+				continue;
+			}
+
+			FTextureEncoding Encoding = BaseEncoding;
+			Encoding.PositionPrecision = PositionPrecision;
+			Encoding.PositionRangeMode = PositionRangeMode;
+
+			// Vertex Normals are not measured, RotationPrecision is kept
+			if (DataAsset->Mode == EAnim2TextureMode::Vertex)
+			{
+				Candidates.Add(Encoding);
+				continue;
+			}
+
+			Encoding.RotationFormat = EAnim2TextureRotationFormat::Quaternion;
+			Candidates.Add(Encoding);
+
+			Encoding.RotationFormat = EAnim2TextureRotationFormat::AxisAngle;
+			Encoding.RotationPrecision = EAnim2TexturePrecision::EightBits;
+			Candidates.Add(Encoding);
+
+			Encoding.RotationPrecision = EAnim2TexturePrecision::SixteenBits;
+			Candidates.Add(Encoding);
+		}
+	}
+
+	// 同样大小时，Global优先(不需要lookup帧)，Quaternion优先(误差比8位AxisAngle小)
+	Algo::StableSortBy(Candidates, [Mode = DataAsset->Mode](const FTextureEncoding& Encoding) { return Encoding.GetBytesPerElement(Mode); });
+	return Candidates;
+}
+
+// ----------------------------------------------------------------------------
+
+FPositionQuantizer::FPositionQuantizer(const FTextureEncoding& Encoding, const FVector3f& InMinBBox, const FVector3f& InSizeBBox,
+	const TArray<FVector3f>& ElementMinBBoxes, const TArray<FVector3f>& ElementMaxBBoxes)
+	: MinBBox(InMinBBox)
+	, SizeBBox(InSizeBBox)
+	, Precision(Encoding.PositionPrecision)
+{
+	// Same range as GetMaterialMinBBox / GetMaterialSizeBBox
+	if (Precision == EAnim2TexturePrecision::HalfFloat)
+	{
+		MinBBox = FVector3f::ZeroVector;
+		SizeBBox = FVector3f::OneVector;
+	}
+	else if (Encoding.PositionRangeMode == EAnim2TextureRangeMode::PerElement)
+	{
+		// Same ranges as the bake, they are stored exactly in the lookup frames
+		TArray<FVector3f> NormalizedMins_NoUse;
+		TArray<FVector3f> NormalizedSizes_NoUse;
+		QuantizeElementRanges(ElementMinBBoxes, ElementMaxBBoxes, MinBBox, SizeBBox, GetQuantizationSteps(Precision),
+			NormalizedMins_NoUse, NormalizedSizes_NoUse, ElementMins, ElementSizes);
+	}
+}
+
+static FVector3f QuantizePosition(const FVector3f& Position, const FVector3f& Min, const FVector3f& Size, const EAnim2TexturePrecision Precision)
+{
+	FVector3f Decoded = Min;
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		if (Size[Axis] > 0.f)
+		{
+			Decoded[Axis] += QuantizeChannel((Position[Axis] - Min[Axis]) / Size[Axis], Precision) * Size[Axis];
+		}
+	}
+	return Decoded;
+}
+
+FVector3f FPositionQuantizer::Decode(const FVector3f& Position, const int32 Element) const
+{
+	return ElementMins.IsEmpty()
+		? QuantizePosition(Position, MinBBox, SizeBBox, Precision)
+		: QuantizePosition(Position, ElementMins[Element], ElementSizes[Element], Precision);
+}
+
+FVector3f FPositionQuantizer::DecodeRefPose(const FVector3f& Position) const
+{
+	return QuantizePosition(Position, MinBBox, SizeBBox, Precision);
+}
+
+FQuat4f DecodeQuantizedRotation(const FVector4f& AxisAndAngle, const FTextureEncoding& Encoding)
+{
+	const FVector3f Axis = FVector3f(AxisAndAngle).GetSafeNormal();
+
+	if (Encoding.RotationFormat == EAnim2TextureRotationFormat::Quaternion)
+	{
+		return DecodeQuaternion(EncodeQuaternion(FQuat4f(Axis, AxisAndAngle.W)));
+	}
+
+	// Same normalization as NormalizeBoneFrame
+	auto Quantize = [Precision = Encoding.RotationPrecision](const float Value)
+	{
+		return QuantizeChannel(Value, Precision);
+	};
+
+	const FVector3f DecodedAxis(
+		Quantize(Axis.X * 0.5f + 0.5f) * 2.f - 1.f,
+		Quantize(Axis.Y * 0.5f + 0.5f) * 2.f - 1.f,
+		Quantize(Axis.Z * 0.5f + 0.5f) * 2.f - 1.f);
+	const float DecodedAngle = Quantize(AxisAndAngle.W / (2.f * PI)) * 2.f * PI;
+
+	return FQuat4f(DecodedAxis.GetSafeNormal(), DecodedAngle);
+}
+
+FVector3f SkinVertex(const FVector3f& Vertex, const VertexSkinWeightFour& SkinWeight, const int32 NumInfluences,
+	const TArray<FVector3f>& BoneRefPositions, const TArray<FVector3f>& BonePositions, const TArray<FQuat4f>& BoneRotations)
+{
+	FVector3f SkinnedVertex = FVector3f::ZeroVector;
+	float TotalWeight = 0.f;
+
+	for (int32 Influence = 0; Influence < NumInfluences; ++Influence)
+	{
+		const float Weight = SkinWeight.BoneWeights[Influence];
+		if (Weight > 0.f)
+		{
+			const int32 BoneIndex = SkinWeight.MeshBoneIndices[Influence];
+			const FVector3f& RefPosition = BoneRefPositions[BoneIndex];
+
+			SkinnedVertex += (BoneRotations[BoneIndex].RotateVector(Vertex - RefPosition) + RefPosition + BonePositions[BoneIndex]) * Weight;
+			TotalWeight += Weight;
+		}
+	}
+
+	return TotalWeight > 0.f ? SkinnedVertex / TotalWeight : Vertex;
+}
+
+FVector3f SkinVertexDualQuaternion(const FVector3f& Vertex, const VertexSkinWeightFour& SkinWeight, const int32 NumInfluences,
+	const TArray<FVector4f>& BoneReals, const TArray<FVector4f>& BoneDuals)
+{
+	FVector4f BlendedReal(0.f, 0.f, 0.f, 0.f);
+	FVector4f BlendedDual(0.f, 0.f, 0.f, 0.f);
+	FVector4f FirstReal(0.f, 0.f, 0.f, 0.f);
+	bool bHasFirst = false;
+
+	for (int32 Influence = 0; Influence < NumInfluences; ++Influence)
+	{
+		const float Weight = SkinWeight.BoneWeights[Influence];
+		if (Weight > 0.f)
+		{
+			const int32 BoneIndex = SkinWeight.MeshBoneIndices[Influence];
+			if (!bHasFirst)
+			{
+				FirstReal = BoneReals[BoneIndex];
+				bHasFirst = true;
+			}
+
+			// Antipodal Quaternions are the same rotation, blend them in the same hemisphere as the first one
+			const float Sign = Dot4(FirstReal, BoneReals[BoneIndex]) < 0.f ? -Weight : Weight;
+			BlendedReal += BoneReals[BoneIndex] * Sign;
+			BlendedDual += BoneDuals[BoneIndex] * Sign;
+		}
+	}
+
+	return bHasFirst ? TransformByDualQuaternion(BlendedReal, BlendedDual, Vertex) : Vertex;
+}
+
+// ----------------------------------------------------------------------------
+
+FQuantizationErrorAnalyzer::FQuantizationErrorAnalyzer(const FTextureEncoding& InEncoding, const FPositionQuantizer& InQuantizer, const int32 NumVertices, const int32 NumAnimations)
+	: Encoding(InEncoding)
+	, Quantizer(InQuantizer)
+{
+	AnimationErrors.SetNum(NumAnimations);
+	VertexErrors.SetNum(NumVertices);
+}
+
+void FQuantizationErrorAnalyzer::SetSkinning(const TArray<FVector3f>& InVertices, const TArray<VertexSkinWeightFour>& InSkinWeights, const int32 InNumInfluences,
+	const TArray<FVector3f>& InBoneRefPositions)
+{
+	check(InVertices.Num() == VertexErrors.Num() && InSkinWeights.Num() == VertexErrors.Num());
+
+	Vertices = &InVertices;
+	SkinWeights = &InSkinWeights;
+	BoneRefPositions = &InBoneRefPositions;
+	NumInfluences = FMath::Clamp(InNumInfluences, 1, 4);
+
+	DecodedBoneRefPositions.SetNumUninitialized(InBoneRefPositions.Num());
+	for (int32 BoneIndex = 0; BoneIndex < InBoneRefPositions.Num(); ++BoneIndex)
+	{
+		DecodedBoneRefPositions[BoneIndex] = Quantizer.DecodeRefPose(InBoneRefPositions[BoneIndex]);
+	}
+
+	VertexDominantBones.SetNumUninitialized(InSkinWeights.Num());
+	for (int32 VertexIndex = 0; VertexIndex < InSkinWeights.Num(); ++VertexIndex)
+	{
+		const VertexSkinWeightFour& SkinWeight = InSkinWeights[VertexIndex];
+
+		int32 DominantInfluence = 0;
+		for (int32 Influence = 1; Influence < NumInfluences; ++Influence)
+		{
+			if (SkinWeight.BoneWeights[Influence] > SkinWeight.BoneWeights[DominantInfluence])
+			{
+				DominantInfluence = Influence;
+			}
+		}
+		VertexDominantBones[VertexIndex] = SkinWeight.MeshBoneIndices[DominantInfluence];
+	}
+
+	BoneErrors.Reset();
+	BoneErrors.SetNum(InBoneRefPositions.Num());
+}
+
+void FQuantizationErrorAnalyzer::AddBoneFrame(const int32 AnimIndex, const TArray<FVector3f>& BonePositions, const TArray<FVector4f>& InBoneRotations)
+{
+	check(Vertices && BonePositions.Num() == InBoneRotations.Num());
+
+	const int32 NumBones = BonePositions.Num();
+	BoneRotations.SetNumUninitialized(NumBones);
+	DecodedBonePositions.SetNumUninitialized(NumBones);
+	DecodedBoneRotations.SetNumUninitialized(NumBones);
+
+	const bool bDualQuaternion = Encoding.RotationFormat == EAnim2TextureRotationFormat::DualQuaternion;
+	if (bDualQuaternion)
+	{
+		DecodedBoneReals.SetNumUninitialized(NumBones);
+		DecodedBoneDuals.SetNumUninitialized(NumBones);
+	}
+
+	// Same quantization as the Position Texture
+	auto QuantizeTexel = [Precision = Encoding.PositionPrecision](const FVector4f& Texel)
+	{
+		return FVector4f(QuantizeChannel(Texel.X, Precision), QuantizeChannel(Texel.Y, Precision), QuantizeChannel(Texel.Z, Precision), QuantizeChannel(Texel.W, Precision));
+	};
+
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		const FVector4f& Rotation = InBoneRotations[BoneIndex];
+		BoneRotations[BoneIndex] = FQuat4f(FVector3f(Rotation).GetSafeNormal(), Rotation.W);
+
+		if (bDualQuaternion)
+		{
+			FVector4f Real, Dual, RealTexel, DualTexel;
+			BoneToDualQuaternion((*BoneRefPositions)[BoneIndex], BonePositions[BoneIndex], Rotation, Real, Dual);
+			EncodeDualQuaternion(Real, Dual, DualQuaternionScale, RealTexel, DualTexel);
+			DecodeDualQuaternion(QuantizeTexel(RealTexel), QuantizeTexel(DualTexel), DualQuaternionScale, DecodedBoneReals[BoneIndex], DecodedBoneDuals[BoneIndex]);
+		}
+		else
+		{
+			DecodedBonePositions[BoneIndex] = Quantizer.Decode(BonePositions[BoneIndex], BoneIndex);
+			DecodedBoneRotations[BoneIndex] = DecodeQuantizedRotation(Rotation, Encoding);
+		}
+	}
+
+	for (int32 VertexIndex = 0; VertexIndex < Vertices->Num(); ++VertexIndex)
+	{
+		const FVector3f& Vertex = (*Vertices)[VertexIndex];
+		const VertexSkinWeightFour& SkinWeight = (*SkinWeights)[VertexIndex];
+
+		// Dual Quaternion blending also differs from linear blending on multi-influence vertices, that difference is part of the error
+		const FVector3f Reference = SkinVertex(Vertex, SkinWeight, NumInfluences, *BoneRefPositions, BonePositions, BoneRotations);
+		const FVector3f Decoded = bDualQuaternion
+			? SkinVertexDualQuaternion(Vertex, SkinWeight, NumInfluences, DecodedBoneReals, DecodedBoneDuals)
+			: SkinVertex(Vertex, SkinWeight, NumInfluences, DecodedBoneRefPositions, DecodedBonePositions, DecodedBoneRotations);
+
+		AddVertexError(AnimIndex, VertexIndex, FVector3f::Dist(Reference, Decoded));
+	}
+}
+
+void FQuantizationErrorAnalyzer::AddVertexFrame(const int32 AnimIndex, const TArray<FVector3f>& VertexDeltas)
+{
+	check(VertexDeltas.Num() == VertexErrors.Num());
+
+	for (int32 VertexIndex = 0; VertexIndex < VertexDeltas.Num(); ++VertexIndex)
+	{
+		const FVector3f& Delta = VertexDeltas[VertexIndex];
+		AddVertexError(AnimIndex, VertexIndex, FVector3f::Dist(Delta, Quantizer.Decode(Delta, VertexIndex)));
+	}
+}
+
+void FQuantizationErrorAnalyzer::AddVertexResiduals(const int32 AnimIndex, TArrayView<const FVector3f> VertexResiduals)
+{
+	check(VertexResiduals.Num() == VertexErrors.Num());
+
+	for (int32 VertexIndex = 0; VertexIndex < VertexResiduals.Num(); ++VertexIndex)
+	{
+		AddVertexError(AnimIndex, VertexIndex, VertexResiduals[VertexIndex].Size());
+	}
+}
+
+void FQuantizationErrorAnalyzer::AddVertexError(const int32 AnimIndex, const int32 VertexIndex, const float Error)
+{
+	TotalError.Add(Error);
+	AnimationErrors[AnimIndex].Add(Error);
+	VertexErrors[VertexIndex].Add(Error);
+
+	if (!BoneErrors.IsEmpty())
+	{
+		BoneErrors[VertexDominantBones[VertexIndex]].Add(Error);
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+FBoneErrorBound::FBoneErrorBound(const FTextureEncoding& InEncoding, const FPositionQuantizer& InQuantizer,
+	const TArray<FVector3f>& Vertices, const TArray<VertexSkinWeightFour>& SkinWeights, const int32 NumInfluences,
+	const TArray<FVector3f>& BoneRefPositions)
+	: Encoding(InEncoding)
+	, Quantizer(InQuantizer)
+{
+	check(Encoding.RotationFormat != EAnim2TextureRotationFormat::DualQuaternion);
+
+	const int32 NumBones = BoneRefPositions.Num();
+	BoneReaches.Init(-1.f, NumBones);
+	RefPoseErrors.SetNumUninitialized(NumBones);
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		RefPoseErrors[BoneIndex] = FVector3f::Dist(BoneRefPositions[BoneIndex], Quantizer.DecodeRefPose(BoneRefPositions[BoneIndex]));
+	}
+
+	// Same influences as SkinVertex
+	const int32 UsedInfluences = FMath::Clamp(NumInfluences, 1, 4);
+	for (int32 VertexIndex = 0; VertexIndex < Vertices.Num(); ++VertexIndex)
+	{
+		const VertexSkinWeightFour& SkinWeight = SkinWeights[VertexIndex];
+		for (int32 Influence = 0; Influence < UsedInfluences; ++Influence)
+		{
+			if (SkinWeight.BoneWeights[Influence] > 0)
+			{
+				const int32 BoneIndex = SkinWeight.MeshBoneIndices[Influence];
+				BoneReaches[BoneIndex] = FMath::Max(BoneReaches[BoneIndex], FVector3f::Dist(Vertices[VertexIndex], BoneRefPositions[BoneIndex]));
+			}
+		}
+	}
+}
+
+void FBoneErrorBound::AddBoneFrame(const TArray<FVector3f>& BonePositions, const TArray<FVector4f>& BoneRotations)
+{
+	check(BonePositions.Num() == BoneReaches.Num() && BoneRotations.Num() == BoneReaches.Num());
+
+	for (int32 BoneIndex = 0; BoneIndex < BoneReaches.Num(); ++BoneIndex)
+	{
+		if (BoneReaches[BoneIndex] < 0.f)
+		{
+			continue;
+		}
+
+		const FVector4f& Rotation = BoneRotations[BoneIndex];
+		const FQuat4f Quat(FVector3f(Rotation).GetSafeNormal(), Rotation.W);
+		const FQuat4f Decoded = DecodeQuantizedRotation(Rotation, Encoding);
+
+		// |(R - R')x| = 2 sin(Angle / 2) |x| <= 2 |Q - Q'| |x|, Q' taken in the hemisphere of Q
+		const float Sign = (Quat | Decoded) < 0.f ? -1.f : 1.f;
+		const float Chord = FVector4f(Quat.X - Decoded.X * Sign, Quat.Y - Decoded.Y * Sign, Quat.Z - Decoded.Z * Sign, Quat.W - Decoded.W * Sign).Size();
+
+		const float PositionError = FVector3f::Dist(BonePositions[BoneIndex], Quantizer.Decode(BonePositions[BoneIndex], BoneIndex));
+		MaxError = FMath::Max(MaxError, 2.f * Chord * BoneReaches[BoneIndex] + 2.f * RefPoseErrors[BoneIndex] + PositionError);
+	}
+}
+
+void FQuantizationErrorAnalyzer::WriteReport(UMyAnimToTextureDataAsset* DataAsset) const
+{
+	auto MakeErrorInfo = [](const FName Name, const FErrorAccumulator& Error)
+	{
+		FAnim2TextureErrorInfo ErrorInfo;
+		ErrorInfo.Name = Name;
+		ErrorInfo.MaxError = Error.Max;
+		ErrorInfo.RMSError = Error.GetRMS();
+		return ErrorInfo;
+	};
+
+	DataAsset->MaxPositionError = TotalError.Max;
+	DataAsset->RMSPositionError = TotalError.GetRMS();
+
+	DataAsset->AnimationErrors.Reset(AnimationErrors.Num());
+	for (int32 AnimIndex = 0; AnimIndex < AnimationErrors.Num(); ++AnimIndex)
+	{
+		const UAnimSequence* AnimSequence = DataAsset->AnimSequences.IsValidIndex(AnimIndex) ? DataAsset->AnimSequences[AnimIndex].AnimSequence.Get() : nullptr;
+		DataAsset->AnimationErrors.Add(MakeErrorInfo(AnimSequence ? AnimSequence->GetFName() : NAME_None, AnimationErrors[AnimIndex]));
+	}
+
+	DataAsset->BoneErrors.Reset(BoneErrors.Num());
+	if (!BoneErrors.IsEmpty())
+	{
+		TArray<FName> BoneNames;
+		GetBoneNames(DataAsset->GetSkeletalMesh(), BoneNames);
+
+		// Bone Texture column -> Raw Bone
+		for (int32 BoneIndex = 0; BoneIndex < BoneErrors.Num(); ++BoneIndex)
+		{
+			const int32 RawBoneIndex = DataAsset->BakedBones.IsEmpty() ? BoneIndex : DataAsset->BakedBones[BoneIndex];
+			DataAsset->BoneErrors.Add(MakeErrorInfo(BoneNames.IsValidIndex(RawBoneIndex) ? BoneNames[RawBoneIndex] : NAME_None, BoneErrors[BoneIndex]));
+		}
+	}
+
+	DataAsset->VertexErrors.Reset(VertexErrors.Num());
+	for (const FErrorAccumulator& VertexError : VertexErrors)
+	{
+		DataAsset->VertexErrors.Add(MakeErrorInfo(NAME_None, VertexError));
+	}
+}
+
+} // end namespace AnimToTexture_Private
@@ -67,6 +67,7 @@ void FSourceVertexData::Update(const FVector3f& SourceVertex,
 
 			FSourceVertexDriverTriangleData TriangleData;
 			TriangleData.InverseDistanceWeight = NWeights[Index];
+			TriangleData.DriverTriangleIndex = DriverTriangleIndex;
 			TriangleData.Triangle = DriverTriangle;
 			TriangleData.BarycentricCoords = BarycentricCoordinates(ClosestPoint, A, B, C);
 			TriangleData.TangentLocalIndex = GetTriangleTangentLocalIndex(ClosestPoint, A, B, C);
@@ -115,6 +116,90 @@ void FSourceMeshToDriverMesh::Update(const UStaticMesh* StaticMesh, const int32
 		// UE_LOG(LogTemp, Warning, TEXT("Vertex: %i NumTriangles: %i."), SourceVertexIndex, SourceVerticesData[SourceVertexIndex].DriverTriangleData.Num());
 
 	});	// end ParallelFor
+
+	// Fold Mapping into compact per-pose Deformation Data
+	BuildInfluences();
+}
+
+void FSourceMeshToDriverMesh::BuildInfluences()
+{
+	const int32 NumSourceVertices = SourceVerticesData.Num();
+
+	BoundDriverTriangles.Reset();
+	Influences.Reset();
+	InfluenceOffsets.SetNumUninitialized(NumSourceVertices + 1);
+
+	// Compact DriverTriangles and compute Offsets
+	TArray<int32> TriangleToFrameIndex;
+	TriangleToFrameIndex.Init(INDEX_NONE, DriverTriangles.Num());
+
+	int32 NumInfluences = 0;
+	for (int32 SourceVertexIndex = 0; SourceVertexIndex < NumSourceVertices; SourceVertexIndex++)
+	{
+		InfluenceOffsets[SourceVertexIndex] = NumInfluences;
+		NumInfluences += SourceVerticesData[SourceVertexIndex].DriverTriangleData.Num();
+	}
+	InfluenceOffsets[NumSourceVertices] = NumInfluences;
+
+	Influences.SetNumUninitialized(NumInfluences);
+
+	for (int32 SourceVertexIndex = 0; SourceVertexIndex < NumSourceVertices; SourceVertexIndex++)
+	{
+		const FVector3f& SourceVertex = SourceVertices[SourceVertexIndex];
+		const FVector3f& SourceNormal = SourceNormals[SourceVertexIndex];
+		const TArray<FSourceVertexDriverTriangleData>& DriverTriangleData = SourceVerticesData[SourceVertexIndex].DriverTriangleData;
+
+		for (int32 Index = 0; Index < DriverTriangleData.Num(); Index++)
+		{
+			const FSourceVertexDriverTriangleData& TriangleData = DriverTriangleData[Index];
+
+			// Find Frame for DriverTriangle
+			int32& FrameIndex = TriangleToFrameIndex[TriangleData.DriverTriangleIndex];
+			if (FrameIndex == INDEX_NONE)
+			{
+				FrameIndex = BoundDriverTriangles.Add(TriangleData.Triangle);
+			}
+
+			// SourceVertex in DriverTriangle Space (constant for all poses)
+			const FVector3f LocalPosition = TriangleData.InvMatrix.TransformPosition(SourceVertex);
+			const FVector3f LocalNormal = TriangleData.InvMatrix.TransformVector(SourceNormal);
+
+			// Point at Barycentric = A + V * Edge1 + W * Edge2
+			const float V = TriangleData.BarycentricCoords.Y;
+			const float W = 1.f - TriangleData.BarycentricCoords.X - TriangleData.BarycentricCoords.Y;
+
+			// Tangent (PointX - Point) = Alpha * Edge1 + Beta * Edge2
+			float Alpha = -V;
+			float Beta = -W;
+			if (TriangleData.TangentLocalIndex == 1)
+			{
+				Alpha += 1.f;
+			}
+			else if (TriangleData.TangentLocalIndex == 2)
+			{
+				Beta += 1.f;
+			}
+
+			// Matrix Rows are { Tangent, Normal, Tangent x Normal, Point }
+			const float Weight = TriangleData.InverseDistanceWeight;
+
+			FDriverTriangleInfluence& Influence = Influences[InfluenceOffsets[SourceVertexIndex] + Index];
+			Influence.FrameIndex = FrameIndex;
+			Influence.Weight = Weight;
+
+			Influence.PositionCoeffs[0] = Weight * (V + LocalPosition.X * Alpha);
+			Influence.PositionCoeffs[1] = Weight * (W + LocalPosition.X * Beta);
+			Influence.PositionCoeffs[2] = Weight * LocalPosition.Y;
+			Influence.PositionCoeffs[3] = Weight * LocalPosition.Z * Alpha;
+			Influence.PositionCoeffs[4] = Weight * LocalPosition.Z * Beta;
+
+			Influence.NormalCoeffs[0] = Weight * LocalNormal.X * Alpha;
+			Influence.NormalCoeffs[1] = Weight * LocalNormal.X * Beta;
+			Influence.NormalCoeffs[2] = Weight * LocalNormal.Y;
+			Influence.NormalCoeffs[3] = Weight * LocalNormal.Z * Alpha;
+			Influence.NormalCoeffs[4] = Weight * LocalNormal.Z * Beta;
+		}
+	}
 }
 
 int32 FSourceMeshToDriverMesh::GetNumSourceVertices() const
@@ -122,6 +207,18 @@ int32 FSourceMeshToDriverMesh::GetNumSourceVertices() const
 	return SourceVerticesData.Num();
 }
 
+SIZE_T FSourceMeshToDriverMesh::GetAllocatedSize() const
+{
+	SIZE_T Size = SourceVertices.GetAllocatedSize() + SourceNormals.GetAllocatedSize() + SourceVerticesData.GetAllocatedSize()
+		+ DriverVertices.GetAllocatedSize() + DriverTriangles.GetAllocatedSize() + DriverSkinWeights.GetAllocatedSize()
+		+ BoundDriverTriangles.GetAllocatedSize() + Influences.GetAllocatedSize() + InfluenceOffsets.GetAllocatedSize();
+	for (const FSourceVertexData& SourceVertexData : SourceVerticesData)
+	{
+		Size += SourceVertexData.DriverTriangleData.GetAllocatedSize();
+	}
+	return Size;
+}
+
 int32 FSourceMeshToDriverMesh::GetSourceVertices(TArray<FVector3f>& OutVertices) const
 {
 	OutVertices = SourceVertices;
@@ -139,41 +236,60 @@ void FSourceMeshToDriverMesh::DeformVerticesAndNormals(const TArray<FVector3f>&
 {
 	// Source Vertices
 	const int32 NumSourceVertices = SourceVerticesData.Num();
-	OutVertices.SetNumZeroed(NumSourceVertices);
-	OutNormals.SetNumZeroed(NumSourceVertices);
+	OutVertices.SetNumUninitialized(NumSourceVertices);
+	OutNormals.SetNumUninitialized(NumSourceVertices);
 
-	// Driver Triangles
-	const int32 NumDriverTriangles = DriverTriangles.Num();
+	// Compute Driver Triangle Frames once per pose
+	const int32 NumFrames = BoundDriverTriangles.Num();
+	TArray<FDriverTriangleFrame> Frames;
+	Frames.SetNumUninitialized(NumFrames);
 
-	// Deform Source Vertices and Normals
-	ParallelFor(NumSourceVertices, [&](int32 SourceVertexIndex)
+	ParallelFor(NumFrames, [&](int32 FrameIndex)
 	{
-		const FVector3f& SourceVertex = SourceVertices[SourceVertexIndex];
-		const FVector3f& SourceNormal = SourceNormals[SourceVertexIndex];
-
-		for (const FSourceVertexDriverTriangleData& TriangleData: SourceVerticesData[SourceVertexIndex].DriverTriangleData)
-		{
-			const FVector3f& A = InDriverVertices[TriangleData.Triangle.X];
-			const FVector3f& B = InDriverVertices[TriangleData.Triangle.Y];
-			const FVector3f& C = InDriverVertices[TriangleData.Triangle.Z];
+		const FIntVector3& DriverTriangle = BoundDriverTriangles[FrameIndex];
+		const FVector3f& A = InDriverVertices[DriverTriangle.X];
+		const FVector3f& B = InDriverVertices[DriverTriangle.Y];
+		const FVector3f& C = InDriverVertices[DriverTriangle.Z];
+
+		FDriverTriangleFrame& Frame = Frames[FrameIndex];
+		Frame.Origin = A;
+		Frame.Edge1 = B - A;
+		Frame.Edge2 = C - A;
+		Frame.Normal = FVector3f::CrossProduct(Frame.Edge1, Frame.Edge2); // same as GetTriangleNormal
+		Frame.Edge1CrossNormal = FVector3f::CrossProduct(Frame.Edge1, Frame.Normal);
+		Frame.Edge2CrossNormal = FVector3f::CrossProduct(Frame.Edge2, Frame.Normal);
 
-			// Get Driver Triangle Point At Barycentric
-			const FVector3f& BarycentricCoords = TriangleData.BarycentricCoords;
-			const FVector3f Point = PointAtBarycentricCoordinates(A, B, C, BarycentricCoords);
-
-			// Grt Driver Triangle Matrix
-			const uint8& TangentLocalIndex = TriangleData.TangentLocalIndex;
-			const FMatrix44f& DriverTriangleInvMatrix = TriangleData.InvMatrix;
-			const FMatrix44f DriverTriangleMatrix = GetTriangleMatrix(Point, A, B, C, TangentLocalIndex);
+	}); // end ParallelFor
 
-			// Get SourceVertex -> DriverTriangle InverseDistanceWeight
-			const float& InverseDistanceWeight = TriangleData.InverseDistanceWeight;
+	// Deform Source Vertices and Normals (Weighted Blend of Frames)
+	ParallelFor(NumSourceVertices, [&](int32 SourceVertexIndex)
+	{
+		FVector3f Vertex = FVector3f::ZeroVector;
+		FVector3f Normal = FVector3f::ZeroVector;
 
-			// Tranform Weighted Source Vertex and Normal
-			OutVertices[SourceVertexIndex] += DriverTriangleMatrix.TransformPosition(DriverTriangleInvMatrix.TransformPosition(SourceVertex)) * InverseDistanceWeight;
-			OutNormals[SourceVertexIndex] += DriverTriangleMatrix.TransformVector(DriverTriangleInvMatrix.TransformVector(SourceNormal)) * InverseDistanceWeight;
+		const int32 End = InfluenceOffsets[SourceVertexIndex + 1];
+		for (int32 Index = InfluenceOffsets[SourceVertexIndex]; Index < End; Index++)
+		{
+			const FDriverTriangleInfluence& Influence = Influences[Index];
+			const FDriverTriangleFrame& Frame = Frames[Influence.FrameIndex];
+
+			Vertex += Frame.Origin * Influence.Weight
+				+ Frame.Edge1 * Influence.PositionCoeffs[0]
+				+ Frame.Edge2 * Influence.PositionCoeffs[1]
+				+ Frame.Normal * Influence.PositionCoeffs[2]
+				+ Frame.Edge1CrossNormal * Influence.PositionCoeffs[3]
+				+ Frame.Edge2CrossNormal * Influence.PositionCoeffs[4];
+
+			Normal += Frame.Edge1 * Influence.NormalCoeffs[0]
+				+ Frame.Edge2 * Influence.NormalCoeffs[1]
+				+ Frame.Normal * Influence.NormalCoeffs[2]
+				+ Frame.Edge1CrossNormal * Influence.NormalCoeffs[3]
+				+ Frame.Edge2CrossNormal * Influence.NormalCoeffs[4];
 		}
 
+		OutVertices[SourceVertexIndex] = Vertex;
+		OutNormals[SourceVertexIndex] = Normal;
+
 	}); // end ParallelFor
 }
 
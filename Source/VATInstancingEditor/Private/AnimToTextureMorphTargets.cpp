@@ -0,0 +1,130 @@
+﻿#include "AnimToTextureMorphTargets.h"
+#include "Animation/MorphTarget.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/SkeletalMesh.h"
+
+namespace AnimToTexture_Private
+{
+
+// Smaller deltas are considered unmoved, in centimetres
+static constexpr float MorphDeltaThreshold = 1e-3f;
+
+void GetMorphTargetWeights(const USkeletalMeshComponent* SkeletalMeshComponent, TArray<float>& OutWeights)
+{
+	check(SkeletalMeshComponent);
+	OutWeights.Reset();
+
+	const USkeletalMesh* SkeletalMesh = SkeletalMeshComponent->GetSkeletalMeshAsset();
+	check(SkeletalMesh);
+
+	// Morph Target curves of the last evaluated pose
+	for (const UMorphTarget* MorphTarget : SkeletalMesh->GetMorphTargets())
+	{
+		OutWeights.Add(MorphTarget ? SkeletalMeshComponent->GetMorphTarget(MorphTarget->GetFName()) : 0.f);
+	}
+}
+
+void ApplyMorphTargets(const USkeletalMesh* SkeletalMesh, const int32 LODIndex, const TArray<float>& Weights,
+	TArray<FVector3f>& InOutVertices)
+{
+	check(SkeletalMesh);
+
+	const TArray<TObjectPtr<UMorphTarget>>& MorphTargets = SkeletalMesh->GetMorphTargets();
+	check(Weights.Num() == MorphTargets.Num());
+
+	for (int32 Index = 0; Index < MorphTargets.Num(); ++Index)
+	{
+		const float Weight = Weights[Index];
+		if (!MorphTargets[Index] || FMath::IsNearlyZero(Weight))
+		{
+			continue;
+		}
+
+		int32 NumDeltas = 0;
+		const FMorphTargetDelta* Deltas = MorphTargets[Index]->GetMorphTargetDelta(LODIndex, NumDeltas);
+		for (int32 DeltaIndex = 0; DeltaIndex < NumDeltas; ++DeltaIndex)
+		{
+			const FMorphTargetDelta& Delta = Deltas[DeltaIndex];
+			if (InOutVertices.IsValidIndex(Delta.SourceIdx))
+			{
+				InOutVertices[Delta.SourceIdx] += Delta.PositionDelta * Weight;
+			}
+		}
+	}
+}
+
+void FMorphTargetDeltas::Update(const FSourceMeshToDriverMesh& InMapping, const USkeletalMesh* InSkeletalMesh, const int32 InLODIndex,
+	const TArray<bool>& ActiveMorphTargets)
+{
+	Mapping = &InMapping;
+	SkeletalMesh = InSkeletalMesh;
+	LODIndex = InLODIndex;
+
+	GetVertices(SkeletalMesh, LODIndex, DriverRefVertices);
+
+	TArray<FVector3f> SourceRefNormals;
+	Mapping->DeformVerticesAndNormals(DriverRefVertices, SourceRefVertices, SourceRefNormals);
+
+	// Every active Morph Target at full weight, on its own
+	const int32 NumMorphTargets = SkeletalMesh->GetMorphTargets().Num();
+	check(ActiveMorphTargets.Num() == NumMorphTargets);
+
+	TArray<bool> bMovedVertices;
+	bMovedVertices.SetNumZeroed(SourceRefVertices.Num());
+
+	TArray<float> Weights;
+	TArray<FVector3f> MorphedDriverVertices;
+	TArray<FVector3f> MorphedVertices;
+	TArray<FVector3f> MorphedNormals;
+	for (int32 MorphIndex = 0; MorphIndex < NumMorphTargets; ++MorphIndex)
+	{
+		if (!ActiveMorphTargets[MorphIndex])
+		{
+			continue;
+		}
+
+		Weights.Init(0.f, NumMorphTargets);
+		Weights[MorphIndex] = 1.f;
+
+		MorphedDriverVertices = DriverRefVertices;
+		ApplyMorphTargets(SkeletalMesh, LODIndex, Weights, MorphedDriverVertices);
+		Mapping->DeformVerticesAndNormals(MorphedDriverVertices, MorphedVertices, MorphedNormals);
+
+		for (int32 VertexIndex = 0; VertexIndex < MorphedVertices.Num(); ++VertexIndex)
+		{
+			bMovedVertices[VertexIndex] |= FVector3f::DistSquared(MorphedVertices[VertexIndex], SourceRefVertices[VertexIndex]) > FMath::Square(MorphDeltaThreshold);
+		}
+	}
+
+	VertexSlots.Init(INDEX_NONE, SourceRefVertices.Num());
+	MorphVertices.Reset();
+	for (int32 VertexIndex = 0; VertexIndex < bMovedVertices.Num(); ++VertexIndex)
+	{
+		if (bMovedVertices[VertexIndex])
+		{
+			VertexSlots[VertexIndex] = MorphVertices.Add(VertexIndex);
+		}
+	}
+}
+
+void FMorphTargetDeltas::GetFrameDeltas(const TArray<float>& Weights, TArray<FVector3f>& OutDeltas) const
+{
+	check(Mapping);
+	OutDeltas.SetNumUninitialized(MorphVertices.Num());
+
+	// Morph Targets blend on the SkeletalMesh, the StaticMesh follows through the Mapping
+	TArray<FVector3f> MorphedDriverVertices = DriverRefVertices;
+	ApplyMorphTargets(SkeletalMesh, LODIndex, Weights, MorphedDriverVertices);
+
+	TArray<FVector3f> MorphedVertices;
+	TArray<FVector3f> MorphedNormals;
+	Mapping->DeformVerticesAndNormals(MorphedDriverVertices, MorphedVertices, MorphedNormals);
+
+	for (int32 Slot = 0; Slot < MorphVertices.Num(); ++Slot)
+	{
+		const int32 VertexIndex = MorphVertices[Slot];
+		OutDeltas[Slot] = MorphedVertices[VertexIndex] - SourceRefVertices[VertexIndex];
+	}
+}
+
+} // end namespace AnimToTexture_Private
@@ -1,4 +1,5 @@
 ﻿#include "AnimToTextureSkeletalMesh.h"
+#include "AnimToTextureMorphTargets.h"
 #include "VATInstancingEditorModule.h"
 #include "Rendering/SkeletalMeshRenderData.h"
 #include "Engine/StaticMesh.h"
@@ -365,7 +366,10 @@ void GetSkinnedVertices(const USkeletalMeshComponent* SkeletalMeshComponent, con
 	const int32 NumVertices = GetVertices(SkeletalMesh, LODIndex, Vertices);
 	OutPositions.SetNumUninitialized(NumVertices);
 
-	// TODO: Add Morph Deltas to Vertices.
+	// Morph Targets are applied before skinning, as the GPU does
+	TArray<float> MorphTargetWeights;
+	GetMorphTargetWeights(SkeletalMeshComponent, MorphTargetWeights);
+	ApplyMorphTargets(SkeletalMesh, LODIndex, MorphTargetWeights, Vertices);
 
 	// Get Weights
 	TArray<VertexSkinWeightMax> SkinWeights;
@@ -1,4 +1,6 @@
 ﻿#include "AnimToTextureUtils.h"
+#include "Algo/AllOf.h"
+#include "Misc/Crc.h"
 
 namespace AnimToTexture_Private
 {
@@ -33,36 +35,270 @@ void DecomposeTransformations(const TArray<FTransform>& Transforms,
 };
 
 
-bool WriteSkinWeightsToTexture(const TArray<VertexSkinWeightFour>& SkinWeights, const int32 RowsPerFrame, const int32 Height, const int32 Width, UTexture2D* Texture)
+static constexpr float QuaternionComponentScale = UE_SQRT_2;  // [-1/sqrt(2), 1/sqrt(2)] -> [-1, 1]
+static constexpr float QuaternionComponentSteps = 1023.f;     // 10 bits
+
+FColor EncodeQuaternion(const FQuat4f& Quat)
+{
+	const FQuat4f Q = Quat.GetNormalized();
+	const float Components[4] = { Q.X, Q.Y, Q.Z, Q.W };
+
+	// Find largest component
+	int32 LargestIndex = 0;
+	for (int32 Index = 1; Index < 4; ++Index)
+	{
+		if (FMath::Abs(Components[Index]) > FMath::Abs(Components[LargestIndex]))
+		{
+			LargestIndex = Index;
+		}
+	}
+
+	// Q and -Q are the same rotation, make the dropped component positive
+	const float Sign = Components[LargestIndex] < 0.f ? -1.f : 1.f;
+
+	uint32 Packed = static_cast<uint32>(LargestIndex) << 30;
+	for (int32 Index = 0, Slot = 0; Index < 4; ++Index)
+	{
+		if (Index != LargestIndex)
+		{
+			const float Normalized = FMath::Clamp(Sign * Components[Index] * QuaternionComponentScale * 0.5f + 0.5f, 0.f, 1.f);
+			Packed |= static_cast<uint32>(FMath::RoundToInt(Normalized * QuaternionComponentSteps)) << (Slot * 10);
+			Slot++;
+		}
+	}
+
+	return FColor(Packed & 0xFF, (Packed >> 8) & 0xFF, (Packed >> 16) & 0xFF, (Packed >> 24) & 0xFF);
+}
+
+FQuat4f DecodeQuaternion(const FColor& Color)
+{
+	const uint32 Packed = static_cast<uint32>(Color.R) | (static_cast<uint32>(Color.G) << 8) | (static_cast<uint32>(Color.B) << 16) | (static_cast<uint32>(Color.A) << 24);
+	const int32 LargestIndex = Packed >> 30;
+
+	float Components[4];
+	float SumSquared = 0.f;
+	for (int32 Index = 0, Slot = 0; Index < 4; ++Index)
+	{
+		if (Index != LargestIndex)
+		{
+			const float Normalized = ((Packed >> (Slot * 10)) & 0x3FF) / QuaternionComponentSteps;
+			Components[Index] = (Normalized * 2.f - 1.f) / QuaternionComponentScale;
+			SumSquared += Components[Index] * Components[Index];
+			Slot++;
+		}
+	}
+	Components[LargestIndex] = FMath::Sqrt(FMath::Max(0.f, 1.f - SumSquared));
+
+	return FQuat4f(Components[0], Components[1], Components[2], Components[3]).GetNormalized();
+}
+
+void BoneToDualQuaternion(const FVector3f& RefPosition, const FVector3f& Delta, const FVector4f& AxisAndAngle, FVector4f& OutReal, FVector4f& OutDual)
+{
+	FQuat4f Real(FVector3f(AxisAndAngle).GetSafeNormal(), AxisAndAngle.W);
+	if (Real.W < 0.f)
+	{
+		Real = -Real;
+	}
+
+	// v' = R * v + Translation
+	const FVector3f Translation = RefPosition + Delta - Real.RotateVector(RefPosition);
+	const FQuat4f Dual = FQuat4f(Translation.X, Translation.Y, Translation.Z, 0.f) * Real * 0.5f;
+
+	OutReal = FVector4f(Real.X, Real.Y, Real.Z, Real.W);
+	OutDual = FVector4f(Dual.X, Dual.Y, Dual.Z, Dual.W);
+}
+
+FVector3f TransformByDualQuaternion(const FVector4f& Real, const FVector4f& Dual, const FVector3f& Position)
+{
+	const float InvLength = FMath::InvSqrt(FMath::Max(Real.SizeSquared(), UE_SMALL_NUMBER));
+	const FVector3f RealXYZ = FVector3f(Real) * InvLength;
+	const FVector3f DualXYZ = FVector3f(Dual) * InvLength;
+	const float RealW = Real.W * InvLength;
+	const float DualW = Dual.W * InvLength;
+
+	// Same as VATTransformPosition in VATDualQuaternion.ush
+	const FVector3f Rotated = Position + 2.f * FVector3f::CrossProduct(RealXYZ, FVector3f::CrossProduct(RealXYZ, Position) + RealW * Position);
+	const FVector3f Translation = 2.f * (RealW * DualXYZ - DualW * RealXYZ + FVector3f::CrossProduct(RealXYZ, DualXYZ));
+	return Rotated + Translation;
+}
+
+void EncodeDualQuaternion(const FVector4f& Real, const FVector4f& Dual, const float DualScale, FVector4f& OutRealTexel, FVector4f& OutDualTexel)
+{
+	OutRealTexel = Real * 0.5f + FVector4f(0.5f, 0.5f, 0.5f, 0.5f);
+	OutDualTexel = Dual * (0.5f / DualScale) + FVector4f(0.5f, 0.5f, 0.5f, 0.5f);
+}
+
+void DecodeDualQuaternion(const FVector4f& RealTexel, const FVector4f& DualTexel, const float DualScale, FVector4f& OutReal, FVector4f& OutDual)
+{
+	OutReal = RealTexel * 2.f - FVector4f(1.f, 1.f, 1.f, 1.f);
+	OutDual = (DualTexel * 2.f - FVector4f(1.f, 1.f, 1.f, 1.f)) * DualScale;
+}
+
+FVectorTextureWriter::FVectorTextureWriter(const EAnim2TexturePrecision Precision, const int32 InRowsPerFrame, const int32 InHeight, const int32 InWidth)
+	: RowsPerFrame(InRowsPerFrame)
+	, Height(InHeight)
+	, Width(InWidth)
+{
+	if (Precision == EAnim2TexturePrecision::SixteenBits)
+	{
+		HighPrecisionPixels.Init(FHighPrecision::DefaultColor, Height * Width);
+	}
+	else if (Precision == EAnim2TexturePrecision::HalfFloat)
+	{
+		HalfPrecisionPixels.Init(FHalfPrecision::DefaultColor, Height * Width);
+	}
+	else
+	{
+		LowPrecisionPixels.Init(FLowPrecision::DefaultColor, Height * Width);
+	}
+}
+
+void FVectorTextureWriter::WriteFrame(const int32 Frame, const TArray<FColor>& Texels)
+{
+	const int32 BlockStart = RowsPerFrame * Width * Frame;
+	check(BlockStart + Texels.Num() <= LowPrecisionPixels.Num());
+
+	FMemory::Memcpy(LowPrecisionPixels.GetData() + BlockStart, Texels.GetData(), Texels.Num() * sizeof(FColor));
+}
+
+bool FVectorTextureWriter::WriteToTexture(UTexture2D* Texture) const
+{
+	if (!Texture)
+	{
+		return false;
+	}
+
+	if (HighPrecisionPixels.Num())
+	{
+		return AnimToTexture_Private::WriteToTexture<FHighPrecision>(Texture, Height, Width, HighPrecisionPixels);
+	}
+	else if (HalfPrecisionPixels.Num())
+	{
+		return AnimToTexture_Private::WriteToTexture<FHalfPrecision>(Texture, Height, Width, HalfPrecisionPixels);
+	}
+	else
+	{
+		return AnimToTexture_Private::WriteToTexture<FLowPrecision>(Texture, Height, Width, LowPrecisionPixels);
+	}
+}
+
+bool FVectorTextureWriter::WriteToTextureArray(UTexture2DArray* Texture, const int32 NumSlices) const
 {
-	check(Texture);
+	if (!Texture || !NumSlices || Height % NumSlices)
+	{
+		return false;
+	}
 
-	const int32 NumVertices = SkinWeights.Num();
+	if (HighPrecisionPixels.Num())
+	{
+		return AnimToTexture_Private::WriteToTextureArray<FHighPrecision>(Texture, Height / NumSlices, Width, NumSlices, HighPrecisionPixels);
+	}
+	else if (HalfPrecisionPixels.Num())
+	{
+		return AnimToTexture_Private::WriteToTextureArray<FHalfPrecision>(Texture, Height / NumSlices, Width, NumSlices, HalfPrecisionPixels);
+	}
+	else
+	{
+		return AnimToTexture_Private::WriteToTextureArray<FLowPrecision>(Texture, Height / NumSlices, Width, NumSlices, LowPrecisionPixels);
+	}
+}
 
-	// Allocate PixelData.
-	TArray<FLowPrecision::ColorType> Pixels;
-	Pixels.Init(FLowPrecision::ColorType::Black, Height * Width);
+bool FVectorTextureWriter::WriteSliceToTexture(UTexture2D* Texture, const int32 NumSlices, const int32 Slice) const
+{
+	if (!Texture || !NumSlices || Height % NumSlices || Slice < 0 || Slice >= NumSlices)
+	{
+		return false;
+	}
 
-	for (int32 VertexIndex = 0; VertexIndex < NumVertices; ++VertexIndex)
+	const int32 SliceHeight = Height / NumSlices;
+	const int32 SliceStart = Slice * SliceHeight * Width;
+	if (HighPrecisionPixels.Num())
 	{
-		const VertexSkinWeightFour& VertexSkinWeight = SkinWeights[VertexIndex];
+		const TArray<FHighPrecision::ColorType> SlicePixels(HighPrecisionPixels.GetData() + SliceStart, SliceHeight * Width);
+		return AnimToTexture_Private::WriteToTexture<FHighPrecision>(Texture, SliceHeight, Width, SlicePixels);
+	}
+	else if (HalfPrecisionPixels.Num())
+	{
+		const TArray<FHalfPrecision::ColorType> SlicePixels(HalfPrecisionPixels.GetData() + SliceStart, SliceHeight * Width);
+		return AnimToTexture_Private::WriteToTexture<FHalfPrecision>(Texture, SliceHeight, Width, SlicePixels);
+	}
+	else
+	{
+		const TArray<FLowPrecision::ColorType> SlicePixels(LowPrecisionPixels.GetData() + SliceStart, SliceHeight * Width);
+		return AnimToTexture_Private::WriteToTexture<FLowPrecision>(Texture, SliceHeight, Width, SlicePixels);
+	}
+}
 
-		// Write Influence
-		// NOTE: we are assuming the bone index is under < 256
-		Pixels[VertexIndex].R = (uint8)VertexSkinWeight.MeshBoneIndices[0];
-		Pixels[VertexIndex].G = (uint8)VertexSkinWeight.MeshBoneIndices[1];
-		Pixels[VertexIndex].B = (uint8)VertexSkinWeight.MeshBoneIndices[2];
-		Pixels[VertexIndex].A = (uint8)VertexSkinWeight.MeshBoneIndices[3];
+const uint8* FVectorTextureWriter::GetFrameData(const int32 Frame, SIZE_T& OutNumBytes) const
+{
+	const int32 BlockStart = RowsPerFrame * Width * Frame;
+	if (HighPrecisionPixels.Num())
+	{
+		OutNumBytes = RowsPerFrame * Width * sizeof(FHighPrecision::ColorType);
+		return reinterpret_cast<const uint8*>(HighPrecisionPixels.GetData() + BlockStart);
+	}
+	else if (HalfPrecisionPixels.Num())
+	{
+		OutNumBytes = RowsPerFrame * Width * sizeof(FHalfPrecision::ColorType);
+		return reinterpret_cast<const uint8*>(HalfPrecisionPixels.GetData() + BlockStart);
+	}
+	else
+	{
+		OutNumBytes = RowsPerFrame * Width * sizeof(FLowPrecision::ColorType);
+		return reinterpret_cast<const uint8*>(LowPrecisionPixels.GetData() + BlockStart);
+	}
+}
+
+uint32 FVectorTextureWriter::GetFrameHash(const int32 Frame) const
+{
+	SIZE_T NumBytes;
+	const uint8* Data = GetFrameData(Frame, NumBytes);
+	return FCrc::MemCrc32(Data, NumBytes);
+}
+
+bool FVectorTextureWriter::IsFrameEqual(const int32 FrameA, const int32 FrameB) const
+{
+	SIZE_T NumBytes;
+	const uint8* DataA = GetFrameData(FrameA, NumBytes);
+	const uint8* DataB = GetFrameData(FrameB, NumBytes);
+	return FMemory::Memcmp(DataA, DataB, NumBytes) == 0;
+}
 
-		// Write Weight
-		Pixels[Width * RowsPerFrame + VertexIndex].R = VertexSkinWeight.BoneWeights[0];
-		Pixels[Width * RowsPerFrame + VertexIndex].G = VertexSkinWeight.BoneWeights[1];
-		Pixels[Width * RowsPerFrame + VertexIndex].B = VertexSkinWeight.BoneWeights[2];
-		Pixels[Width * RowsPerFrame + VertexIndex].A = VertexSkinWeight.BoneWeights[3];
-	};
+void FVectorTextureWriter::SetNumFrames(const int32 NumFrames)
+{
+	check(NumFrames * RowsPerFrame * Width <= FMath::Max3(LowPrecisionPixels.Num(), HighPrecisionPixels.Num(), HalfPrecisionPixels.Num()));
+	Height = NumFrames * RowsPerFrame;
+}
+
+
+FTextureFrameDeduplicator::FTextureFrameDeduplicator(TArray<const FVectorTextureWriter*> InWriters, const int32 NumFrames)
+	: Writers(MoveTemp(InWriters))
+{
+	FrameRemap.SetNumUninitialized(NumFrames);
+}
+
+void FTextureFrameDeduplicator::CommitFrame(const int32 Frame)
+{
+	uint32 Hash = 0;
+	for (const FVectorTextureWriter* Writer : Writers)
+	{
+		Hash = HashCombine(Hash, Writer->GetFrameHash(NumUniqueFrames));
+	}
+
+	TArray<int32, TInlineAllocator<4>> Candidates;
+	HashToTextureFrame.MultiFind(Hash, Candidates);
+	for (const int32 Candidate : Candidates)
+	{
+		const bool bEqual = Algo::AllOf(Writers, [&](const FVectorTextureWriter* Writer) { return Writer->IsFrameEqual(Candidate, NumUniqueFrames); });
+		if (bEqual)
+		{
+			FrameRemap[Frame] = Candidate;
+			return;
+		}
+	}
 
-	// Write to Texture
-	return WriteToTexture<FLowPrecision>(Texture, Height, Width, Pixels);
+	HashToTextureFrame.Add(Hash, NumUniqueFrames);
+	FrameRemap[Frame] = NumUniqueFrames++;
 }
 
 
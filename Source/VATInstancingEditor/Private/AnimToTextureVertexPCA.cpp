@@ -0,0 +1,480 @@
+﻿#include "AnimToTextureVertexPCA.h"
+#include "AnimToTextureUtils.h"
+#include "Runtime/Core/Public/Async/ParallelFor.h"
+
+namespace AnimToTexture_Private
+{
+
+/* Modified Gram-Schmidt of NumColumns columns of Length (column-major). 
+*  Returns the norm of every column before normalization, near-zero columns are set to zero */
+static void Orthonormalize(TArray<double>& Columns, const int32 Length, const int32 NumColumns, TArray<double>& OutNorms)
+{
+	OutNorms.SetNumZeroed(NumColumns);
+	for (int32 Column = 0; Column < NumColumns; ++Column)
+	{
+		double* Data = Columns.GetData() + static_cast<int64>(Column) * Length;
+		for (int32 Previous = 0; Previous < Column; ++Previous)
+		{
+			const double* PreviousData = Columns.GetData() + static_cast<int64>(Previous) * Length;
+			double Dot = 0.0;
+			for (int32 Index = 0; Index < Length; ++Index)
+			{
+				Dot += Data[Index] * PreviousData[Index];
+			}
+			for (int32 Index = 0; Index < Length; ++Index)
+			{
+				Data[Index] -= Dot * PreviousData[Index];
+			}
+		}
+
+		double SquaredNorm = 0.0;
+		for (int32 Index = 0; Index < Length; ++Index)
+		{
+			SquaredNorm += Data[Index] * Data[Index];
+		}
+
+		const double Norm = FMath::Sqrt(SquaredNorm);
+		OutNorms[Column] = Norm;
+		const double InvNorm = Norm > UE_DOUBLE_SMALL_NUMBER ? 1.0 / Norm : 0.0;
+		for (int32 Index = 0; Index < Length; ++Index)
+		{
+			Data[Index] *= InvNorm;
+		}
+	}
+}
+
+/* Largest vertex distance of all frames */
+static float GetMaxVertexLength(const TArray<FVector3f>& Vectors, const int32 NumVertices, const int32 NumFrames)
+{
+	TArray<float> FrameMax;
+	FrameMax.SetNumZeroed(NumFrames);
+	ParallelFor(NumFrames, [&](int32 Frame)
+	{
+		float MaxSquared = 0.f;
+		for (int32 Vertex = 0; Vertex < NumVertices; ++Vertex)
+		{
+			MaxSquared = FMath::Max(MaxSquared, Vectors[Frame * NumVertices + Vertex].SizeSquared());
+		}
+		FrameMax[Frame] = FMath::Sqrt(MaxSquared);
+	});
+
+	float Max = 0.f;
+	for (const float Value : FrameMax)
+	{
+		Max = FMath::Max(Max, Value);
+	}
+	return Max;
+}
+
+/* Scales Basis to [-1, 1], returns the scale */
+static float NormalizeBasis(TArrayView<FVector3f> Basis)
+{
+	float Scale = 0.f;
+	for (const FVector3f& Vector : Basis)
+	{
+		Scale = FMath::Max(Scale, Vector.GetAbsMax());
+	}
+
+	if (Scale <= UE_SMALL_NUMBER)
+	{
+		return 1.f;
+	}
+
+	for (FVector3f& Vector : Basis)
+	{
+		Vector /= Scale;
+	}
+	return Scale;
+}
+
+static void ReconstructVectors(const TArray<FVector3f>& Basis, const TArray<FVector2f>& Coefficients, const bool bNormal,
+	const int32 NumBasis, const int32 NumVertices, const int32 Frame, TArrayView<FVector3f> OutVectors)
+{
+	for (int32 Vertex = 0; Vertex < NumVertices; ++Vertex)
+	{
+		FVector3f Vector = FVector3f::ZeroVector;
+		for (int32 Index = 0; Index < NumBasis; ++Index)
+		{
+			const FVector2f& Coefficient = Coefficients[Frame * NumBasis + Index];
+			Vector += Basis[Index * NumVertices + Vertex] * (bNormal ? Coefficient.Y : Coefficient.X);
+		}
+		OutVectors[Vertex] = bNormal ? Vector.GetSafeNormal() : Vector;
+	}
+}
+
+bool FVertexPCA::Compress(TArray<FVector3f>& InOutDeltas, const TArray<FVector3f>& Normals, const int32 InNumVertices, const int32 MaxComponents, const float ErrorBudget,
+	const EAnim2TexturePrecision PositionPrecision, const EAnim2TexturePrecision NormalPrecision)
+{
+	check(InNumVertices > 0);
+	check(InOutDeltas.Num() == Normals.Num() && InOutDeltas.Num() % InNumVertices == 0);
+
+	NumVertices = InNumVertices;
+	NumFrames = InOutDeltas.Num() / InNumVertices;
+	const int32 Length = NumVertices * 3;
+	float* Data = &InOutDeltas.GetData()->X;
+
+	// ---------------------------------------------------------------------------
+	// Basis 0: Mean of all frames, the Deltas are centered around it
+	TArray<double> Mean;
+	Mean.SetNumZeroed(Length);
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		const float* FrameData = Data + static_cast<int64>(Frame) * Length;
+		for (int32 Index = 0; Index < Length; ++Index)
+		{
+			Mean[Index] += FrameData[Index];
+		}
+	}
+
+	ParallelFor(NumFrames, [&](int32 Frame)
+	{
+		float* FrameData = Data + static_cast<int64>(Frame) * Length;
+		for (int32 Index = 0; Index < Length; ++Index)
+		{
+			FrameData[Index] -= static_cast<float>(Mean[Index] / NumFrames);
+		}
+	});
+
+	// ---------------------------------------------------------------------------
+	// Principal Components: Orthogonal Iteration on the Frames x Frames covariance, without building it.
+	// Q = orth(X * (Xt * Q)), its columns converge to the eigenvectors, sorted by eigenvalue.
+	const int32 NumComponents = FMath::Clamp(FMath::Min(MaxComponents, NumFrames - 1), 0, NumFrames);
+
+	TArray<double> Q;          // NumFrames x NumComponents
+	TArray<double> Components; // Length x NumComponents
+	TArray<double> Norms;
+	Q.SetNumUninitialized(NumFrames * NumComponents);
+	Components.SetNumUninitialized(static_cast<int64>(Length) * NumComponents);
+
+	// Components = Xt * Q
+	auto ProjectFrames = [&]()
+	{
+		ParallelFor(NumComponents, [&](int32 Component)
+		{
+			double* ComponentData = Components.GetData() + static_cast<int64>(Component) * Length;
+			FMemory::Memzero(ComponentData, sizeof(double) * Length);
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				const double Weight = Q[Component * NumFrames + Frame];
+				const float* FrameData = Data + static_cast<int64>(Frame) * Length;
+				for (int32 Index = 0; Index < Length; ++Index)
+				{
+					ComponentData[Index] += Weight * FrameData[Index];
+				}
+			}
+		});
+	};
+
+	// Seeded: same animation, same textures
+	FRandomStream Random(NumFrames);
+	for (double& Value : Q)
+	{
+		Value = Random.FRandRange(-1.f, 1.f);
+	}
+	Orthonormalize(Q, NumFrames, NumComponents, Norms);
+
+	constexpr int32 MaxIterations = 100;
+	constexpr double ConvergenceTolerance = 1e-6;
+	TArray<double> NextQ;
+	NextQ.SetNumUninitialized(Q.Num());
+	for (int32 Iteration = 0; Iteration < MaxIterations && NumComponents > 0; ++Iteration)
+	{
+		ProjectFrames();
+
+		// NextQ = X * Components
+		ParallelFor(NumFrames, [&](int32 Frame)
+		{
+			const float* FrameData = Data + static_cast<int64>(Frame) * Length;
+			for (int32 Component = 0; Component < NumComponents; ++Component)
+			{
+				const double* ComponentData = Components.GetData() + static_cast<int64>(Component) * Length;
+				double Dot = 0.0;
+				for (int32 Index = 0; Index < Length; ++Index)
+				{
+					Dot += FrameData[Index] * ComponentData[Index];
+				}
+				NextQ[Component * NumFrames + Frame] = Dot;
+			}
+		});
+		Orthonormalize(NextQ, NumFrames, NumComponents, Norms);
+
+		// Converged when every (non-null) column stays the same
+		double MaxChange = 0.0;
+		for (int32 Component = 0; Component < NumComponents; ++Component)
+		{
+			if (Norms[Component] > UE_DOUBLE_SMALL_NUMBER)
+			{
+				double Dot = 0.0;
+				for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+				{
+					Dot += Q[Component * NumFrames + Frame] * NextQ[Component * NumFrames + Frame];
+				}
+				MaxChange = FMath::Max(MaxChange, 1.0 - FMath::Abs(Dot));
+			}
+		}
+
+		Swap(Q, NextQ);
+		if (MaxChange < ConvergenceTolerance)
+		{
+			break;
+		}
+	}
+
+	// Vertex space Basis, orthonormal
+	ProjectFrames();
+	Orthonormalize(Components, Length, NumComponents, Norms);
+
+	// ---------------------------------------------------------------------------
+	// Keeps the fewest Components that meet the error budget, the Deltas become the residuals
+	TArray<double> ComponentCoefficients; // NumComponents x NumFrames
+	ComponentCoefficients.SetNumZeroed(NumFrames * NumComponents);
+
+	int32 NumKeptComponents = 0;
+	auto CanKeepComponent = [&]()
+	{
+		return NumKeptComponents < NumComponents && Norms[NumKeptComponents] > UE_DOUBLE_SMALL_NUMBER;
+	};
+
+	auto KeepComponent = [&]()
+	{
+		const int32 Component = NumKeptComponents++;
+		const double* ComponentData = Components.GetData() + static_cast<int64>(Component) * Length;
+		ParallelFor(NumFrames, [&](int32 Frame)
+		{
+			float* FrameData = Data + static_cast<int64>(Frame) * Length;
+			double Dot = 0.0;
+			for (int32 Index = 0; Index < Length; ++Index)
+			{
+				Dot += FrameData[Index] * ComponentData[Index];
+			}
+			for (int32 Index = 0; Index < Length; ++Index)
+			{
+				FrameData[Index] -= static_cast<float>(Dot * ComponentData[Index]);
+			}
+			ComponentCoefficients[Component * NumFrames + Frame] = Dot;
+		});
+	};
+
+	// Position Basis of the kept Components, scaled to [-1, 1]. Coefficients.Y keeps the unscaled Coefficient until the Normals are fitted
+	auto SetPositionBasis = [&]()
+	{
+		NumBasis = NumKeptComponents + 1;
+
+		PositionBasis.SetNumUninitialized(NumBasis * NumVertices);
+		for (int32 Index = 0; Index < Length; ++Index)
+		{
+			(&PositionBasis[0].X)[Index] = static_cast<float>(Mean[Index] / NumFrames);
+		}
+		for (int32 Component = 0; Component < NumKeptComponents; ++Component)
+		{
+			float* BasisData = &PositionBasis[(Component + 1) * NumVertices].X;
+			const double* ComponentData = Components.GetData() + static_cast<int64>(Component) * Length;
+			for (int32 Index = 0; Index < Length; ++Index)
+			{
+				BasisData[Index] = static_cast<float>(ComponentData[Index]);
+			}
+		}
+
+		Coefficients.SetNumUninitialized(NumFrames * NumBasis);
+		for (int32 Index = 0; Index < NumBasis; ++Index)
+		{
+			const float PositionScale = NormalizeBasis(TArrayView<FVector3f>(PositionBasis).Slice(Index * NumVertices, NumVertices));
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				const float Coefficient = Index == 0 ? 1.f : static_cast<float>(ComponentCoefficients[(Index - 1) * NumFrames + Frame]);
+				Coefficients[Frame * NumBasis + Index] = FVector2f(Coefficient * PositionScale, Coefficient);
+			}
+		}
+	};
+
+	MaxError = GetMaxVertexLength(InOutDeltas, NumVertices, NumFrames);
+	while (MaxError > ErrorBudget && CanKeepComponent())
+	{
+		KeepComponent();
+		MaxError = GetMaxVertexLength(InOutDeltas, NumVertices, NumFrames);
+	}
+
+	// The texels add their own error: keeps more Components until the frames decoded from them meet the budget
+	SetPositionBasis();
+	MaxError = GetQuantizedMaxError(InOutDeltas, PositionPrecision);
+	while (MaxError > ErrorBudget && CanKeepComponent())
+	{
+		KeepComponent();
+		SetPositionBasis();
+		MaxError = GetQuantizedMaxError(InOutDeltas, PositionPrecision);
+	}
+
+	// ---------------------------------------------------------------------------
+	// Normals share the Coefficients of the Positions: Basis 0 is the mean Normal, 
+	// the others are the least squares fit of the Normals around it: Sum(c * (N - Mean)) / Sum(c * c).
+	// Components are uncorrelated, each one is fitted on its own.
+	NormalBasis.SetNumZeroed(NumBasis * NumVertices);
+	ParallelFor(NumVertices, [&](int32 Vertex)
+	{
+		FVector3f NormalMean = FVector3f::ZeroVector;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			NormalMean += Normals[Frame * NumVertices + Vertex].GetSafeNormal();
+		}
+		NormalMean /= static_cast<float>(NumFrames);
+		NormalBasis[Vertex] = NormalMean;
+
+		for (int32 Component = 0; Component < NumKeptComponents; ++Component)
+		{
+			FVector3d Sum = FVector3d::ZeroVector;
+			double SumSquared = 0.0;
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				const double Coefficient = ComponentCoefficients[Component * NumFrames + Frame];
+				Sum += FVector3d(Normals[Frame * NumVertices + Vertex].GetSafeNormal() - NormalMean) * Coefficient;
+				SumSquared += Coefficient * Coefficient;
+			}
+			NormalBasis[(Component + 1) * NumVertices + Vertex] = SumSquared > UE_DOUBLE_SMALL_NUMBER ? FVector3f(Sum / SumSquared) : FVector3f::ZeroVector;
+		}
+	});
+
+	// Every Normal Basis fits in [-1, 1], its scale moves to the Coefficients
+	for (int32 Index = 0; Index < NumBasis; ++Index)
+	{
+		const float NormalScale = NormalizeBasis(TArrayView<FVector3f>(NormalBasis).Slice(Index * NumVertices, NumVertices));
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			Coefficients[Frame * NumBasis + Index].Y *= NormalScale;
+		}
+	}
+
+	Quantize(PositionPrecision, NormalPrecision, InOutDeltas);
+	MaxError = GetMaxVertexLength(InOutDeltas, NumVertices, NumFrames);
+
+	return MaxError <= ErrorBudget;
+}
+
+/* Rounds Basis to texels of Precision: Basis * 0.5 + 0.5 */
+static void QuantizeBasis(TArray<FVector3f>& Basis, const EAnim2TexturePrecision Precision)
+{
+	for (FVector3f& Vector : Basis)
+	{
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			Vector[Axis] = QuantizeChannel(Vector[Axis] * 0.5f + 0.5f, Precision) * 2.f - 1.f;
+		}
+	}
+}
+
+/* Coefficients are stored as HalfFloat */
+static void QuantizeCoefficients(TArray<FVector2f>& Coefficients)
+{
+	for (FVector2f& Coefficient : Coefficients)
+	{
+		Coefficient = FVector2f(FFloat16(Coefficient.X).GetFloat(), FFloat16(Coefficient.Y).GetFloat());
+	}
+}
+
+float FVertexPCA::GetQuantizedMaxError(const TArray<FVector3f>& Residuals, const EAnim2TexturePrecision PositionPrecision) const
+{
+	TArray<FVector3f> QuantizedBasis = PositionBasis;
+	TArray<FVector2f> QuantizedCoefficients = Coefficients;
+	QuantizeBasis(QuantizedBasis, PositionPrecision);
+	QuantizeCoefficients(QuantizedCoefficients);
+
+	// Error = Original - Quantized = Residual + Unquantized - Quantized
+	TArray<float> FrameMax;
+	FrameMax.SetNumZeroed(NumFrames);
+	ParallelFor(NumFrames, [&](int32 Frame)
+	{
+		TArray<FVector3f> Unquantized, Quantized;
+		Unquantized.SetNumUninitialized(NumVertices);
+		Quantized.SetNumUninitialized(NumVertices);
+		ReconstructVectors(PositionBasis, Coefficients, false, NumBasis, NumVertices, Frame, Unquantized);
+		ReconstructVectors(QuantizedBasis, QuantizedCoefficients, false, NumBasis, NumVertices, Frame, Quantized);
+
+		float MaxSquared = 0.f;
+		for (int32 Vertex = 0; Vertex < NumVertices; ++Vertex)
+		{
+			MaxSquared = FMath::Max(MaxSquared, (Residuals[Frame * NumVertices + Vertex] + Unquantized[Vertex] - Quantized[Vertex]).SizeSquared());
+		}
+		FrameMax[Frame] = FMath::Sqrt(MaxSquared);
+	});
+
+	float Max = 0.f;
+	for (const float Value : FrameMax)
+	{
+		Max = FMath::Max(Max, Value);
+	}
+	return Max;
+}
+
+void FVertexPCA::Quantize(const EAnim2TexturePrecision PositionPrecision, const EAnim2TexturePrecision NormalPrecision, TArray<FVector3f>& InOutResiduals)
+{
+	check(InOutResiduals.Num() == NumFrames * NumVertices);
+
+	const TArray<FVector3f> UnquantizedBasis = PositionBasis;
+	const TArray<FVector2f> UnquantizedCoefficients = Coefficients;
+
+	QuantizeBasis(PositionBasis, PositionPrecision);
+	QuantizeBasis(NormalBasis, NormalPrecision);
+	QuantizeCoefficients(Coefficients);
+
+	// Residual = Original - Quantized = Residual + Unquantized - Quantized
+	ParallelFor(NumFrames, [&](int32 Frame)
+	{
+		TArray<FVector3f> Unquantized, Quantized;
+		Unquantized.SetNumUninitialized(NumVertices);
+		Quantized.SetNumUninitialized(NumVertices);
+		ReconstructVectors(UnquantizedBasis, UnquantizedCoefficients, false, NumBasis, NumVertices, Frame, Unquantized);
+		ReconstructVectors(PositionBasis, Coefficients, false, NumBasis, NumVertices, Frame, Quantized);
+
+		for (int32 Vertex = 0; Vertex < NumVertices; ++Vertex)
+		{
+			InOutResiduals[Frame * NumVertices + Vertex] += Unquantized[Vertex] - Quantized[Vertex];
+		}
+	});
+}
+
+void FVertexPCA::ReconstructFrame(const int32 Frame, TArray<FVector3f>& OutDeltas, TArray<FVector3f>& OutNormals) const
+{
+	OutDeltas.SetNumUninitialized(NumVertices);
+	OutNormals.SetNumUninitialized(NumVertices);
+	ReconstructVectors(PositionBasis, Coefficients, false, NumBasis, NumVertices, Frame, OutDeltas);
+	ReconstructVectors(NormalBasis, Coefficients, true, NumBasis, NumVertices, Frame, OutNormals);
+}
+
+void FVertexPCA::GetPositionBasisTexels(const int32 Basis, TArray<FVector3f>& OutTexels) const
+{
+	OutTexels.SetNumUninitialized(NumVertices);
+	for (int32 Vertex = 0; Vertex < NumVertices; ++Vertex)
+	{
+		OutTexels[Vertex] = PositionBasis[Basis * NumVertices + Vertex] * 0.5f + FVector3f(0.5f);
+	}
+}
+
+void FVertexPCA::GetNormalBasisTexels(const int32 Basis, TArray<FVector3f>& OutTexels) const
+{
+	OutTexels.SetNumUninitialized(NumVertices);
+	for (int32 Vertex = 0; Vertex < NumVertices; ++Vertex)
+	{
+		OutTexels[Vertex] = NormalBasis[Basis * NumVertices + Vertex] * 0.5f + FVector3f(0.5f);
+	}
+}
+
+void FVertexPCA::GetCoefficientTexels(const int32 Frame, TArray<FVector4f>& OutTexels) const
+{
+	OutTexels.SetNumZeroed(GetNumCoefficientTexels(NumBasis));
+	for (int32 Index = 0; Index < NumBasis; ++Index)
+	{
+		const FVector2f& Coefficient = Coefficients[Frame * NumBasis + Index];
+		FVector4f& Texel = OutTexels[Index / 2];
+		if (Index % 2 == 0)
+		{
+			Texel.X = Coefficient.X;
+			Texel.Y = Coefficient.Y;
+		}
+		else
+		{
+			Texel.Z = Coefficient.X;
+			Texel.W = Coefficient.Y;
+		}
+	}
+}
+
+} // end namespace AnimToTexture_Private
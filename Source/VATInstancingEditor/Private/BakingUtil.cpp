@@ -1,16 +1,32 @@
 ﻿#pragma once
 
 #include "BakingUtil.h"
+#include "Animation/AnimSequence.h"
 #include "Engine/SkeletalMesh.h"
 #include "Engine/SkeletalMeshSocket.h"
 #include "Engine/StaticMesh.h"
 #include "AnimToTextureSkeletalMesh.h"
 #include "AnimToTextureUtils.h"
 #include "AnimToTextureMeshMapping.h"
+#include "AnimToTextureErrorAnalysis.h"
+#include "AnimToTextureVertexPCA.h"
+#include "AnimToTextureMorphTargets.h"
+#include "AnimToTextureBounds.h"
 #include "MeshDescription.h"
 #include "Math/Vector.h"
+#include "Algo/StableSort.h"
 #include "VATInstancingEditorModule.h"
 #include "MyAnimToTextureDataAsset.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/Texture2D.h"
+#include "Engine/Texture2DArray.h"
+#include "Misc/PackageName.h"
+#include "Misc/ScopedSlowTask.h"
+#include "UObject/Package.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Animation/AnimInstance.h"
+#include "Engine/World.h"
+#include "Editor.h"
 
 using namespace AnimToTexture_Private;
 
@@ -24,6 +40,93 @@ bool FindBestResolution(const int32 NumFrames, const int32 NumElements, int32& O
 	return bValidResolution;
 }
 
+// First Fit Decreasing. Returns false if Animations don't fit in NumSlices of SliceFrames
+static bool PackAnimationsFirstFitDecreasing(const TArray<int32>& NumAnimFrames, const TArray<int32>& SortedAnims, const int32 NumSlices, const int32 SliceFrames,
+											 TArray<int32>& OutAnimSlices, TArray<int32>& OutAnimSliceStartFrames)
+{
+	TArray<int32> UsedSliceFrames;
+	UsedSliceFrames.Init(0, NumSlices);
+
+	for (const int32 AnimIndex : SortedAnims)
+	{
+		const int32 Slice = UsedSliceFrames.IndexOfByPredicate([&](const int32 Used) { return Used + NumAnimFrames[AnimIndex] <= SliceFrames; });
+		if (Slice == INDEX_NONE)
+		{
+			return false;
+		}
+
+		OutAnimSlices[AnimIndex] = Slice;
+		OutAnimSliceStartFrames[AnimIndex] = UsedSliceFrames[Slice];
+		UsedSliceFrames[Slice] += NumAnimFrames[AnimIndex];
+	}
+	return true;
+}
+
+bool PackAnimationsInSlices(const TArray<int32>& NumAnimFrames, const int32 MaxSliceFrames, const int32 ExtraFramesPerSlice,
+							TArray<int32>& OutAnimSlices, TArray<int32>& OutAnimSliceStartFrames, int32& OutNumSlices, int32& OutNumSliceFrames)
+{
+	int32 TotalFrames = 0;
+	int32 LongestAnim = 0;
+	for (const int32 NumFrames : NumAnimFrames)
+	{
+		TotalFrames += NumFrames;
+		LongestAnim = FMath::Max(LongestAnim, NumFrames);
+	}
+
+	if (LongestAnim > MaxSliceFrames || NumAnimFrames.IsEmpty())
+	{
+		return false;
+	}
+
+	// Longest first
+	TArray<int32> SortedAnims;
+	for (int32 AnimIndex = 0; AnimIndex < NumAnimFrames.Num(); ++AnimIndex)
+	{
+		SortedAnims.Add(AnimIndex);
+	}
+	Algo::StableSortBy(SortedAnims, [&](const int32 AnimIndex) { return -NumAnimFrames[AnimIndex]; });
+
+	TArray<int32> AnimSlices;
+	TArray<int32> AnimSliceStartFrames;
+	AnimSlices.SetNumUninitialized(NumAnimFrames.Num());
+	AnimSliceStartFrames.SetNumUninitialized(NumAnimFrames.Num());
+
+	// For each number of slices, find the lowest slice that fits all animations
+	int32 BestTotalFrames = TNumericLimits<int32>::Max();
+	const int32 MinNumSlices = FMath::DivideAndRoundUp(TotalFrames, MaxSliceFrames);
+	for (int32 NumSlices = MinNumSlices; NumSlices <= NumAnimFrames.Num(); ++NumSlices)
+	{
+		const int32 MinSliceFrames = FMath::Max(LongestAnim, FMath::DivideAndRoundUp(TotalFrames, NumSlices));
+
+		// More slices can not do better than this
+		if (NumSlices * (MinSliceFrames + ExtraFramesPerSlice) >= BestTotalFrames)
+		{
+			break;
+		}
+
+		for (int32 SliceFrames = MinSliceFrames; SliceFrames <= MaxSliceFrames; ++SliceFrames)
+		{
+			const int32 SliceTotalFrames = NumSlices * (SliceFrames + ExtraFramesPerSlice);
+			if (SliceTotalFrames >= BestTotalFrames)
+			{
+				break;
+			}
+
+			if (PackAnimationsFirstFitDecreasing(NumAnimFrames, SortedAnims, NumSlices, SliceFrames, AnimSlices, AnimSliceStartFrames))
+			{
+				BestTotalFrames = SliceTotalFrames;
+				OutAnimSlices = AnimSlices;
+				OutAnimSliceStartFrames = AnimSliceStartFrames;
+				OutNumSlices = NumSlices;
+				OutNumSliceFrames = SliceFrames;
+				break;
+			}
+		}
+	}
+
+	return BestTotalFrames != TNumericLimits<int32>::Max();
+}
+
 
 void SetFullPrecisionUVs(UStaticMesh* StaticMesh, int32 LODIndex, bool bFullPrecision)
 {
@@ -138,47 +241,167 @@ int32 GetAnimationFrameRange(const FAnim2TextureAnimSequenceInfo& Animation, int
 	return OutEndFrame - OutStartFrame + 1;
 }
 
+int32 GetAnimationNumSamples(const FAnim2TextureAnimSequenceInfo& Animation, const float SampleRate, float& OutStartTime)
+{
+	int32 StartFrame;
+	int32 EndFrame;
+	if (GetAnimationFrameRange(Animation, StartFrame, EndFrame) == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+
+	// Range is sampled from its first key, the last sample is at or before its last key
+	OutStartTime = Animation.AnimSequence->GetTimeAtFrame(StartFrame);
+	const float Duration = Animation.AnimSequence->GetTimeAtFrame(EndFrame) - OutStartTime;
 
-void NormalizeVertexData(const TArray<FVector3f>& Deltas,
-												  const TArray<FVector3f>& Normals,
-												  FVector3f& OutMinBBox,
-												  FVector3f& OutSizeBBox,
-												  TArray<FVector3f>& OutNormalizedDeltas,
-												  TArray<FVector3f>& OutNormalizedNormals)
+	return FMath::FloorToInt(Duration * SampleRate + KINDA_SMALL_NUMBER) + 1;
+}
+
+void GetAnimationRootMotion(const FAnim2TextureAnimSequenceInfo& Animation, const int32 NumSamples, const float SampleRate, const float StartTime,
+							const FTransform& RootTransform, TArray<FVector4f>& OutRootMotion)
 {
-	check(Deltas.Num() == Normals.Num());
+	OutRootMotion.Reset();
+
+	const UAnimSequence* AnimSequence = Animation.AnimSequence;
+	if (!AnimSequence || !AnimSequence->HasRootMotion())
+	{
+		return;
+	}
+
+	OutRootMotion.SetNumUninitialized(NumSamples);
+	float Yaw = 0.f;
+	for (int32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+	{
+		const float Time = StartTime + static_cast<float>(SampleIndex) / SampleRate;
+		const FTransform Motion = AnimSequence->ExtractRootMotionFromRange(StartTime, Time);
+		const FVector Translation = RootTransform.TransformVector(Motion.GetTranslation());
+
+		// 展开角度，相邻帧之间插值时不会跨越±180
+		Yaw += FMath::FindDeltaAngleDegrees(Yaw, static_cast<float>(Motion.Rotator().Yaw));
+		OutRootMotion[SampleIndex] = FVector4f(Translation.X, Translation.Y, Translation.Z, Yaw);
+	}
+}
 
-	// ---------------------------------------------------------------------------
-	// Compute Bounding Box
-	//
-	OutMinBBox = {TNumericLimits<float>::Max(), TNumericLimits<float>::Max(), TNumericLimits<float>::Max()};
-	FVector3f MaxBBox = {TNumericLimits<float>::Min(), TNumericLimits<float>::Min(), TNumericLimits<float>::Min()};
 
-	for (const FVector3f& Delta : Deltas)
+void AccumulateBoundingBox(const TArray<FVector3f>& Values, FVector3f& InOutMinBBox, FVector3f& InOutMaxBBox)
+{
+	for (const FVector3f& Value : Values)
 	{
 		// Find Min/Max BoundingBox
-		OutMinBBox.X = FMath::Min(Delta.X, OutMinBBox.X);
-		OutMinBBox.Y = FMath::Min(Delta.Y, OutMinBBox.Y);
-		OutMinBBox.Z = FMath::Min(Delta.Z, OutMinBBox.Z);
+		InOutMinBBox.X = FMath::Min(Value.X, InOutMinBBox.X);
+		InOutMinBBox.Y = FMath::Min(Value.Y, InOutMinBBox.Y);
+		InOutMinBBox.Z = FMath::Min(Value.Z, InOutMinBBox.Z);
+
+		InOutMaxBBox.X = FMath::Max(Value.X, InOutMaxBBox.X);
+		InOutMaxBBox.Y = FMath::Max(Value.Y, InOutMaxBBox.Y);
+		InOutMaxBBox.Z = FMath::Max(Value.Z, InOutMaxBBox.Z);
+	}
+}
+
+
+void AccumulateElementBoundingBoxes(const TArray<FVector3f>& Values, TArray<FVector3f>& InOutMinBBoxes, TArray<FVector3f>& InOutMaxBBoxes)
+{
+	const int32 NumElements = Values.Num();
+	if (InOutMinBBoxes.Num() != NumElements)
+	{
+		InOutMinBBoxes.Init(FVector3f(TNumericLimits<float>::Max()), NumElements);
+		InOutMaxBBoxes.Init(FVector3f(TNumericLimits<float>::Lowest()), NumElements);
+	}
+
+	for (int32 Index = 0; Index < NumElements; ++Index)
+	{
+		InOutMinBBoxes[Index] = FVector3f::Min(Values[Index], InOutMinBBoxes[Index]);
+		InOutMaxBBoxes[Index] = FVector3f::Max(Values[Index], InOutMaxBBoxes[Index]);
+	}
+}
+
+
+void QuantizeElementRanges(const TArray<FVector3f>& MinBBoxes,
+						   const TArray<FVector3f>& MaxBBoxes,
+						   const FVector3f& MinBBox,
+						   const FVector3f& SizeBBox,
+						   const float QuantizationSteps,
+						   TArray<FVector3f>& OutNormalizedMins,
+						   TArray<FVector3f>& OutNormalizedSizes,
+						   TArray<FVector3f>& OutMins,
+						   TArray<FVector3f>& OutSizes)
+{
+	check(MinBBoxes.Num() == MaxBBoxes.Num());
+	const int32 NumElements = MinBBoxes.Num();
+
+	OutNormalizedMins.SetNumUninitialized(NumElements);
+	OutNormalizedSizes.SetNumUninitialized(NumElements);
+	OutMins.SetNumUninitialized(NumElements);
+	OutSizes.SetNumUninitialized(NumElements);
+
+	for (int32 Index = 0; Index < NumElements; ++Index)
+	{
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			// 范围本身也要被量化，Min向下取整、Max向上取整，保证量化后的范围仍然包含所有值
+			float MinStep = 0.f;
+			float MaxStep = 0.f;
+			if (SizeBBox[Axis] > 0.f)
+			{
+				MinStep = FMath::Clamp(FMath::FloorToFloat((MinBBoxes[Index][Axis] - MinBBox[Axis]) / SizeBBox[Axis] * QuantizationSteps), 0.f, QuantizationSteps);
+				MaxStep = FMath::Clamp(FMath::CeilToFloat((MaxBBoxes[Index][Axis] - MinBBox[Axis]) / SizeBBox[Axis] * QuantizationSteps), 0.f, QuantizationSteps);
+			}
+
+			// Avoid empty ranges (static elements)
+			if (MaxStep <= MinStep)
+			{
+				MinStep = FMath::Min(MinStep, QuantizationSteps - 1.f);
+				MaxStep = MinStep + 1.f;
+			}
+
+			OutNormalizedMins[Index][Axis] = MinStep / QuantizationSteps;
+			OutNormalizedSizes[Index][Axis] = (MaxStep - MinStep) / QuantizationSteps;
+
+			OutMins[Index][Axis] = MinBBox[Axis] + OutNormalizedMins[Index][Axis] * SizeBBox[Axis];
+			OutSizes[Index][Axis] = OutNormalizedSizes[Index][Axis] * SizeBBox[Axis];
+		}
+	}
+}
+
+
+void NormalizeToElementRanges(const TArray<FVector3f>& Values,
+							  const TArray<FVector3f>& Mins,
+							  const TArray<FVector3f>& Sizes,
+							  TArray<FVector3f>& OutNormalizedValues)
+{
+	check(Values.Num() == Mins.Num() && Values.Num() == Sizes.Num());
+
+	OutNormalizedValues.SetNumUninitialized(Values.Num());
+	for (int32 Index = 0; Index < Values.Num(); ++Index)
+	{
+		const FVector3f& Size = Sizes[Index];
+		const FVector3f NormFactor = {Size.X > 0.f ? 1.f / Size.X : 0.f, Size.Y > 0.f ? 1.f / Size.Y : 0.f, Size.Z > 0.f ? 1.f / Size.Z : 0.f};
 
-		MaxBBox.X = FMath::Max(Delta.X, MaxBBox.X);
-		MaxBBox.Y = FMath::Max(Delta.Y, MaxBBox.Y);
-		MaxBBox.Z = FMath::Max(Delta.Z, MaxBBox.Z);
+		OutNormalizedValues[Index] = (Values[Index] - Mins[Index]) * NormFactor;
 	}
+}
 
-	OutSizeBBox = MaxBBox - OutMinBBox;
+
+void NormalizeVertexFrame(const TArray<FVector3f>& Deltas,
+						  const TArray<FVector3f>& Normals,
+						  const FVector3f& MinBBox,
+						  const FVector3f& SizeBBox,
+						  TArray<FVector3f>& OutNormalizedDeltas,
+						  TArray<FVector3f>& OutNormalizedNormals)
+{
+	check(Deltas.Num() == Normals.Num());
 
 	// ---------------------------------------------------------------------------
 	// Normalize Vertex Position Deltas
 	// Basically we want all deltas to be between [0, 1]
 
 	// Compute Normalization Factor per-axis.
-	const FVector3f NormFactor = {1.f / static_cast<float>(OutSizeBBox.X), 1.f / static_cast<float>(OutSizeBBox.Y), 1.f / static_cast<float>(OutSizeBBox.Z)};
+	const FVector3f NormFactor = {1.f / static_cast<float>(SizeBBox.X), 1.f / static_cast<float>(SizeBBox.Y), 1.f / static_cast<float>(SizeBBox.Z)};
 
 	OutNormalizedDeltas.SetNumUninitialized(Deltas.Num());
 	for (int32 Index = 0; Index < Deltas.Num(); ++Index)
 	{
-		OutNormalizedDeltas[Index] = (Deltas[Index] - OutMinBBox) * NormFactor;
+		OutNormalizedDeltas[Index] = (Deltas[Index] - MinBBox) * NormFactor;
 	}
 
 	// ---------------------------------------------------------------------------
@@ -193,48 +416,26 @@ void NormalizeVertexData(const TArray<FVector3f>& Deltas,
 }
 
 
-
-
-void NormalizeBoneData(const TArray<FVector3f>& Positions,
-												const TArray<FVector4f>& Rotations,
-												FVector3f& OutMinBBox,
-												FVector3f& OutSizeBBox,
-												TArray<FVector3f>& OutNormalizedPositions,
-												TArray<FVector4f>& OutNormalizedRotations)
+void NormalizeBoneFrame(const TArray<FVector3f>& Positions,
+						const TArray<FVector4f>& Rotations,
+						const FVector3f& MinBBox,
+						const FVector3f& SizeBBox,
+						TArray<FVector3f>& OutNormalizedPositions,
+						TArray<FVector4f>& OutNormalizedRotations)
 {
 	check(Positions.Num() == Rotations.Num());
 
-	// ---------------------------------------------------------------------------
-	// Compute Position Bounding Box
-	//
-	OutMinBBox = {TNumericLimits<float>::Max(), TNumericLimits<float>::Max(), TNumericLimits<float>::Max()};
-	FVector3f MaxBBox = {TNumericLimits<float>::Min(), TNumericLimits<float>::Min(), TNumericLimits<float>::Min()};
-
-	for (const FVector3f& Position : Positions)
-	{
-		// Find Min/Max BoundingBox
-		OutMinBBox.X = FMath::Min(Position.X, OutMinBBox.X);
-		OutMinBBox.Y = FMath::Min(Position.Y, OutMinBBox.Y);
-		OutMinBBox.Z = FMath::Min(Position.Z, OutMinBBox.Z);
-
-		MaxBBox.X = FMath::Max(Position.X, MaxBBox.X);
-		MaxBBox.Y = FMath::Max(Position.Y, MaxBBox.Y);
-		MaxBBox.Z = FMath::Max(Position.Z, MaxBBox.Z);
-	}
-
-	OutSizeBBox = MaxBBox - OutMinBBox;
-
 	// ---------------------------------------------------------------------------
 	// Normalize Bone Position.
 	// Basically we want all positions to be between [0, 1]
 
 	// Compute Normalization Factor per-axis.
-	const FVector3f NormFactor = {1.f / static_cast<float>(OutSizeBBox.X), 1.f / static_cast<float>(OutSizeBBox.Y), 1.f / static_cast<float>(OutSizeBBox.Z)};
+	const FVector3f NormFactor = {1.f / static_cast<float>(SizeBBox.X), 1.f / static_cast<float>(SizeBBox.Y), 1.f / static_cast<float>(SizeBBox.Z)};
 
 	OutNormalizedPositions.SetNumUninitialized(Positions.Num());
 	for (int32 Index = 0; Index < Positions.Num(); ++Index)
 	{
-		OutNormalizedPositions[Index] = (Positions[Index] - OutMinBBox) * NormFactor;
+		OutNormalizedPositions[Index] = (Positions[Index] - MinBBox) * NormFactor;
 	}
 
 	// ---------------------------------------------------------------------------
@@ -253,6 +454,174 @@ void NormalizeBoneData(const TArray<FVector3f>& Positions,
 }
 
 
+float EncodeBoneRotations(const TArray<FVector4f>& Rotations, TArray<FColor>& OutEncodedRotations)
+{
+	float MaxError = 0.f;
+
+	OutEncodedRotations.SetNumUninitialized(Rotations.Num());
+	for (int32 Index = 0; Index < Rotations.Num(); ++Index)
+	{
+		const FVector4f& Rotation = Rotations[Index];
+		const FQuat4f Quat(FVector3f(Rotation).GetSafeNormal(), Rotation.W);
+
+		OutEncodedRotations[Index] = EncodeQuaternion(Quat);
+
+		// Round-Trip Error
+		MaxError = FMath::Max(MaxError, Quat.AngularDistance(DecodeQuaternion(OutEncodedRotations[Index])));
+	}
+
+	return MaxError;
+}
+
+float GetMaxDualQuaternionComponent(const TArray<FVector3f>& RefPositions, const TArray<FVector3f>& Positions, const TArray<FVector4f>& Rotations)
+{
+	check(RefPositions.Num() == Positions.Num() && Positions.Num() == Rotations.Num());
+
+	float MaxComponent = 0.f;
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		FVector4f Real, Dual;
+		BoneToDualQuaternion(RefPositions[Index], Positions[Index], Rotations[Index], Real, Dual);
+		MaxComponent = FMath::Max(MaxComponent, FMath::Max(FVector3f(Dual).GetAbsMax(), FMath::Abs(Dual.W)));
+	}
+
+	return MaxComponent;
+}
+
+void EncodeDualQuaternionFrame(const TArray<FVector3f>& RefPositions, const TArray<FVector3f>& Positions, const TArray<FVector4f>& Rotations, const float DualScale,
+							   TArray<FVector4f>& OutTexels)
+{
+	check(RefPositions.Num() == Positions.Num() && Positions.Num() == Rotations.Num());
+
+	OutTexels.SetNumUninitialized(Positions.Num() * 2);
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		FVector4f Real, Dual;
+		BoneToDualQuaternion(RefPositions[Index], Positions[Index], Rotations[Index], Real, Dual);
+		EncodeDualQuaternion(Real, Dual, DualScale, OutTexels[Index * 2], OutTexels[Index * 2 + 1]);
+	}
+}
+
+
+int32 GetNumBoneInfluences(const UMyAnimToTextureDataAsset* DataAsset)
+{
+	switch (DataAsset->NumBoneInfluences)
+	{
+		case EAnim2TextureNumBoneInfluences::One:
+			return 1;
+		case EAnim2TextureNumBoneInfluences::Two:
+			return 2;
+		default:
+			return 4;
+	}
+}
+
+
+void GetInfluencingBones(const UMyAnimToTextureDataAsset* DataAsset, const TArray<VertexSkinWeightFour>& SkinWeights, const int32 NumInfluences, TArray<int32>& OutBones)
+{
+	const USkeletalMesh* SkeletalMesh = DataAsset->GetSkeletalMesh();
+	check(SkeletalMesh);
+
+	const FReferenceSkeleton& RefSkeleton = SkeletalMesh->GetRefSkeleton();
+	TBitArray<> IsBaked(false, RefSkeleton.GetRawBoneNum());
+
+	for (const VertexSkinWeightFour& SkinWeight : SkinWeights)
+	{
+		for (int32 Influence = 0; Influence < NumInfluences; ++Influence)
+		{
+			if (SkinWeight.BoneWeights[Influence] > 0)
+			{
+				IsBaked[SkinWeight.MeshBoneIndices[Influence]] = true;
+			}
+		}
+	}
+
+	// 感兴趣的骨骼(或Socket所在的骨骼)也保留
+	auto AddBoneOrSocket = [&](const FName BoneOrSocketName)
+	{
+		int32 BoneIndex = RefSkeleton.FindRawBoneIndex(BoneOrSocketName);
+		if (BoneIndex == INDEX_NONE)
+		{
+			if (const USkeletalMeshSocket* Socket = SkeletalMesh->FindSocket(BoneOrSocketName))
+			{
+				BoneIndex = RefSkeleton.FindRawBoneIndex(Socket->BoneName);
+			}
+		}
+		if (BoneIndex != INDEX_NONE)
+		{
+			IsBaked[BoneIndex] = true;
+		}
+	};
+
+	for (const FName BoneOrSocketName : DataAsset->BoneOrSocketsOfInterestForAllAnimSequences)
+	{
+		AddBoneOrSocket(BoneOrSocketName);
+	}
+	for (const FAnim2TextureAnimSequenceInfo& AnimSequenceInfo : DataAsset->AnimSequences)
+	{
+		for (const FName BoneOrSocketName : AnimSequenceInfo.BoneOrSocketsOfInterest)
+		{
+			AddBoneOrSocket(BoneOrSocketName);
+		}
+	}
+
+	OutBones.Reset();
+	for (TConstSetBitIterator<> It(IsBaked); It; ++It)
+	{
+		OutBones.Add(It.GetIndex());
+	}
+}
+
+
+void CompactBoneFrame(const TArray<int32>& BakedBones, TArray<FVector3f>& InOutPositions, TArray<FVector4f>& InOutRotations)
+{
+	// BakedBones is sorted, elements only move towards the front
+	for (int32 Index = 0; Index < BakedBones.Num(); ++Index)
+	{
+		InOutPositions[Index] = InOutPositions[BakedBones[Index]];
+		InOutRotations[Index] = InOutRotations[BakedBones[Index]];
+	}
+
+	InOutPositions.SetNum(BakedBones.Num(), false);
+	InOutRotations.SetNum(BakedBones.Num(), false);
+}
+
+
+bool RemapSkinWeightsToBakedBones(const TArray<int32>& BakedBones, const int32 NumInfluences, TArray<VertexSkinWeightFour>& InOutSkinWeights, int32& OutMissingBone)
+{
+	TMap<int32, int32> RawToBakedBone;
+	RawToBakedBone.Reserve(BakedBones.Num());
+	for (int32 Index = 0; Index < BakedBones.Num(); ++Index)
+	{
+		RawToBakedBone.Add(BakedBones[Index], Index);
+	}
+
+	OutMissingBone = INDEX_NONE;
+	for (VertexSkinWeightFour& SkinWeight : InOutSkinWeights)
+	{
+		for (int32 Influence = 0; Influence < 4; ++Influence)
+		{
+			if (const int32* BakedBone = RawToBakedBone.Find(SkinWeight.MeshBoneIndices[Influence]))
+			{
+				SkinWeight.MeshBoneIndices[Influence] = *BakedBone;
+			}
+			// Influences the Material doesn't sample (or without weight) can point to any baked Bone
+			else if (Influence >= NumInfluences || SkinWeight.BoneWeights[Influence] == 0)
+			{
+				SkinWeight.MeshBoneIndices[Influence] = 0;
+			}
+			else
+			{
+				OutMissingBone = SkinWeight.MeshBoneIndices[Influence];
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
 bool CheckDataAsset(const UMyAnimToTextureDataAsset* DataAsset, int32& OutSocketIndex)
 {
 	// Check StaticMesh
@@ -304,10 +673,6 @@ bool CheckDataAsset(const UMyAnimToTextureDataAsset* DataAsset, int32& OutSocket
 			UE_LOG(LogVATInstancingEditor, Warning, TEXT("Socket: %s not found in Raw Bone List"), *DataAsset->AttachToSocket.ToString());
 			return false;
 		}
-		else
-		{
-			// TODO: SocketIndex can only be < TNumericLimits<uint16>::Max()
-		}
 	}
 
 	// 我修改了ConvertSkeletalMeshToStaticMesh，使得其默认不生成lightmap。 跳过这个检查?
@@ -318,14 +683,108 @@ bool CheckDataAsset(const UMyAnimToTextureDataAsset* DataAsset, int32& OutSocket
 		return false;
 	}
 
-	// TODO: Maybe more bones is OK?
+	// Every LOD gets the Bone Id UVChannels
+	if (DataAsset->Mode == EAnim2TextureMode::Bone && DataAsset->bBakeAllStaticMeshLODs)
+	{
+		const UStaticMesh* StaticMesh = DataAsset->GetStaticMesh();
+		for (int32 LODIndex = 0; LODIndex < StaticMesh->GetNumSourceModels(); ++LODIndex)
+		{
+			const FMeshBuildSettings& BuildSettings = StaticMesh->GetSourceModel(LODIndex).BuildSettings;
+			if (StaticMesh->IsSourceModelValid(LODIndex) && BuildSettings.bGenerateLightmapUVs
+				&& (BuildSettings.DstLightmapIndex == DataAsset->UVChannel || BuildSettings.DstLightmapIndex == DataAsset->UVChannel + 1))
+			{
+				UE_LOG(LogVATInstancingEditor, Warning, TEXT("Invalid StaticMesh UVChannel: %i. Already used by LightMap of LOD %i"), DataAsset->UVChannel, LODIndex);
+				return false;
+			}
+		}
+	}
+
+	// Bone (and Socket) indices are 16 bits in the Skin Weights, and stay exact in the full precision Bone Id UVs
 	const int32 NumBones = AnimToTexture_Private::GetNumBones(DataAsset->GetSkeletalMesh());
-	if (NumBones > 256)
+	constexpr int32 MaxBones = TNumericLimits<uint16>::Max();
+	if (NumBones > MaxBones)
 	{
-		UE_LOG(LogVATInstancingEditor, Warning, TEXT("Too many Bones: %i. There is a maximum of 256 bones"), NumBones);
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("Too many Bones: %i. There is a maximum of %i bones"), NumBones, MaxBones);
 		return false;
 	}
 
+	if (DataAsset->Mode == EAnim2TextureMode::Bone && DataAsset->bUseTextureArray && DataAsset->bRemoveDuplicateFrames)
+	{
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("bRemoveDuplicateFrames is not supported with Texture Arrays"));
+		return false;
+	}
+
+	// HalfFloat Positions have no range to normalize with
+	if (DataAsset->PositionPrecision == EAnim2TexturePrecision::HalfFloat && DataAsset->PositionRangeMode == EAnim2TextureRangeMode::PerElement
+		&& !DataAsset->bSelectPrecisionFromErrorBudget)
+	{
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("HalfFloat PositionPrecision needs Global PositionRangeMode"));
+		return false;
+	}
+
+	// Dual Quaternions replace the Bone Position range, and there is no Rotation Texture to stream
+	if (DataAsset->RotationFormat == EAnim2TextureRotationFormat::DualQuaternion)
+	{
+		if (DataAsset->Mode != EAnim2TextureMode::Bone || DataAsset->PositionRangeMode != EAnim2TextureRangeMode::Global)
+		{
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("DualQuaternion RotationFormat needs Bone Mode and Global PositionRangeMode"));
+			return false;
+		}
+
+		if (DataAsset->bUseTextureArray && DataAsset->bStreamTexturePages)
+		{
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("bStreamTexturePages is not supported with DualQuaternion RotationFormat"));
+			return false;
+		}
+	}
+
+	// Compressed frames are basis, not frames: no ranges, duplicates or precision selection
+	if (DataAsset->Mode == EAnim2TextureMode::Vertex && DataAsset->bCompressVertexFrames)
+	{
+		if (DataAsset->PositionRangeMode == EAnim2TextureRangeMode::PerElement || DataAsset->bRemoveDuplicateFrames || DataAsset->bSelectPrecisionFromErrorBudget)
+		{
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("bCompressVertexFrames is not supported with PerElement PositionRangeMode, bRemoveDuplicateFrames or bSelectPrecisionFromErrorBudget"));
+			return false;
+		}
+
+		if (!DataAsset->GetVertexCoefficientTexture())
+		{
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("Invalid VertexCoefficientTexture"));
+			return false;
+		}
+	}
+
+	// Morph deltas are written per animation frame, next to the Bone Textures of this DataAsset
+	if (DataAsset->Mode == EAnim2TextureMode::Bone && DataAsset->bBakeMorphTargets)
+	{
+		if (DataAsset->bUseTextureArray || DataAsset->bRemoveDuplicateFrames || DataAsset->GetAnimationLibrary())
+		{
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("bBakeMorphTargets is not supported with Texture Arrays, bRemoveDuplicateFrames or an AnimationLibrary"));
+			return false;
+		}
+
+		const int32 MorphUVChannel = DataAsset->MorphUVChannel;
+		if (MorphUVChannel < 0 || MorphUVChannel >= MAX_MESH_TEXTURE_COORDS
+			|| MorphUVChannel == DataAsset->UVChannel || MorphUVChannel == DataAsset->UVChannel + 1
+			|| (SourceModel.BuildSettings.bGenerateLightmapUVs && SourceModel.BuildSettings.DstLightmapIndex == MorphUVChannel))
+		{
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("Invalid MorphUVChannel: %i. Already used by Bone Ids or LightMap"), MorphUVChannel);
+			return false;
+		}
+
+		if (!DataAsset->GetMorphDeltaTexture())
+		{
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("Invalid MorphDeltaTexture"));
+			return false;
+		}
+	}
+
+	// AnimSequences are taken from the Library
+	if (DataAsset->GetAnimationLibrary())
+	{
+		return CheckAnimationLibrary(DataAsset);
+	}
+
 	for (const FAnim2TextureAnimSequenceInfo& AnimSequenceInfo : DataAsset->AnimSequences)
 	{
 		if (const UAnimSequence* AnimSequence = AnimSequenceInfo.AnimSequence)
@@ -356,11 +815,127 @@ bool CheckDataAsset(const UMyAnimToTextureDataAsset* DataAsset, int32& OutSocket
 }
 
 
-int32 GetRefBonePositionsAndRotations(const USkeletalMesh* SkeletalMesh, TArray<FVector3f>& OutBoneRefPositions, TArray<FVector4f>& OutBoneRefRotations)
+bool CheckAnimationLibrary(const UMyAnimToTextureDataAsset* DataAsset)
 {
-	check(SkeletalMesh);
+	const UMyAnimToTextureDataAsset* Library = DataAsset->GetAnimationLibrary();
+	check(Library);
 
-	OutBoneRefPositions.Reset();
+	if (Library == DataAsset || Library->GetAnimationLibrary())
+	{
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("Invalid AnimationLibrary: %s. It can not use an AnimationLibrary itself"), *Library->GetName());
+		return false;
+	}
+
+	// DualQuaternion stores the rotations in the Bone Position Texture, there is no Rotation Texture
+	const bool bNeedsRotationTexture = Library->RotationFormat != EAnim2TextureRotationFormat::DualQuaternion;
+	const bool bHasTextures = Library->NumTextureSlices
+		? Library->GetBonePositionTextureArray() && (!bNeedsRotationTexture || Library->GetBoneRotationTextureArray())
+		: Library->GetBonePositionTexture() && (!bNeedsRotationTexture || Library->GetBoneRotationTexture());
+	if (!Library->NumFrames || !bHasTextures)
+	{
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("AnimationLibrary: %s has not been baked"), *Library->GetName());
+		return false;
+	}
+
+	const USkeletalMesh* LibrarySkeletalMesh = Library->GetSkeletalMesh();
+	if (!LibrarySkeletalMesh || !DataAsset->GetSkeletalMesh()->GetSkeleton()->IsCompatibleForEditor(LibrarySkeletalMesh->GetSkeleton()))
+	{
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("AnimationLibrary: %s uses a different Skeleton"), *Library->GetName());
+		return false;
+	}
+
+	// Bone Ids in the Skin Weights index the Library textures
+	TArray<FName> BoneNames;
+	TArray<FName> LibraryBoneNames;
+	AnimToTexture_Private::GetBoneNames(DataAsset->GetSkeletalMesh(), BoneNames);
+	AnimToTexture_Private::GetBoneNames(LibrarySkeletalMesh, LibraryBoneNames);
+	if (BoneNames != LibraryBoneNames)
+	{
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("AnimationLibrary: %s Bones do not match SkeletalMesh: %s"), *Library->GetName(), *DataAsset->GetSkeletalMesh()->GetName());
+		return false;
+	}
+
+	return true;
+}
+
+
+void CopyAnimationLibrary(UMyAnimToTextureDataAsset* DataAsset)
+{
+	const UMyAnimToTextureDataAsset* Library = DataAsset->GetAnimationLibrary();
+	check(Library);
+
+	// Animation
+	DataAsset->RootTransform = Library->RootTransform;
+	DataAsset->SampleRate = Library->SampleRate;
+	DataAsset->bInterpolateFrames = Library->bInterpolateFrames;
+	DataAsset->BoundsFramesPerRange = Library->BoundsFramesPerRange;
+	DataAsset->bBakeRootMotion = Library->bBakeRootMotion;
+	DataAsset->SocketFramesPerKey = Library->SocketFramesPerKey;
+	DataAsset->AnimSequences = Library->AnimSequences;
+	DataAsset->BoneOrSocketsOfInterestForAllAnimSequences = Library->BoneOrSocketsOfInterestForAllAnimSequences;
+
+	// Texture
+	DataAsset->PositionPrecision = Library->PositionPrecision;
+	DataAsset->RotationPrecision = Library->RotationPrecision;
+	DataAsset->RotationFormat = Library->RotationFormat;
+	DataAsset->PositionRangeMode = Library->PositionRangeMode;
+	DataAsset->bStripUnusedBones = Library->bStripUnusedBones;
+	DataAsset->bRemoveDuplicateFrames = Library->bRemoveDuplicateFrames;
+	DataAsset->BonePositionTexture = Library->BonePositionTexture;
+	DataAsset->BoneRotationTexture = Library->BoneRotationTexture;
+	DataAsset->bUseTextureArray = Library->bUseTextureArray;
+	DataAsset->BonePositionTextureArray = Library->BonePositionTextureArray;
+	DataAsset->BoneRotationTextureArray = Library->BoneRotationTextureArray;
+	DataAsset->bStreamTexturePages = Library->bStreamTexturePages;
+
+	// Info
+	DataAsset->AnimationLibraryBakeGuid = Library->BakeGuid;
+	DataAsset->NumFrames = Library->NumFrames;
+	DataAsset->NumBones = Library->NumBones;
+	DataAsset->BakedBones = Library->BakedBones;
+	DataAsset->BoneRowsPerFrame = Library->BoneRowsPerFrame;
+	DataAsset->BoneMinBBox = Library->BoneMinBBox;
+	DataAsset->BoneSizeBBox = Library->BoneSizeBBox;
+	DataAsset->BoneDualQuaternionScale = Library->BoneDualQuaternionScale;
+	DataAsset->NumUniqueFrames = Library->NumUniqueFrames;
+	DataAsset->FrameRemap = Library->FrameRemap;
+	DataAsset->NumTextureSlices = Library->NumTextureSlices;
+	DataAsset->NumSliceFrames = Library->NumSliceFrames;
+	DataAsset->NumLookupFrames = Library->NumLookupFrames;
+	DataAsset->Animations = Library->Animations;
+	DataAsset->BonePositionTexturePages = Library->BonePositionTexturePages;
+	DataAsset->BoneRotationTexturePages = Library->BoneRotationTexturePages;
+	DataAsset->MaxRotationErrorDegrees = Library->MaxRotationErrorDegrees;
+}
+
+
+UTexture2D* FindOrCreateTexturePage(const UTexture2DArray* TextureArray, const int32 Page)
+{
+	check(TextureArray);
+
+	const FString PackageName = FString::Printf(TEXT("%s_Page%02d"), *TextureArray->GetPackage()->GetName(), Page);
+	const FString AssetName = FPackageName::GetLongPackageAssetName(PackageName);
+
+	UTexture2D* Texture = LoadObject<UTexture2D>(nullptr, *(PackageName + TEXT(".") + AssetName), nullptr, LOAD_NoWarn | LOAD_Quiet);
+	if (!Texture)
+	{
+		UPackage* Package = CreatePackage(*PackageName);
+		Texture = NewObject<UTexture2D>(Package, *AssetName, RF_Public | RF_Standalone | RF_Transactional);
+		FAssetRegistryModule::AssetCreated(Texture);
+	}
+
+	// 页面整张加载后拷贝到常驻的TextureArray中，不能只有部分Mip
+	Texture->NeverStream = true;
+	Texture->MarkPackageDirty();
+	return Texture;
+}
+
+
+int32 GetRefBonePositionsAndRotations(const USkeletalMesh* SkeletalMesh, TArray<FVector3f>& OutBoneRefPositions, TArray<FVector4f>& OutBoneRefRotations)
+{
+	check(SkeletalMesh);
+
+	OutBoneRefPositions.Reset();
 	OutBoneRefRotations.Reset();
 
 	// Get Number of RawBones (no virtual)
@@ -379,11 +954,9 @@ int32 GetBonePositionsAndRotations(const USkeletalMeshComponent* SkeletalMeshCom
 															const TArray<FVector3f>& BoneRefPositions,
 															TArray<FVector3f>& BonePositions,
 															TArray<FVector4f>& BoneRotations,
-															int32 SampleIndex,
-															FAnim2TextureAnimSequenceInfo& SeqInfo,
-								   int32 Offset,
-								   TMap<int32, int32> BoneId2InterestListIdThisAnim,
-								   TMap<FName, int32> SocketName2InterestListIdThisAnim)
+								   TArrayView<FTransform> FrameInterestTransforms,
+								   const TMap<int32, int32>& BoneId2InterestListIdThisAnim,
+								   const TMap<FName, int32>& SocketName2InterestListIdThisAnim)
 {
 	check(SkeletalMeshComponent);
 
@@ -407,14 +980,9 @@ int32 GetBonePositionsAndRotations(const USkeletalMeshComponent* SkeletalMeshCom
 	BonePositions.SetNumUninitialized(NumBones);
 	BoneRotations.SetNumUninitialized(NumBones);
 
-	const int32 TotalNum = SeqInfo.BoneOrSocketsOfInterest.Num() + Offset;
-	const int32 FrameOffset = SampleIndex * TotalNum;
-	for (auto [SocketName, InterestListId] : SocketName2InterestListIdThisAnim)
+	for (const auto& [SocketName, InterestListId] : SocketName2InterestListIdThisAnim)
 	{
-		FTransform SocketTrans = SkeletalMeshComponent->GetSocketTransform(SocketName, RTS_Component);
-
-		SeqInfo.BoneComponentSpaceTransforms[FrameOffset + InterestListId].Location = SocketTrans.GetLocation();
-		SeqInfo.BoneComponentSpaceTransforms[FrameOffset + InterestListId].Rotation = SocketTrans.GetRotation();
+		FrameInterestTransforms[InterestListId] = SkeletalMeshComponent->GetSocketTransform(SocketName, RTS_Component);
 	}
 
 	for (int32 BoneIndex = 0; BoneIndex < NumBones; BoneIndex++)
@@ -424,8 +992,7 @@ int32 GetBonePositionsAndRotations(const USkeletalMeshComponent* SkeletalMeshCom
 
 		if (auto InterestListId = BoneId2InterestListIdThisAnim.Find(BoneIndex))
 		{
-			SeqInfo.BoneComponentSpaceTransforms[FrameOffset + *InterestListId].Location = CompSpaceTransform.GetLocation();
-			SeqInfo.BoneComponentSpaceTransforms[FrameOffset + *InterestListId].Rotation = CompSpaceTransform.GetRotation();
+			FrameInterestTransforms[*InterestListId] = CompSpaceTransform;
 		}
 
 		FVector3f BonePosition;
@@ -450,7 +1017,8 @@ int32 GetBonePositionsAndRotations(const USkeletalMeshComponent* SkeletalMeshCom
 }
 
 
-bool WriteVtxIdToNewUvChannel(UStaticMesh* StaticMesh, const int32 LODIndex, const int32 UVChannelIndex, const int32 Height, const int32 Width)
+/* Writes a UV per StaticMesh vertex (MeshDescription VertexID) to UVChannelIndex, adding the UVChannel after the last one if needed */
+static bool WriteVertexUVsToUvChannel(UStaticMesh* StaticMesh, const int32 LODIndex, const int32 UVChannelIndex, TFunctionRef<FVector2D(const int32 VertexIndex)> GetVertexUV)
 {
 	check(StaticMesh);
 
@@ -487,12 +1055,7 @@ bool WriteVtxIdToNewUvChannel(UStaticMesh* StaticMesh, const int32 LODIndex, con
 	for (const FVertexInstanceID VertexInstanceID : MeshDescription->VertexInstances().GetElementIDs())
 	{
 		const FVertexID VertexID = MeshDescription->GetVertexInstanceVertex(VertexInstanceID);
-		const int32 VertexIndex = VertexID.GetValue();
-
-		float U = (0.5f / (float)Width) + (VertexIndex % Width) / (float)Width;
-		float V = (0.5f / (float)Height) + (VertexIndex / Width) / (float)Height;
-
-		TexCoords.Add(VertexInstanceID, FVector2D(U, V));
+		TexCoords.Add(VertexInstanceID, GetVertexUV(VertexID.GetValue()));
 	}
 
 	// Set Full Precision UVs
@@ -510,5 +1073,789 @@ bool WriteVtxIdToNewUvChannel(UStaticMesh* StaticMesh, const int32 LODIndex, con
 	};
 }
 
+bool WriteVtxIdToNewUvChannel(UStaticMesh* StaticMesh, const int32 LODIndex, const int32 UVChannelIndex, const int32 Height, const int32 Width)
+{
+	return WriteVertexUVsToUvChannel(StaticMesh, LODIndex, UVChannelIndex, [Height, Width](const int32 VertexIndex)
+	{
+		float U = (0.5f / (float)Width) + (VertexIndex % Width) / (float)Width;
+		float V = (0.5f / (float)Height) + (VertexIndex / Width) / (float)Height;
+		return FVector2D(U, V);
+	});
+}
+
+bool WriteMorphSlotsToUvChannel(UStaticMesh* StaticMesh, const int32 LODIndex, const int32 UVChannelIndex, const TArray<int32>& VertexSlots, const int32 NumMorphVertices)
+{
+	return WriteVertexUVsToUvChannel(StaticMesh, LODIndex, UVChannelIndex, [&VertexSlots, NumMorphVertices](const int32 VertexIndex)
+	{
+		// Vertices without Morph slot are skipped by the Material
+		const int32 Slot = VertexSlots.IsValidIndex(VertexIndex) ? VertexSlots[VertexIndex] : INDEX_NONE;
+		return Slot == INDEX_NONE ? FVector2D(-1.f, 0.f) : FVector2D((Slot + 0.5f) / NumMorphVertices, 0.f);
+	});
+}
+
+
+// ---------------------------------------------------------------------------
+// Passes of a full bake
+//
+
+#define LOCTEXT_NAMESPACE "AnimToTextureEditor"
+
+FAnimationFrameSampler::FAnimationFrameSampler(const UMyAnimToTextureDataAsset* InDataAsset)
+	: DataAsset(InDataAsset)
+{
+	// Create Temp Actor
+	check(GEditor);
+	UWorld* World = GEditor->GetEditorWorldContext().World();
+	check(World);
+
+	Actor = World->SpawnActor<AActor>();
+	check(Actor);
+
+	// Create Temp SkeletalMesh Component
+	SkeletalMeshComponent = NewObject<USkeletalMeshComponent>(Actor);
+	SkeletalMeshComponent->SetSkeletalMesh(DataAsset->GetSkeletalMesh());
+	SkeletalMeshComponent->SetForcedLOD(1); // Force to LOD0;
+	SkeletalMeshComponent->SetAnimationMode(EAnimationMode::AnimationSingleNode);
+	SkeletalMeshComponent->SetUpdateAnimationInEditor(true);
+	SkeletalMeshComponent->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+	SkeletalMeshComponent->RegisterComponent();
+
+	// 提取根运动的AnimSequence采样时锁定根骨骼(RootMotionRootLock)，位移只保存在RootMotion中
+	if (DataAsset->bBakeRootMotion && SkeletalMeshComponent->GetAnimInstance())
+	{
+		SkeletalMeshComponent->GetAnimInstance()->SetRootMotionMode(ERootMotionMode::RootMotionFromEverything);
+	}
+}
+
+FAnimationFrameSampler::~FAnimationFrameSampler()
+{
+	// Destroy Temp Component & Actor
+	SkeletalMeshComponent->UnregisterComponent();
+	SkeletalMeshComponent->DestroyComponent();
+	Actor->Destroy();
+}
+
+void FAnimationFrameSampler::ForEachFrame(const FText& PassName, TFunctionRef<void(int32 AnimSequenceIndex, int32 SampleIndex, int32 Frame)> FrameFunc) const
+{
+	const TArray<FAnim2TextureAnimSequenceInfo>& AnimSequences = DataAsset->AnimSequences;
+	for (int32 AnimSequenceIndex = 0; AnimSequenceIndex < AnimSequences.Num(); AnimSequenceIndex++)
+	{
+		const FAnim2TextureAnimSequenceInfo& AnimSequenceInfo = AnimSequences[AnimSequenceIndex];
+		const FAnim2TextureAnimInfo& AnimInfo = DataAsset->Animations[AnimSequenceIndex];
+
+		// Set Animation
+		UAnimSequence* AnimSequence = AnimSequenceInfo.AnimSequence;
+		SkeletalMeshComponent->SetAnimation(AnimSequence);
+
+		// Get Number of Frames
+		float AnimStartTime;
+		const int32 AnimNumFrames = GetAnimationNumSamples(AnimSequenceInfo, AnimInfo.SampleRate, AnimStartTime);
+
+		const float SampleInterval = 1.f / AnimInfo.SampleRate;
+
+		// Progress Bar
+		FFormatNamedArguments Args;
+		Args.Add(TEXT("Pass"), PassName);
+		Args.Add(TEXT("AnimSequenceIndex"), AnimSequenceIndex+1);
+		Args.Add(TEXT("NumAnimSequences"), AnimSequences.Num());
+		Args.Add(TEXT("AnimSequence"), FText::FromString(*AnimSequence->GetFName().ToString()));
+		FScopedSlowTask AnimProgressBar(AnimNumFrames, FText::Format(LOCTEXT("ProcessingAnimSequence", "{Pass} AnimSequence: {AnimSequence} [{AnimSequenceIndex}/{NumAnimSequences}]"), Args), true /*Enabled*/);
+		AnimProgressBar.MakeDialog(false /*bShowCancelButton*/, false /*bAllowInPIE*/);
+
+		for (int32 SampleIndex = 0; SampleIndex < AnimNumFrames; SampleIndex++)
+		{
+			AnimProgressBar.EnterProgressFrame();
+
+			const float Time = AnimStartTime + (static_cast<float>(SampleIndex) * SampleInterval);
+
+			SkeletalMeshComponent->SetPosition(Time);
+			SkeletalMeshComponent->TickAnimation(0.f, false /*bNeedsValidRootMotion*/);
+			SkeletalMeshComponent->RefreshBoneTransforms(nullptr /*TickFunction*/);
+
+			FrameFunc(AnimSequenceIndex, SampleIndex, AnimInfo.StartFrame + SampleIndex);
+		}
+	}
+}
+
+void FAnimToTextureBake::QuantizeRanges()
+{
+	// Note: RefPose is still normalized with the global Bounding Box, it would widen the ranges of every bone.
+	if (HasPerElementRanges())
+	{
+		QuantizeElementRanges(ElementMinBBoxes, ElementMaxBBoxes, MinBBox, MaxBBox - MinBBox, GetQuantizationSteps(DataAsset->PositionPrecision),
+			ElementRangeLookupMins, ElementRangeLookupSizes, ElementRangeMins, ElementRangeSizes);
+	}
+}
+
+FPositionQuantizer FAnimToTextureBake::MakeQuantizer(const FTextureEncoding& Encoding) const
+{
+	return FPositionQuantizer(Encoding, MinBBox, MaxBBox - MinBBox, ElementMinBBoxes, ElementMaxBBoxes);
+}
+
+FQuantizationErrorAnalyzer FAnimToTextureBake::MakeErrorAnalyzer(const FTextureEncoding& Encoding) const
+{
+	FQuantizationErrorAnalyzer Analyzer(Encoding, MakeQuantizer(Encoding), NumVertices, DataAsset->AnimSequences.Num());
+	if (IsBoneMode())
+	{
+		Analyzer.SetSkinning(SourceVertices, SkinWeights, NumInfluences, BakedBoneRefPositions);
+		Analyzer.SetDualQuaternionScale(DataAsset->BoneDualQuaternionScale);
+	}
+	return Analyzer;
+}
+
+bool FindBakeResolution(FAnimToTextureBake& Bake)
+{
+	UMyAnimToTextureDataAsset* DataAsset = Bake.DataAsset;
+
+	// Duplicate frames are only known after sampling, the final height is checked once they are removed
+	const int32 MaxHeight = DataAsset->bRemoveDuplicateFrames ? TNumericLimits<int32>::Max() : DataAsset->MaxHeight;
+
+	if (DataAsset->Mode == EAnim2TextureMode::Vertex)
+	{
+		// Vertex Mode has no RefPose, its frame is only allocated when there are lookup frames after it.
+		// Compressed frames store the mean and up to MaxVertexComponents basis instead
+		const int32 NumTextureFrames = DataAsset->bCompressVertexFrames ? DataAsset->MaxVertexComponents + 1
+			: DataAsset->NumLookupFrames ? DataAsset->GetNumTextureFrames() : DataAsset->NumFrames;
+		if (!FindBestResolution(NumTextureFrames, Bake.NumVertices,
+								Bake.Height, Bake.Width, DataAsset->VertexRowsPerFrame,
+								MaxHeight, DataAsset->MaxWidth))
+		{
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("Vertex Animation data cannot be fit in a %ix%i texture."), DataAsset->MaxHeight, DataAsset->MaxWidth);
+			return false;
+		}
+		return true;
+	}
+
+	if (DataAsset->bUseTextureArray)
+	{
+		if (!FindBestResolution(1, DataAsset->GetNumBoneTexels(),
+			Bake.Height, Bake.Width, DataAsset->BoneRowsPerFrame,
+			DataAsset->MaxHeight, DataAsset->MaxWidth))
+		{
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("Bone Animation data cannot be fit in a %ix%i texture."), DataAsset->MaxHeight, DataAsset->MaxWidth);
+			return false;
+		}
+
+		// Every slice holds whole animations, followed by its own RefPose and lookup frames
+		const int32 ExtraFramesPerSlice = 1 + DataAsset->NumLookupFrames;
+		const int32 MaxSliceFrames = DataAsset->MaxHeight / DataAsset->BoneRowsPerFrame - ExtraFramesPerSlice;
+
+		TArray<int32> NumAnimFrames;
+		for (const FAnim2TextureAnimInfo& AnimInfo : DataAsset->Animations)
+		{
+			NumAnimFrames.Add(AnimInfo.EndFrame - AnimInfo.StartFrame + 1);
+		}
+
+		TArray<int32> AnimSlices;
+		TArray<int32> AnimSliceStartFrames;
+		if (!PackAnimationsInSlices(NumAnimFrames, MaxSliceFrames, ExtraFramesPerSlice,
+			AnimSlices, AnimSliceStartFrames, DataAsset->NumTextureSlices, DataAsset->NumSliceFrames))
+		{
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("Bone Animation data cannot be fit in %ix%i texture slices. Each animation needs to fit in a slice."), DataAsset->MaxHeight, DataAsset->MaxWidth);
+			return false;
+		}
+
+		for (int32 AnimIndex = 0; AnimIndex < DataAsset->Animations.Num(); ++AnimIndex)
+		{
+			FAnim2TextureAnimInfo& AnimInfo = DataAsset->Animations[AnimIndex];
+			AnimInfo.TextureSlice = AnimSlices[AnimIndex];
+			AnimInfo.TextureFrameOffset = AnimSliceStartFrames[AnimIndex] - AnimInfo.StartFrame;
+		}
+
+		// Slices are written one after another
+		Bake.Height = DataAsset->NumTextureSlices * DataAsset->GetNumTextureFrames() * DataAsset->BoneRowsPerFrame;
+	}
+	else
+	{
+		// Note we are adding +1 frame for the ref pose
+		if (!FindBestResolution(DataAsset->GetNumTextureFrames(), DataAsset->GetNumBoneTexels(),
+			Bake.Height, Bake.Width, DataAsset->BoneRowsPerFrame,
+			MaxHeight, DataAsset->MaxWidth))
+		{
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("Bone Animation data cannot be fit in a %ix%i texture."), DataAsset->MaxHeight, DataAsset->MaxWidth);
+			return false;
+		}
+	}
+
+	// 自带的材质函数按 列 = BoneId, 行 = Frame 采样, 还不支持一帧占多行
+	if (DataAsset->BoneRowsPerFrame > 1)
+	{
+		UE_LOG(LogVATInstancingEditor, Error, TEXT("%i Bone texels do not fit in a row of MaxWidth %i. The Materials of the plugin do not support wrapped Bone rows (BoneRowsPerFrame %i): reduce the baked Bones or raise MaxWidth."),
+			DataAsset->GetNumBoneTexels(), DataAsset->MaxWidth, DataAsset->BoneRowsPerFrame);
+		return false;
+	}
+
+	return true;
+}
+
+// Bone frame without the transforms of BoneOrSocketsOfInterest, they were already cached by the first pass
+static void GetBakedBoneFrame(const FAnimToTextureBake& Bake, const FAnimationFrameSampler& Sampler, TArray<FVector3f>& OutPositions, TArray<FVector4f>& OutRotations)
+{
+	const TMap<int32, int32> NoBoneInterest;
+	const TMap<FName, int32> NoSocketInterest;
+	GetBonePositionsAndRotations(Sampler.GetSkeletalMeshComponent(), Bake.BoneRefPositions, OutPositions, OutRotations, {},
+								 NoBoneInterest, NoSocketInterest);
+	if (!Bake.DataAsset->BakedBones.IsEmpty())
+	{
+		CompactBoneFrame(Bake.DataAsset->BakedBones, OutPositions, OutRotations);
+	}
+}
+
+static void GetVertexFrame(const FAnimToTextureBake& Bake, const FAnimationFrameSampler& Sampler, TArray<FVector3f>& OutDeltas, TArray<FVector3f>& OutNormals)
+{
+	GetVertexDeltasAndNormals(Sampler.GetSkeletalMeshComponent(), Bake.DataAsset->SkeletalLODIndex,
+		*Bake.Mapping, Bake.DataAsset->RootTransform,
+		OutDeltas, OutNormals);
+}
+
+void SelectEncodingFromErrorBudget(FAnimToTextureBake& Bake, const FAnimationFrameSampler& Sampler)
+{
+	UMyAnimToTextureDataAsset* DataAsset = Bake.DataAsset;
+	TArray<FTextureEncoding> Encodings = GetCandidateEncodings(DataAsset);
+	TArray<FQuantizationErrorAnalyzer> Candidates;
+
+	if (Bake.IsBoneMode())
+	{
+		// 先只用骨骼估算每个候选的误差上界: 第一个上界在预算内的候选一定会被选中(或更便宜的)，之后的候选不必逐顶点蒙皮
+		TArray<FBoneErrorBound> Bounds;
+		if (!Bake.IsDualQuaternion())
+		{
+			for (const FTextureEncoding& Encoding : Encodings)
+			{
+				Bounds.Emplace(Encoding, Bake.MakeQuantizer(Encoding), Bake.SourceVertices, Bake.SkinWeights, Bake.NumInfluences, Bake.BakedBoneRefPositions);
+			}
+		}
+
+		// Bone frames are kept, the remaining candidates are measured without sampling the animations again
+		TArray<int32> FrameAnimIndices;
+		TArray<FVector3f> AllBonePositions;
+		TArray<FVector4f> AllBoneRotations;
+		TArray<FVector3f> BoneFramePositions;
+		TArray<FVector4f> BoneFrameRotations;
+
+		Sampler.ForEachFrame(LOCTEXT("EvaluatingPass", "Evaluating"), [&](int32 AnimSequenceIndex, int32 SampleIndex, int32 Frame)
+		{
+			GetBakedBoneFrame(Bake, Sampler, BoneFramePositions, BoneFrameRotations);
+
+			for (FBoneErrorBound& Bound : Bounds)
+			{
+				Bound.AddBoneFrame(BoneFramePositions, BoneFrameRotations);
+			}
+
+			FrameAnimIndices.Add(AnimSequenceIndex);
+			AllBonePositions.Append(BoneFramePositions);
+			AllBoneRotations.Append(BoneFrameRotations);
+		});
+
+		const int32 FirstBounded = Bounds.IndexOfByPredicate([&](const FBoneErrorBound& Bound) { return Bound.GetMaxError() <= DataAsset->PositionErrorBudget; });
+		if (FirstBounded != INDEX_NONE && FirstBounded + 1 < Encodings.Num())
+		{
+			UE_LOG(LogVATInstancingEditor, Display, TEXT("%s: %s is bounded under the error budget (%.4f cm), %i more expensive encodings are not measured"),
+				*DataAsset->GetName(), *Encodings[FirstBounded].ToString(DataAsset->Mode), Bounds[FirstBounded].GetMaxError(), Encodings.Num() - FirstBounded - 1);
+			Encodings.SetNum(FirstBounded + 1);
+		}
+
+		for (const FTextureEncoding& Encoding : Encodings)
+		{
+			Candidates.Add(Bake.MakeErrorAnalyzer(Encoding));
+		}
+
+		const int32 NumBakedBones = Bake.BakedBoneRefPositions.Num();
+		FScopedSlowTask MeasureProgressBar(FrameAnimIndices.Num(), LOCTEXT("MeasuringEncodings", "Measuring encodings"), true /*Enabled*/);
+		MeasureProgressBar.MakeDialog(false /*bShowCancelButton*/, false /*bAllowInPIE*/);
+		for (int32 FrameIndex = 0; FrameIndex < FrameAnimIndices.Num(); ++FrameIndex)
+		{
+			MeasureProgressBar.EnterProgressFrame();
+
+			BoneFramePositions.Reset();
+			BoneFramePositions.Append(AllBonePositions.GetData() + FrameIndex * NumBakedBones, NumBakedBones);
+			BoneFrameRotations.Reset();
+			BoneFrameRotations.Append(AllBoneRotations.GetData() + FrameIndex * NumBakedBones, NumBakedBones);
+
+			for (FQuantizationErrorAnalyzer& Candidate : Candidates)
+			{
+				Candidate.AddBoneFrame(FrameAnimIndices[FrameIndex], BoneFramePositions, BoneFrameRotations);
+			}
+		}
+	}
+	else
+	{
+		for (const FTextureEncoding& Encoding : Encodings)
+		{
+			Candidates.Add(Bake.MakeErrorAnalyzer(Encoding));
+		}
+
+		TArray<FVector3f> VertexFrameDeltas;
+		TArray<FVector3f> VertexFrameNormals;
+		Sampler.ForEachFrame(LOCTEXT("EvaluatingPass", "Evaluating"), [&](int32 AnimSequenceIndex, int32 SampleIndex, int32 Frame)
+		{
+			GetVertexFrame(Bake, Sampler, VertexFrameDeltas, VertexFrameNormals);
+
+			for (FQuantizationErrorAnalyzer& Candidate : Candidates)
+			{
+				Candidate.AddVertexFrame(AnimSequenceIndex, VertexFrameDeltas);
+			}
+		});
+	}
+
+	// Candidates are sorted by size, falls back to the most accurate one
+	const FQuantizationErrorAnalyzer* Selected = Candidates.FindByPredicate([&](const FQuantizationErrorAnalyzer& Candidate)
+	{
+		return Candidate.GetTotalError().Max <= DataAsset->PositionErrorBudget;
+	});
+	if (!Selected)
+	{
+		Selected = &Candidates[0];
+		for (const FQuantizationErrorAnalyzer& Candidate : Candidates)
+		{
+			if (Candidate.GetTotalError().Max < Selected->GetTotalError().Max)
+			{
+				Selected = &Candidate;
+			}
+		}
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("No encoding of %s stays under the %.4f cm error budget, using the most accurate one"),
+			*DataAsset->GetName(), DataAsset->PositionErrorBudget);
+	}
+
+	for (const FQuantizationErrorAnalyzer& Candidate : Candidates)
+	{
+		UE_LOG(LogVATInstancingEditor, Display, TEXT("%s %s: max %.4f cm, RMS %.4f cm, %i bytes"), &Candidate == Selected ? TEXT("*") : TEXT(" "),
+			*Candidate.GetEncoding().ToString(DataAsset->Mode), Candidate.GetTotalError().Max, Candidate.GetTotalError().GetRMS(),
+			Candidate.GetEncoding().GetBytesPerElement(DataAsset->Mode));
+	}
+
+	Selected->GetEncoding().ApplyToDataAsset(DataAsset);
+
+	// Global ranges have no lookup frames: the two reserved rows (and the RefPose frame of Vertex Mode) are dropped before the writers are sized.
+	// Texture Array slices keep their packing, each slice is only shorter
+	if (!Bake.HasPerElementRanges() && DataAsset->NumLookupFrames)
+	{
+		DataAsset->NumLookupFrames = 0;
+		Bake.Height = Bake.IsBoneMode() ? FMath::Max(1, DataAsset->NumTextureSlices) * DataAsset->GetNumTextureFrames() * DataAsset->BoneRowsPerFrame
+			: DataAsset->NumFrames * DataAsset->VertexRowsPerFrame;
+	}
+}
+
+// Stores the FrameRemap of removed duplicates, and crops the textures to the frames actually used.
+// Returns false if they do not fit in MaxHeight
+static bool SetTextureFrames(FAnimToTextureBake& Bake, FTextureFrameDeduplicator& Deduplicator, FVectorTextureWriter& WriterA, FVectorTextureWriter& WriterB)
+{
+	UMyAnimToTextureDataAsset* DataAsset = Bake.DataAsset;
+	if (DataAsset->bRemoveDuplicateFrames)
+	{
+		DataAsset->NumUniqueFrames = Deduplicator.GetNumUniqueFrames();
+		DataAsset->FrameRemap = MoveTemp(Deduplicator.GetFrameRemap());
+	}
+
+	// Vertex Mode has no RefPose, its frame is only allocated when there are lookup frames after it
+	const bool bHasRefPoseFrame = Bake.IsBoneMode() || DataAsset->NumLookupFrames > 0;
+	const int32 NumTextureFrames = bHasRefPoseFrame ? DataAsset->GetNumTextureFrames() : DataAsset->GetNumStoredFrames();
+	const int32 NumSlices = FMath::Max(1, DataAsset->NumTextureSlices);
+
+	WriterA.SetNumFrames(NumTextureFrames * NumSlices);
+	WriterB.SetNumFrames(NumTextureFrames * NumSlices);
+	Bake.Height = WriterA.GetHeight();
+
+	const bool bFitsInTexture = Bake.Height / NumSlices <= DataAsset->MaxHeight;
+	if (!bFitsInTexture)
+	{
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("Animation data cannot be fit in a %ix%i texture."), DataAsset->MaxHeight, DataAsset->MaxWidth);
+	}
+	return bFitsInTexture;
+}
+
+bool WriteCompressedVertexTextures(FAnimToTextureBake& Bake, const FAnimationFrameSampler& Sampler, FQuantizationErrorAnalyzer& ErrorAnalyzer, SIZE_T& OutPeakMemory)
+{
+	UMyAnimToTextureDataAsset* DataAsset = Bake.DataAsset;
+	const int32 NumVertices = Bake.NumVertices;
+	DataAsset->VertexMinBBox = Bake.MinBBox;
+	DataAsset->VertexSizeBBox = Bake.MaxBBox - Bake.MinBBox;
+
+	// PCA needs every frame at once
+	TArray<FVector3f> AllFrameDeltas;
+	TArray<FVector3f> AllFrameNormals;
+	AllFrameDeltas.SetNumUninitialized(DataAsset->NumFrames * NumVertices);
+	AllFrameNormals.SetNumUninitialized(DataAsset->NumFrames * NumVertices);
+
+	TArray<FVector3f> VertexFrameDeltas;
+	TArray<FVector3f> VertexFrameNormals;
+	Sampler.ForEachFrame(LOCTEXT("WritingPass", "Writing"), [&](int32 AnimSequenceIndex, int32 SampleIndex, int32 Frame)
+	{
+		GetVertexFrame(Bake, Sampler, VertexFrameDeltas, VertexFrameNormals);
+
+		FMemory::Memcpy(&AllFrameDeltas[Frame * NumVertices], VertexFrameDeltas.GetData(), NumVertices * sizeof(FVector3f));
+		FMemory::Memcpy(&AllFrameNormals[Frame * NumVertices], VertexFrameNormals.GetData(), NumVertices * sizeof(FVector3f));
+	});
+
+	// Deltas become the residuals of the frames decoded from the texels
+	FVertexPCA PCA;
+	if (!PCA.Compress(AllFrameDeltas, AllFrameNormals, NumVertices, DataAsset->MaxVertexComponents, DataAsset->VertexCompressionErrorBudget,
+		DataAsset->PositionPrecision, DataAsset->RotationPrecision))
+	{
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("%i components of %s exceed the %.4f cm compression error budget: %.4f cm decoded from the texels. Increase MaxVertexComponents or PositionPrecision"),
+			DataAsset->MaxVertexComponents, *DataAsset->GetName(), DataAsset->VertexCompressionErrorBudget, PCA.GetMaxError());
+	}
+	DataAsset->NumVertexBasis = PCA.GetNumBasis();
+
+	// Basis take the place of frames
+	Bake.Height = DataAsset->NumVertexBasis * DataAsset->VertexRowsPerFrame;
+	FVectorTextureWriter PositionWriter(DataAsset->PositionPrecision, DataAsset->VertexRowsPerFrame, Bake.Height, Bake.Width);
+	FVectorTextureWriter NormalWriter(DataAsset->RotationPrecision, DataAsset->VertexRowsPerFrame, Bake.Height, Bake.Width);
+	TArray<FVector3f> BasisPositionTexels;
+	TArray<FVector3f> BasisNormalTexels;
+	for (int32 Basis = 0; Basis < DataAsset->NumVertexBasis; ++Basis)
+	{
+		PCA.GetPositionBasisTexels(Basis, BasisPositionTexels);
+		PCA.GetNormalBasisTexels(Basis, BasisNormalTexels);
+		PositionWriter.WriteFrame(Basis, BasisPositionTexels);
+		NormalWriter.WriteFrame(Basis, BasisNormalTexels);
+	}
+
+	// One row of Coefficients per frame
+	const int32 NumFrames = DataAsset->NumFrames;
+	const int32 CoefficientWidth = FVertexPCA::GetNumCoefficientTexels(DataAsset->NumVertexBasis);
+	FVectorTextureWriter CoefficientWriter(EAnim2TexturePrecision::HalfFloat, 1, NumFrames, CoefficientWidth);
+	TArray<FVector4f> CoefficientTexels;
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		PCA.GetCoefficientTexels(Frame, CoefficientTexels);
+		CoefficientWriter.WriteFrame(Frame, CoefficientTexels);
+	}
+
+	for (int32 AnimIndex = 0; AnimIndex < DataAsset->Animations.Num(); ++AnimIndex)
+	{
+		const FAnim2TextureAnimInfo& AnimInfo = DataAsset->Animations[AnimIndex];
+		for (int32 Frame = AnimInfo.StartFrame; Frame <= AnimInfo.EndFrame; ++Frame)
+		{
+			ErrorAnalyzer.AddVertexResiduals(AnimIndex, TArrayView<const FVector3f>(AllFrameDeltas).Slice(Frame * NumVertices, NumVertices));
+		}
+	}
+
+	const bool bFitsInTexture = Bake.Height <= DataAsset->MaxHeight && NumFrames <= DataAsset->MaxHeight;
+	if (!bFitsInTexture)
+	{
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("Animation data cannot be fit in a %ix%i texture."), DataAsset->MaxHeight, DataAsset->MaxWidth);
+	}
+
+	// RGBA texels
+	auto GetBytesPerTexel = [](const EAnim2TexturePrecision Precision) { return Precision == EAnim2TexturePrecision::EightBits ? 4 : 8; };
+	const SIZE_T UncompressedSize = static_cast<SIZE_T>(NumFrames) * DataAsset->VertexRowsPerFrame * Bake.Width
+		* (GetBytesPerTexel(DataAsset->PositionPrecision) + GetBytesPerTexel(DataAsset->RotationPrecision));
+	const SIZE_T CompressedSize = PositionWriter.GetAllocatedSize() + NormalWriter.GetAllocatedSize() + CoefficientWriter.GetAllocatedSize();
+	UE_LOG(LogVATInstancingEditor, Display, TEXT("%s: %i of %i frames stored as basis, max decoded error %.4f cm. %.2f MB instead of %.2f MB"),
+		*DataAsset->GetName(), DataAsset->NumVertexBasis, NumFrames, PCA.GetMaxError(),
+		CompressedSize / (1024.f * 1024.f), UncompressedSize / (1024.f * 1024.f));
+
+	// Pixel buffers are copied once more into the texture sources
+	OutPeakMemory = CompressedSize * 2 + AllFrameDeltas.GetAllocatedSize() + AllFrameNormals.GetAllocatedSize()
+		+ VertexFrameDeltas.GetAllocatedSize() + VertexFrameNormals.GetAllocatedSize();
+
+	// Write Textures
+	if (bFitsInTexture)
+	{
+		PositionWriter.WriteToTexture(DataAsset->GetVertexPositionTexture());
+		NormalWriter.WriteToTexture(DataAsset->GetVertexNormalTexture());
+		CoefficientWriter.WriteToTexture(DataAsset->GetVertexCoefficientTexture());
+	}
+	return bFitsInTexture;
+}
+
+bool WriteVertexTextures(FAnimToTextureBake& Bake, const FAnimationFrameSampler& Sampler, FQuantizationErrorAnalyzer& ErrorAnalyzer, SIZE_T& OutPeakMemory)
+{
+	UMyAnimToTextureDataAsset* DataAsset = Bake.DataAsset;
+	const bool bPerElementRanges = Bake.HasPerElementRanges();
+	DataAsset->VertexMinBBox = Bake.MinBBox;
+	DataAsset->VertexSizeBBox = Bake.MaxBBox - Bake.MinBBox;
+
+	FVectorTextureWriter PositionWriter(DataAsset->PositionPrecision, DataAsset->VertexRowsPerFrame, Bake.Height, Bake.Width);
+	FVectorTextureWriter NormalWriter(DataAsset->RotationPrecision, DataAsset->VertexRowsPerFrame, Bake.Height, Bake.Width);
+	FTextureFrameDeduplicator Deduplicator({ &PositionWriter, &NormalWriter }, DataAsset->NumFrames);
+
+	// Per-Frame scratch buffers, reused by every frame
+	TArray<FVector3f> VertexFrameDeltas;
+	TArray<FVector3f> VertexFrameNormals;
+	TArray<FVector3f> NormalizedFrameDeltas;
+	TArray<FVector3f> NormalizedFrameNormals;
+
+	Sampler.ForEachFrame(LOCTEXT("WritingPass", "Writing"), [&](int32 AnimSequenceIndex, int32 SampleIndex, int32 Frame)
+	{
+		const int32 TextureFrame = DataAsset->bRemoveDuplicateFrames ? Deduplicator.GetNextTextureFrame() : Frame;
+
+		GetVertexFrame(Bake, Sampler, VertexFrameDeltas, VertexFrameNormals);
+
+		// HalfFloat Deltas are stored as they are
+		NormalizeVertexFrame(
+			VertexFrameDeltas, VertexFrameNormals,
+			DataAsset->GetMaterialMinBBox(), DataAsset->GetMaterialSizeBBox(),
+			NormalizedFrameDeltas, NormalizedFrameNormals);
+
+		if (bPerElementRanges)
+		{
+			NormalizeToElementRanges(VertexFrameDeltas, Bake.ElementRangeMins, Bake.ElementRangeSizes, NormalizedFrameDeltas);
+		}
+
+		PositionWriter.WriteFrame(TextureFrame, NormalizedFrameDeltas);
+		NormalWriter.WriteFrame(TextureFrame, NormalizedFrameNormals);
+		ErrorAnalyzer.AddVertexFrame(AnimSequenceIndex, VertexFrameDeltas);
+
+		if (DataAsset->bRemoveDuplicateFrames)
+		{
+			Deduplicator.CommitFrame(Frame);
+		}
+	});
+
+	const bool bFitsInTexture = SetTextureFrames(Bake, Deduplicator, PositionWriter, NormalWriter);
+
+	if (bPerElementRanges)
+	{
+		PositionWriter.WriteFrame(DataAsset->GetNumStoredFrames() + 1, Bake.ElementRangeLookupMins);
+		PositionWriter.WriteFrame(DataAsset->GetNumStoredFrames() + 2, Bake.ElementRangeLookupSizes);
+	}
+
+	// Pixel buffers are copied once more into the texture sources
+	OutPeakMemory = (PositionWriter.GetAllocatedSize() + NormalWriter.GetAllocatedSize()) * 2
+		+ VertexFrameDeltas.GetAllocatedSize() + VertexFrameNormals.GetAllocatedSize()
+		+ NormalizedFrameDeltas.GetAllocatedSize() + NormalizedFrameNormals.GetAllocatedSize();
+
+	// Write Textures
+	if (bFitsInTexture)
+	{
+		PositionWriter.WriteToTexture(DataAsset->GetVertexPositionTexture());
+		NormalWriter.WriteToTexture(DataAsset->GetVertexNormalTexture());
+	}
+	return bFitsInTexture;
+}
+
+/** Writes Bone frames in the RotationFormat of the DataAsset.
+*   AxisAngle and packed Quaternion Rotations go to the Rotation Writer. Dual Quaternions hold the whole transform
+*   in the Position Writer, the Rotation Writer stays empty (0 texels per row). */
+class FBoneFrameWriter
+{
+public:
+	explicit FBoneFrameWriter(const FAnimToTextureBake& InBake)
+		: Bake(InBake)
+		, bDualQuaternion(InBake.IsDualQuaternion())
+		, bQuaternionRotations(InBake.DataAsset->RotationFormat == EAnim2TextureRotationFormat::Quaternion)
+		, PositionWriter(InBake.DataAsset->PositionPrecision, InBake.DataAsset->BoneRowsPerFrame, InBake.Height, InBake.Width)
+		// Packed Quaternions always use 8 bits texels
+		, RotationWriter(bQuaternionRotations ? EAnim2TexturePrecision::EightBits : InBake.DataAsset->RotationPrecision, InBake.DataAsset->BoneRowsPerFrame,
+			InBake.Height, bDualQuaternion ? 0 : InBake.Width)
+	{
+	}
+
+	/* Positions relative to RefPose and AxisAndAngle Rotations, as returned by GetBonePositionsAndRotations */
+	void WriteFrame(const int32 TextureFrame, const TArray<FVector3f>& Positions, const TArray<FVector4f>& Rotations)
+	{
+		const UMyAnimToTextureDataAsset* DataAsset = Bake.DataAsset;
+		if (bDualQuaternion)
+		{
+			EncodeDualQuaternionFrame(Bake.BakedBoneRefPositions, Positions, Rotations, DataAsset->BoneDualQuaternionScale, DualQuaternionTexels);
+			PositionWriter.WriteFrame(TextureFrame, DualQuaternionTexels);
+			return;
+		}
+
+		// HalfFloat Positions are stored as they are
+		NormalizeBoneFrame(
+			Positions, Rotations,
+			DataAsset->GetMaterialMinBBox(), DataAsset->GetMaterialSizeBBox(),
+			NormalizedPositions, NormalizedRotations);
+
+		if (Bake.HasPerElementRanges())
+		{
+			NormalizeToElementRanges(Positions, Bake.ElementRangeMins, Bake.ElementRangeSizes, NormalizedPositions);
+		}
+
+		PositionWriter.WriteFrame(TextureFrame, NormalizedPositions);
+		WriteRotations(TextureFrame, Rotations);
+	}
+
+	/* RefPose after the stored frames of every slice, followed by the lookup frames of PerElement ranges */
+	void WriteRefPoseFrames()
+	{
+		const UMyAnimToTextureDataAsset* DataAsset = Bake.DataAsset;
+
+		// 把RefPose放在Bone Position Texture的最后一帧. RefPose Rotation在顶点着色器中其实用不到，单纯占位罢了
+		// Note: Epic官方把refPose放到第零帧，导致将Frame归一化为SampleUV前要+1，并非最优
+		if (bDualQuaternion)
+		{
+			// Dual Quaternions are relative to RefPose, their RefPose frame is the identity
+			TArray<FVector3f> IdentityPositions;
+			TArray<FVector4f> IdentityRotations;
+			IdentityPositions.Init(FVector3f::ZeroVector, DataAsset->NumBones);
+			IdentityRotations.Init(FVector4f(1.f, 0.f, 0.f, 0.f), DataAsset->NumBones);
+			EncodeDualQuaternionFrame(Bake.BakedBoneRefPositions, IdentityPositions, IdentityRotations, DataAsset->BoneDualQuaternionScale, DualQuaternionTexels);
+		}
+		else
+		{
+			NormalizeBoneFrame(
+				Bake.BakedBoneRefPositions, Bake.BakedBoneRefRotations,
+				DataAsset->GetMaterialMinBBox(), DataAsset->GetMaterialSizeBBox(),
+				NormalizedPositions, NormalizedRotations);
+		}
+
+		// 每个Slice都有自己的RefPose与lookup帧
+		for (int32 Slice = 0; Slice < FMath::Max(1, DataAsset->NumTextureSlices); ++Slice)
+		{
+			const int32 RefPoseFrame = Slice * DataAsset->GetNumTextureFrames() + DataAsset->GetNumStoredFrames();
+			if (bDualQuaternion)
+			{
+				PositionWriter.WriteFrame(RefPoseFrame, DualQuaternionTexels);
+				continue;
+			}
+
+			PositionWriter.WriteFrame(RefPoseFrame, NormalizedPositions);
+			WriteRotations(RefPoseFrame, Bake.BakedBoneRefRotations);
 
+			if (Bake.HasPerElementRanges())
+			{
+				PositionWriter.WriteFrame(RefPoseFrame + 1, Bake.ElementRangeLookupMins);
+				PositionWriter.WriteFrame(RefPoseFrame + 2, Bake.ElementRangeLookupSizes);
+			}
+		}
+	}
+
+	FVectorTextureWriter& GetPositionWriter() { return PositionWriter; }
+	FVectorTextureWriter& GetRotationWriter() { return RotationWriter; }
+
+	/* Max round-trip angular error (radians) of the packed Quaternions */
+	float GetMaxRotationError() const { return MaxRotationError; }
+
+	SIZE_T GetScratchSize() const
+	{
+		return NormalizedPositions.GetAllocatedSize() + NormalizedRotations.GetAllocatedSize()
+			+ EncodedRotations.GetAllocatedSize() + DualQuaternionTexels.GetAllocatedSize();
+	}
+
+private:
+	// NormalizedRotations must hold Rotations normalized by NormalizeBoneFrame
+	void WriteRotations(const int32 TextureFrame, const TArray<FVector4f>& Rotations)
+	{
+		if (bQuaternionRotations)
+		{
+			MaxRotationError = FMath::Max(MaxRotationError, EncodeBoneRotations(Rotations, EncodedRotations));
+			RotationWriter.WriteFrame(TextureFrame, EncodedRotations);
+		}
+		else
+		{
+			RotationWriter.WriteFrame(TextureFrame, NormalizedRotations);
+		}
+	}
+
+	const FAnimToTextureBake& Bake;
+	const bool bDualQuaternion;
+	const bool bQuaternionRotations;
+
+	FVectorTextureWriter PositionWriter;
+	FVectorTextureWriter RotationWriter;
+	float MaxRotationError = 0.f;
+
+	// Per-Frame scratch buffers, reused by every frame
+	TArray<FVector3f> NormalizedPositions;
+	TArray<FVector4f> NormalizedRotations;
+	TArray<FColor> EncodedRotations;
+
+	// Real and Dual texels of every Bone, DualQuaternion only
+	TArray<FVector4f> DualQuaternionTexels;
+};
+
+bool WriteBoneTextures(FAnimToTextureBake& Bake, const FAnimationFrameSampler& Sampler, FQuantizationErrorAnalyzer& ErrorAnalyzer,
+					   const FMorphTargetDeltas* MorphTargetDeltas, const int32 MorphHeight, const int32 MorphWidth,
+					   FAnimationBoundsBuilder& BoundsBuilder, SIZE_T& OutPeakMemory)
+{
+	UMyAnimToTextureDataAsset* DataAsset = Bake.DataAsset;
+	const bool bDualQuaternion = Bake.IsDualQuaternion();
+	DataAsset->BoneMinBBox = Bake.MinBBox;
+	DataAsset->BoneSizeBBox = Bake.MaxBBox - Bake.MinBBox;
+
+	FBoneFrameWriter FrameWriter(Bake);
+	FVectorTextureWriter& PositionWriter = FrameWriter.GetPositionWriter();
+	FVectorTextureWriter& RotationWriter = FrameWriter.GetRotationWriter();
+	FTextureFrameDeduplicator Deduplicator({ &PositionWriter, &RotationWriter }, DataAsset->NumFrames);
+
+	// Texture Arrays and duplicate removal are not supported with Morph Targets: animation frames are texture frames
+	const bool bWriteMorphDeltas = MorphTargetDeltas != nullptr;
+	FVectorTextureWriter MorphWriter(EAnim2TexturePrecision::HalfFloat, DataAsset->MorphRowsPerFrame, bWriteMorphDeltas ? MorphHeight : 0, bWriteMorphDeltas ? MorphWidth : 0);
+	TArray<float> MorphTargetWeights;
+	TArray<FVector3f> MorphFrameDeltas;
+
+	TArray<FVector3f> BoneFramePositions;
+	TArray<FVector4f> BoneFrameRotations;
+
+	// Frame in the Writers, Texture Array slices are stored one after another
+	auto GetWriterFrame = [&](const int32 AnimSequenceIndex, const int32 Frame)
+	{
+		const FAnim2TextureAnimInfo& AnimInfo = DataAsset->Animations[AnimSequenceIndex];
+		return AnimInfo.TextureSlice * DataAsset->GetNumTextureFrames() + Frame + AnimInfo.TextureFrameOffset;
+	};
+
+	Sampler.ForEachFrame(LOCTEXT("WritingPass", "Writing"), [&](int32 AnimSequenceIndex, int32 SampleIndex, int32 Frame)
+	{
+		const int32 TextureFrame = DataAsset->bRemoveDuplicateFrames ? Deduplicator.GetNextTextureFrame() : GetWriterFrame(AnimSequenceIndex, Frame);
+
+		GetBakedBoneFrame(Bake, Sampler, BoneFramePositions, BoneFrameRotations);
+		FrameWriter.WriteFrame(TextureFrame, BoneFramePositions, BoneFrameRotations);
+		ErrorAnalyzer.AddBoneFrame(AnimSequenceIndex, BoneFramePositions, BoneFrameRotations);
+
+		if (bWriteMorphDeltas)
+		{
+			GetMorphTargetWeights(Sampler.GetSkeletalMeshComponent(), MorphTargetWeights);
+			MorphTargetDeltas->GetFrameDeltas(MorphTargetWeights, MorphFrameDeltas);
+			MorphWriter.WriteFrame(Frame, MorphFrameDeltas);
+			BoundsBuilder.AddMorphDeltas(MorphTargetDeltas->GetVertexSlots(), MorphFrameDeltas);
+		}
+
+		if (DataAsset->bRemoveDuplicateFrames)
+		{
+			Deduplicator.CommitFrame(Frame);
+		}
+	});
+
+	const bool bFitsInTexture = SetTextureFrames(Bake, Deduplicator, PositionWriter, RotationWriter);
+	FrameWriter.WriteRefPoseFrames();
+
+	// Pixel buffers are copied once more into the texture sources, and once again into the streamed pages
+	const SIZE_T BoneTextureMemory = PositionWriter.GetAllocatedSize() + RotationWriter.GetAllocatedSize();
+	const SIZE_T PixelMemory = BoneTextureMemory + MorphWriter.GetAllocatedSize();
+	OutPeakMemory = PixelMemory * 2 + (DataAsset->bStreamTexturePages ? BoneTextureMemory : 0)
+		+ FrameWriter.GetScratchSize() + BoneFramePositions.GetAllocatedSize() + BoneFrameRotations.GetAllocatedSize() + MorphFrameDeltas.GetAllocatedSize();
+	DataAsset->MaxRotationErrorDegrees = FMath::RadiansToDegrees(FrameWriter.GetMaxRotationError());
+
+	// Write Textures
+	if (bFitsInTexture && DataAsset->NumTextureSlices)
+	{
+		PositionWriter.WriteToTextureArray(DataAsset->GetBonePositionTextureArray(), DataAsset->NumTextureSlices);
+		if (!bDualQuaternion)
+		{
+			RotationWriter.WriteToTextureArray(DataAsset->GetBoneRotationTextureArray(), DataAsset->NumTextureSlices);
+		}
+
+		// 每个Slice再单独存为一张Texture2D，运行时按需流式加载
+		if (DataAsset->bStreamTexturePages)
+		{
+			for (int32 Slice = 0; Slice < DataAsset->NumTextureSlices; ++Slice)
+			{
+				UTexture2D* PositionPage = FindOrCreateTexturePage(DataAsset->GetBonePositionTextureArray(), Slice);
+				UTexture2D* RotationPage = FindOrCreateTexturePage(DataAsset->GetBoneRotationTextureArray(), Slice);
+				PositionWriter.WriteSliceToTexture(PositionPage, DataAsset->NumTextureSlices, Slice);
+				RotationWriter.WriteSliceToTexture(RotationPage, DataAsset->NumTextureSlices, Slice);
+				DataAsset->BonePositionTexturePages.Add(PositionPage);
+				DataAsset->BoneRotationTexturePages.Add(RotationPage);
+			}
+		}
+	}
+	else if (bFitsInTexture)
+	{
+		PositionWriter.WriteToTexture(DataAsset->GetBonePositionTexture());
+		if (!bDualQuaternion)
+		{
+			RotationWriter.WriteToTexture(DataAsset->GetBoneRotationTexture());
+		}
+		if (bWriteMorphDeltas)
+		{
+			MorphWriter.WriteToTexture(DataAsset->GetMorphDeltaTexture());
+		}
+	}
+	return bFitsInTexture;
+}
 
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,117 @@
+#include "AnimToTextureUtils.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace AnimToTexture_Private
+{
+
+struct FDualQuaternionTestBone
+{
+	FVector3f RefPosition;
+	FVector3f Delta;
+	FVector4f AxisAndAngle;
+};
+
+/* Max position error (cm) of a Bone of a 2m character moving within 5m, with the tightest DualScale.
+*  About 1.3x the error measured over the test bones: 6.2 (8 bits), 0.024 (16 bits), 0.66 (HalfFloat).
+*  It grows linearly with the DualScale, as the Dual texels lose precision */
+static float GetDualQuaternionErrorBound(const EAnim2TexturePrecision Precision)
+{
+	switch (Precision)
+	{
+		case EAnim2TexturePrecision::EightBits:
+			return 8.f;
+		case EAnim2TexturePrecision::HalfFloat:
+			return 1.f;
+		default:
+			return 0.05f;
+	}
+}
+
+} // end namespace AnimToTexture_Private
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAnimToTextureDualQuaternionRoundTripTest, "VATInstancing.AnimToTexture.DualQuaternionRoundTrip",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FAnimToTextureDualQuaternionRoundTripTest::RunTest(const FString& Parameters)
+{
+	using namespace AnimToTexture_Private;
+
+	constexpr float RefExtent = 100.f;
+	constexpr float DeltaExtent = 500.f;
+	constexpr int32 NumRandomBones = 1024;
+	FRandomStream Random(1);
+
+	// Known transforms: identity, half turns (Real.W is zero), a quarter turn far from the origin, then random ones
+	TArray<FDualQuaternionTestBone> Bones;
+	Bones.Add({ FVector3f::ZeroVector, FVector3f::ZeroVector, FVector4f(0.f, 0.f, 1.f, 0.f) });
+	Bones.Add({ FVector3f(0.f, 0.f, 100.f), FVector3f(500.f, 0.f, 0.f), FVector4f(1.f, 0.f, 0.f, PI) });
+	Bones.Add({ FVector3f(50.f, -50.f, 80.f), FVector3f(0.f, 0.f, -300.f), FVector4f(0.f, 1.f, 0.f, PI) });
+	Bones.Add({ FVector3f(-100.f, 0.f, 0.f), FVector3f(-250.f, 250.f, 250.f), FVector4f(0.f, 0.f, 1.f, HALF_PI) });
+	for (int32 Index = 0; Index < NumRandomBones; ++Index)
+	{
+		Bones.Add({ FVector3f(Random.GetUnitVector()) * Random.FRandRange(0.f, RefExtent),
+			FVector3f(Random.GetUnitVector()) * Random.FRandRange(0.f, DeltaExtent),
+			FVector4f(FVector3f(Random.GetUnitVector()), Random.FRandRange(0.f, 2.f * PI)) });
+	}
+
+	TArray<FVector4f> Reals;
+	TArray<FVector4f> Duals;
+	float TightDualScale = UE_SMALL_NUMBER;
+	for (const FDualQuaternionTestBone& Bone : Bones)
+	{
+		BoneToDualQuaternion(Bone.RefPosition, Bone.Delta, Bone.AxisAndAngle, Reals.AddDefaulted_GetRef(), Duals.AddDefaulted_GetRef());
+		TightDualScale = FMath::Max(TightDualScale, FMath::Max(FVector3f(Duals.Last()).GetAbsMax(), FMath::Abs(Duals.Last().W)));
+	}
+
+	// Points around every Bone, the same for all encodings
+	TArray<FVector3f> Points;
+	for (const FDualQuaternionTestBone& Bone : Bones)
+	{
+		for (int32 Point = 0; Point < 4; ++Point)
+		{
+			Points.Add(Bone.RefPosition + FVector3f(Random.GetUnitVector()) * RefExtent);
+		}
+	}
+
+	for (const EAnim2TexturePrecision Precision : { EAnim2TexturePrecision::EightBits, EAnim2TexturePrecision::SixteenBits, EAnim2TexturePrecision::HalfFloat })
+	{
+		auto Quantize = [Precision](const FVector4f& Texel)
+		{
+			return FVector4f(QuantizeChannel(Texel.X, Precision), QuantizeChannel(Texel.Y, Precision), QuantizeChannel(Texel.Z, Precision), QuantizeChannel(Texel.W, Precision));
+		};
+
+		// BoneDualQuaternionScale is the largest Dual component of the bake, larger scales are what other bones of the same bake get
+		for (const float ScaleMultiplier : { 1.f, 2.f, 4.f })
+		{
+			const float DualScale = TightDualScale * ScaleMultiplier;
+			const float ErrorBound = GetDualQuaternionErrorBound(Precision) * ScaleMultiplier;
+
+			float MaxError = 0.f;
+			for (int32 BoneIndex = 0; BoneIndex < Bones.Num(); ++BoneIndex)
+			{
+				const FDualQuaternionTestBone& Bone = Bones[BoneIndex];
+
+				FVector4f RealTexel, DualTexel, Real, Dual;
+				EncodeDualQuaternion(Reals[BoneIndex], Duals[BoneIndex], DualScale, RealTexel, DualTexel);
+				DecodeDualQuaternion(Quantize(RealTexel), Quantize(DualTexel), DualScale, Real, Dual);
+
+				const FQuat4f Rotation(FVector3f(Bone.AxisAndAngle).GetSafeNormal(), Bone.AxisAndAngle.W);
+				for (int32 Point = 0; Point < 4; ++Point)
+				{
+					const FVector3f& Vertex = Points[BoneIndex * 4 + Point];
+					const FVector3f Expected = Rotation.RotateVector(Vertex - Bone.RefPosition) + Bone.RefPosition + Bone.Delta;
+					MaxError = FMath::Max(MaxError, FVector3f::Dist(Expected, TransformByDualQuaternion(Real, Dual, Vertex)));
+				}
+			}
+
+			TestTrue(FString::Printf(TEXT("%s texels, DualScale %.1f: max error %.4f cm within %.4f cm"),
+				*UEnum::GetValueAsString(Precision), DualScale, MaxError, ErrorBound), MaxError <= ErrorBound);
+		}
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,99 @@
+#include "AnimToTextureErrorAnalysis.h"
+#include "BakingUtil.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAnimToTextureErrorBoundTest, "VATInstancing.AnimToTexture.BoneErrorBound",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FAnimToTextureErrorBoundTest::RunTest(const FString& Parameters)
+{
+	using namespace AnimToTexture_Private;
+
+	constexpr int32 NumBones = 16;
+	constexpr int32 NumVertices = 512;
+	constexpr int32 NumFrames = 32;
+	constexpr int32 NumInfluences = 2;
+	FRandomStream Random(1);
+
+	// Bones along a 2m chain, vertices around them with two influences. The last Bone has no vertices
+	TArray<FVector3f> BoneRefPositions;
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		BoneRefPositions.Add(FVector3f(0.f, 0.f, BoneIndex * 200.f / NumBones));
+	}
+
+	TArray<FVector3f> Vertices;
+	TArray<VertexSkinWeightFour> SkinWeights;
+	for (int32 VertexIndex = 0; VertexIndex < NumVertices; ++VertexIndex)
+	{
+		const int32 BoneIndex = Random.RandRange(0, NumBones - 3);
+		Vertices.Add(BoneRefPositions[BoneIndex] + FVector3f(Random.GetUnitVector()) * Random.FRandRange(0.f, 30.f));
+
+		VertexSkinWeightFour& SkinWeight = SkinWeights.AddZeroed_GetRef();
+		const uint8 Weight = static_cast<uint8>(Random.RandRange(128, 255));
+		SkinWeight.MeshBoneIndices[0] = BoneIndex;
+		SkinWeight.MeshBoneIndices[1] = BoneIndex + 1;
+		SkinWeight.BoneWeights[0] = Weight;
+		SkinWeight.BoneWeights[1] = 255 - Weight;
+	}
+
+	TArray<TArray<FVector3f>> FramePositions;
+	TArray<TArray<FVector4f>> FrameRotations;
+	FVector3f MinBBox(TNumericLimits<float>::Max());
+	FVector3f MaxBBox(TNumericLimits<float>::Lowest());
+	TArray<FVector3f> ElementMinBBoxes;
+	TArray<FVector3f> ElementMaxBBoxes;
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		TArray<FVector3f>& Positions = FramePositions.AddDefaulted_GetRef();
+		TArray<FVector4f>& Rotations = FrameRotations.AddDefaulted_GetRef();
+		for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+		{
+			Positions.Add(FVector3f(Random.GetUnitVector()) * Random.FRandRange(0.f, 150.f));
+			Rotations.Add(FVector4f(FVector3f(Random.GetUnitVector()), Random.FRandRange(0.f, 2.f * PI)));
+		}
+		AccumulateBoundingBox(Positions, MinBBox, MaxBBox);
+		AccumulateElementBoundingBoxes(Positions, ElementMinBBoxes, ElementMaxBBoxes);
+	}
+	AccumulateBoundingBox(BoneRefPositions, MinBBox, MaxBBox);
+
+	FTextureEncoding EightBitsAxisAngle;
+	EightBitsAxisAngle.PositionPrecision = EAnim2TexturePrecision::EightBits;
+	EightBitsAxisAngle.RotationPrecision = EAnim2TexturePrecision::EightBits;
+
+	FTextureEncoding EightBitsPerElementQuaternion = EightBitsAxisAngle;
+	EightBitsPerElementQuaternion.PositionRangeMode = EAnim2TextureRangeMode::PerElement;
+	EightBitsPerElementQuaternion.RotationFormat = EAnim2TextureRotationFormat::Quaternion;
+
+	FTextureEncoding SixteenBitsAxisAngle;
+
+	FTextureEncoding HalfFloatQuaternion;
+	HalfFloatQuaternion.PositionPrecision = EAnim2TexturePrecision::HalfFloat;
+	HalfFloatQuaternion.RotationFormat = EAnim2TextureRotationFormat::Quaternion;
+
+	for (const FTextureEncoding& Encoding : { EightBitsAxisAngle, EightBitsPerElementQuaternion, SixteenBitsAxisAngle, HalfFloatQuaternion })
+	{
+		const FPositionQuantizer Quantizer(Encoding, MinBBox, MaxBBox - MinBBox, ElementMinBBoxes, ElementMaxBBoxes);
+
+		FQuantizationErrorAnalyzer Analyzer(Encoding, Quantizer, NumVertices, 1);
+		Analyzer.SetSkinning(Vertices, SkinWeights, NumInfluences, BoneRefPositions);
+		FBoneErrorBound Bound(Encoding, Quantizer, Vertices, SkinWeights, NumInfluences, BoneRefPositions);
+
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			Analyzer.AddBoneFrame(0, FramePositions[Frame], FrameRotations[Frame]);
+			Bound.AddBoneFrame(FramePositions[Frame], FrameRotations[Frame]);
+		}
+
+		// Float rounding of the skinning itself
+		const float MeasuredError = Analyzer.GetTotalError().Max;
+		TestTrue(FString::Printf(TEXT("%s: measured %.4f cm <= bound %.4f cm"), *Encoding.ToString(EAnim2TextureMode::Bone), MeasuredError, Bound.GetMaxError()),
+			MeasuredError <= Bound.GetMaxError() + 1e-3f);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
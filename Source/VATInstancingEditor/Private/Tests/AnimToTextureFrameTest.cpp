@@ -0,0 +1,97 @@
+#include "MyAnimToTextureDataAsset.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace AnimToTexture_Private
+{
+
+static FAnim2TextureAnimInfo MakeTestAnimInfo(const int32 StartFrame, const int32 EndFrame, const int32 TextureSlice = 0, const int32 TextureFrameOffset = 0)
+{
+	FAnim2TextureAnimInfo AnimInfo;
+	AnimInfo.StartFrame = StartFrame;
+	AnimInfo.EndFrame = EndFrame;
+	AnimInfo.TextureSlice = TextureSlice;
+	AnimInfo.TextureFrameOffset = TextureFrameOffset;
+	return AnimInfo;
+}
+
+} // end namespace AnimToTexture_Private
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAnimToTextureFrameTest, "VATInstancing.AnimToTexture.TextureFrame",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FAnimToTextureFrameTest::RunTest(const FString& Parameters)
+{
+	using namespace AnimToTexture_Private;
+
+	static constexpr float Tolerance = 1e-3f;
+
+	// Two animations of 10 frames at 10 fps, the second one is stored right after the first
+	UMyAnimToTextureDataAsset* DataAsset = NewObject<UMyAnimToTextureDataAsset>(GetTransientPackage());
+	DataAsset->SampleRate = 10.f;
+	const FAnim2TextureAnimInfo Walk = MakeTestAnimInfo(0, 9);
+	const FAnim2TextureAnimInfo Run = MakeTestAnimInfo(10, 19);
+
+	// Nearest sampling: the row is the integer part, clamped at both ends
+	DataAsset->bInterpolateFrames = false;
+	TestEqual(TEXT("Nearest: before the start"), FMath::FloorToInt(DataAsset->GetTextureFrame(Walk, -1.f)), 0);
+	TestEqual(TEXT("Nearest: exact frame"), FMath::FloorToInt(DataAsset->GetTextureFrame(Walk, 0.3f)), 3);
+	TestEqual(TEXT("Nearest: between frames"), FMath::FloorToInt(DataAsset->GetTextureFrame(Walk, 0.56f)), 5);
+	TestEqual(TEXT("Nearest: last frame"), FMath::FloorToInt(DataAsset->GetTextureFrame(Walk, 0.95f)), 9);
+	TestEqual(TEXT("Nearest: past the end stays on the last frame"), FMath::FloorToInt(DataAsset->GetTextureFrame(Walk, 5.f)), 9);
+	TestEqual(TEXT("Nearest: second animation"), FMath::FloorToInt(DataAsset->GetTextureFrame(Run, 0.3f)), 13);
+	TestEqual(TEXT("Nearest: second animation past the end"), FMath::FloorToInt(DataAsset->GetTextureFrame(Run, 5.f)), 19);
+
+	// Interpolated: the fractional part blends towards the next row, but never past the last frame of the animation
+	DataAsset->bInterpolateFrames = true;
+	TestEqual(TEXT("Interpolated: before the start"), DataAsset->GetTextureFrame(Walk, -1.f), 0.f, Tolerance);
+	TestEqual(TEXT("Interpolated: between frames"), DataAsset->GetTextureFrame(Walk, 0.25f), 2.5f, Tolerance);
+	TestEqual(TEXT("Interpolated: last frame"), DataAsset->GetTextureFrame(Walk, 0.9f), 9.f, Tolerance);
+	TestEqual(TEXT("Interpolated: a looping animation past its last frame does not blend into the next animation"), DataAsset->GetTextureFrame(Walk, 0.95f), 9.f, Tolerance);
+	TestEqual(TEXT("Interpolated: far past the end"), DataAsset->GetTextureFrame(Walk, 5.f), 9.f, Tolerance);
+	TestEqual(TEXT("Interpolated: second animation"), DataAsset->GetTextureFrame(Run, 0.25f), 12.5f, Tolerance);
+	TestEqual(TEXT("Interpolated: second animation past the end"), DataAsset->GetTextureFrame(Run, 1.5f), 19.f, Tolerance);
+
+	// FrameRemap: Walk holds frame 4 until frame 7, Run starts on the stored frames 0 and 1, then jumps to the new frames 7..14
+	DataAsset->FrameRemap = { 0, 1, 2, 3, 4, 4, 4, 4, 5, 6, 0, 1, 7, 8, 9, 10, 11, 12, 13, 14 };
+	DataAsset->NumUniqueFrames = 15;
+
+	TestEqual(TEXT("Remap interpolated: adjacent stored frames"), DataAsset->GetTextureFrame(Walk, 0.25f), 2.5f, Tolerance);
+	TestEqual(TEXT("Remap interpolated: held frame does not blend into the next stored row"), DataAsset->GetTextureFrame(Walk, 0.45f), 4.f, Tolerance);
+	TestEqual(TEXT("Remap interpolated: held frame, second half"), DataAsset->GetTextureFrame(Walk, 0.65f), 4.f, Tolerance);
+	TestEqual(TEXT("Remap interpolated: end of the hold blends into the next stored frame"), DataAsset->GetTextureFrame(Walk, 0.73f), 4.3f, Tolerance);
+	TestEqual(TEXT("Remap interpolated: last frame"), DataAsset->GetTextureFrame(Walk, 5.f), 6.f, Tolerance);
+	TestEqual(TEXT("Remap interpolated: second animation on shared frames"), DataAsset->GetTextureFrame(Run, 0.05f), 0.5f, Tolerance);
+	TestEqual(TEXT("Remap interpolated: gap, first half snaps to the current frame"), DataAsset->GetTextureFrame(Run, 0.14f), 1.f, Tolerance);
+	TestEqual(TEXT("Remap interpolated: gap, second half snaps to the next frame"), DataAsset->GetTextureFrame(Run, 0.16f), 7.f, Tolerance);
+	TestEqual(TEXT("Remap interpolated: after the gap"), DataAsset->GetTextureFrame(Run, 0.25f), 7.5f, Tolerance);
+	TestEqual(TEXT("Remap interpolated: second animation past the end"), DataAsset->GetTextureFrame(Run, 5.f), 14.f, Tolerance);
+
+	DataAsset->bInterpolateFrames = false;
+	TestEqual(TEXT("Remap nearest: held frame"), FMath::FloorToInt(DataAsset->GetTextureFrame(Walk, 0.62f)), 4);
+	TestEqual(TEXT("Remap nearest: after the gap"), FMath::FloorToInt(DataAsset->GetTextureFrame(Run, 0.22f)), 7);
+	TestEqual(TEXT("Remap nearest: past the end"), FMath::FloorToInt(DataAsset->GetTextureFrame(Run, 5.f)), 14);
+
+	// Texture Arrays: frames are relative to the slice of the animation, Run starts its own slice
+	DataAsset->FrameRemap.Reset();
+	DataAsset->NumUniqueFrames = 0;
+	DataAsset->NumTextureSlices = 2;
+	DataAsset->NumSliceFrames = 10;
+	const FAnim2TextureAnimInfo SlicedWalk = MakeTestAnimInfo(0, 9, 0, 0);
+	const FAnim2TextureAnimInfo SlicedRun = MakeTestAnimInfo(10, 19, 1, -10);
+
+	TestEqual(TEXT("Array nearest: first slice"), FMath::FloorToInt(DataAsset->GetTextureFrame(SlicedWalk, 0.3f)), 3);
+	TestEqual(TEXT("Array nearest: before the start of the slice"), FMath::FloorToInt(DataAsset->GetTextureFrame(SlicedRun, -1.f)), 0);
+	TestEqual(TEXT("Array nearest: second slice"), FMath::FloorToInt(DataAsset->GetTextureFrame(SlicedRun, 0.3f)), 3);
+	TestEqual(TEXT("Array nearest: past the end of the slice"), FMath::FloorToInt(DataAsset->GetTextureFrame(SlicedRun, 5.f)), 9);
+
+	DataAsset->bInterpolateFrames = true;
+	TestEqual(TEXT("Array interpolated: second slice"), DataAsset->GetTextureFrame(SlicedRun, 0.35f), 3.5f, Tolerance);
+	TestEqual(TEXT("Array interpolated: past the end does not blend into the RefPose of the slice"), DataAsset->GetTextureFrame(SlicedRun, 5.f), 9.f, Tolerance);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
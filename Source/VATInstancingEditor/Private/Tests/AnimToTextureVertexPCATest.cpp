@@ -0,0 +1,110 @@
+#include "AnimToTextureVertexPCA.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAnimToTextureVertexPCARoundTripTest, "VATInstancing.AnimToTexture.VertexPCARoundTrip",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FAnimToTextureVertexPCARoundTripTest::RunTest(const FString& Parameters)
+{
+	using namespace AnimToTexture_Private;
+
+	// Low rank animation: NumShapes deformations of up to 20cm blended with a different frequency each, plus noise under the budgets
+	constexpr int32 NumVertices = 512;
+	constexpr int32 NumFrames = 60;
+	constexpr int32 NumShapes = 6;
+	constexpr float ShapeExtent = 20.f;
+	constexpr float NoiseExtent = 0.005f;
+	FRandomStream Random(NumVertices);
+
+	TArray<FVector3f> RestNormals;
+	TArray<FVector3f> ShapeDeltas;
+	TArray<FVector3f> ShapeNormals;
+	RestNormals.SetNumUninitialized(NumVertices);
+	ShapeDeltas.SetNumUninitialized(NumShapes * NumVertices);
+	ShapeNormals.SetNumUninitialized(NumShapes * NumVertices);
+	for (FVector3f& Normal : RestNormals)
+	{
+		Normal = FVector3f(Random.GetUnitVector());
+	}
+	for (int32 Index = 0; Index < ShapeDeltas.Num(); ++Index)
+	{
+		ShapeDeltas[Index] = FVector3f(Random.GetUnitVector()) * Random.FRandRange(0.f, ShapeExtent);
+		ShapeNormals[Index] = FVector3f(Random.GetUnitVector()) * 0.25f;
+	}
+
+	TArray<FVector3f> Deltas;
+	TArray<FVector3f> Normals;
+	Deltas.SetNumUninitialized(NumFrames * NumVertices);
+	Normals.SetNumUninitialized(NumFrames * NumVertices);
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		for (int32 Vertex = 0; Vertex < NumVertices; ++Vertex)
+		{
+			FVector3f Delta = FVector3f(Random.GetUnitVector()) * Random.FRandRange(0.f, NoiseExtent);
+			FVector3f Normal = RestNormals[Vertex];
+			for (int32 Shape = 0; Shape < NumShapes; ++Shape)
+			{
+				const float Weight = FMath::Sin(2.f * PI * (Shape + 1) * Frame / NumFrames + Shape);
+				Delta += ShapeDeltas[Shape * NumVertices + Vertex] * Weight;
+				Normal += ShapeNormals[Shape * NumVertices + Vertex] * Weight;
+			}
+			Deltas[Frame * NumVertices + Vertex] = Delta;
+			Normals[Frame * NumVertices + Vertex] = Normal.GetSafeNormal();
+		}
+	}
+
+	struct FCase
+	{
+		EAnim2TexturePrecision Precision;
+		float ErrorBudget;
+		bool bMustMeetBudget;
+	};
+
+	// 8 bits texels may not meet a sub-millimetre budget with any number of components, the reported error must still be the decoded one
+	const FCase Cases[] = {
+		{ EAnim2TexturePrecision::SixteenBits, 0.1f, true },
+		{ EAnim2TexturePrecision::HalfFloat, 0.5f, true },
+		{ EAnim2TexturePrecision::EightBits, 0.05f, false },
+	};
+
+	for (const FCase& Case : Cases)
+	{
+		const FString Precision = UEnum::GetValueAsString(Case.Precision);
+
+		FVertexPCA PCA;
+		TArray<FVector3f> Residuals = Deltas;
+		const bool bWithinBudget = PCA.Compress(Residuals, Normals, NumVertices, NumShapes + 4, Case.ErrorBudget, Case.Precision, Case.Precision);
+
+		// Reconstructs from the texels, as the Material does
+		float MaxError = 0.f;
+		float MaxResidualMismatch = 0.f;
+		TArray<FVector3f> DecodedDeltas, DecodedNormals;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			PCA.ReconstructFrame(Frame, DecodedDeltas, DecodedNormals);
+			for (int32 Vertex = 0; Vertex < NumVertices; ++Vertex)
+			{
+				const int32 Index = Frame * NumVertices + Vertex;
+				const float Error = FVector3f::Dist(Deltas[Index], DecodedDeltas[Vertex]);
+				MaxError = FMath::Max(MaxError, Error);
+				MaxResidualMismatch = FMath::Max(MaxResidualMismatch, FMath::Abs(Residuals[Index].Size() - Error));
+			}
+		}
+
+		if (Case.bMustMeetBudget)
+		{
+			TestTrue(FString::Printf(TEXT("%s: %i basis meet the %.3f cm budget"), *Precision, PCA.GetNumBasis(), Case.ErrorBudget), bWithinBudget);
+			TestTrue(FString::Printf(TEXT("%s: decoded error %.4f cm within the %.3f cm budget"), *Precision, MaxError, Case.ErrorBudget), MaxError <= Case.ErrorBudget);
+		}
+		TestEqual(FString::Printf(TEXT("%s: Compress reports the decoded error"), *Precision), bWithinBudget, MaxError <= Case.ErrorBudget);
+		TestTrue(FString::Printf(TEXT("%s: GetMaxError %.4f cm is the decoded error %.4f cm"), *Precision, PCA.GetMaxError(), MaxError),
+			FMath::IsNearlyEqual(PCA.GetMaxError(), MaxError, 1e-3f));
+		TestTrue(FString::Printf(TEXT("%s: residuals track the decoded error (%.4f cm off)"), *Precision, MaxResidualMismatch), MaxResidualMismatch <= 1e-2f);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
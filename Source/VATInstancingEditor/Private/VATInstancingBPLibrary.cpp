@@ -2,6 +2,9 @@
 #include "VATInstancingEditorModule.h"
 #include "AnimToTextureUtils.h"
 #include "AnimToTextureSkeletalMesh.h"
+#include "AnimToTextureErrorAnalysis.h"
+#include "AnimToTextureMorphTargets.h"
+#include "AnimToTextureBounds.h"
 #include "PerInstanceCustomDataLayout.h"
 #include "MyAnimToTextureDataAsset.h"
 #include "RawMesh.h"
@@ -23,12 +26,26 @@
 #include "VATInstanceRendererInterface.h"
 #include "Engine/World.h"
 #include "AssetRegistry/AssetRegistryModule.h"
+#include "Algo/StableSort.h"
 
 #define LOCTEXT_NAMESPACE "AnimToTextureEditor"
 
 using namespace AnimToTexture_Private;
 
-static bool WriteSkinWeightsToColorAndBoneIdToUvChannel(TArray<TVertexSkinWeight<4>>& SkinWeights, UMyAnimToTextureDataAsset* DataAsset);
+static bool WriteSkinWeightsToColorAndBoneIdToUvChannel(TArray<TVertexSkinWeight<4>>& SkinWeights, UMyAnimToTextureDataAsset* DataAsset, const int32 LODIndex);
+static bool WriteBoneWeights(UMyAnimToTextureDataAsset* DataAsset, TArray<VertexSkinWeightFour>& SkinWeights, const int32 NumVertices);
+static void GetBoneSkinWeights(const FSourceMeshToDriverMesh& Mapping, const int32 SocketIndex, const int32 NumVertices, TArray<VertexSkinWeightFour>& OutSkinWeights);
+static bool RemapToBakedBones(const UMyAnimToTextureDataAsset* DataAsset, TArray<VertexSkinWeightFour>& InOutSkinWeights);
+static void GrowBoundsWithoutAnimationBounds(const UMyAnimToTextureDataAsset* DataAsset, const FVector3f& MinBBox, const FVector3f& SizeBBox);
+
+/* Skin Weights of a StaticMesh LOD other than StaticLODIndex, baked with bBakeAllStaticMeshLODs */
+struct FStaticMeshLODSkinWeights
+{
+	int32 LODIndex = 0;
+	TArray<VertexSkinWeightFour> SkinWeights;
+};
+static void GetStaticMeshLODSkinWeights(const UMyAnimToTextureDataAsset* DataAsset, const int32 SocketIndex, TArray<FStaticMeshLODSkinWeights>& OutLODs);
+static bool WriteStaticMeshLODBoneWeights(UMyAnimToTextureDataAsset* DataAsset, TArray<FStaticMeshLODSkinWeights>& LODs, const int32 NumVertices);
 
 bool UVATInstancingBPLibrary::AnimationToTexture(UMyAnimToTextureDataAsset* DataAsset)
 {
@@ -67,43 +84,146 @@ bool UVATInstancingBPLibrary::AnimationToTexture(UMyAnimToTextureDataAsset* Data
 		return false;
 	}
 
+	// ---------------------------------------------------------------------------
+	// Animations shared through an AnimationLibrary, only Skin Weights are baked for this StaticMesh
+	//
+	if (DataAsset->GetAnimationLibrary())
+	{
+		CopyAnimationLibrary(DataAsset);
+
+		// Bone Ids index the Library Bone Textures
+		TArray<VertexSkinWeightFour> SkinWeights;
+		GetBoneSkinWeights(Mapping, SocketIndex, NumVertices, SkinWeights);
+		if (!RemapToBakedBones(DataAsset, SkinWeights) || !WriteBoneWeights(DataAsset, SkinWeights, NumVertices))
+		{
+			return false;
+		}
+
+		// Animation bounds of this StaticMesh, skinned by the Bone bounds of the Library
+		TArray<FVector3f> SourceVertices;
+		Mapping.GetSourceVertices(SourceVertices);
+		if (!FAnimationBoundsBuilder::WriteBoundsFromLibrary(DataAsset, SourceVertices, SkinWeights))
+		{
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("AnimationLibrary %s has no Bone bounds, rebake it for the animation bounds of %s"),
+				*DataAsset->GetAnimationLibrary()->GetName(), *DataAsset->GetName());
+		}
+		GrowBoundsWithoutAnimationBounds(DataAsset, DataAsset->BoneMinBBox, DataAsset->BoneSizeBBox);
+
+		TArray<FStaticMeshLODSkinWeights> StaticMeshLODs;
+		GetStaticMeshLODSkinWeights(DataAsset, SocketIndex, StaticMeshLODs);
+		if (!WriteStaticMeshLODBoneWeights(DataAsset, StaticMeshLODs, NumVertices))
+		{
+			return false;
+		}
+
+		// Done with StaticMesh
+		DataAsset->GetStaticMesh()->PostEditChange();
+
+		UE_LOG(LogVATInstancingEditor, Display, TEXT("Baked %s: Bone Weights only, animations shared with %s"), *DataAsset->GetName(), *DataAsset->GetAnimationLibrary()->GetName());
+
+		DataAsset->MarkPackageDirty();
+		return true;
+	}
+
 	// ---------------------------------------------------------------------------
 	// Get Reference Skeleton Transforms
 	//
-	TArray<FVector3f> BoneRefPositions;
+	FAnimToTextureBake Bake;
+	Bake.DataAsset = DataAsset;
+	Bake.Mapping = &Mapping;
+	Bake.NumVertices = NumVertices;
+
 	TArray<FVector4f> BoneRefRotations_NoUse;
+	DataAsset->NumBones = GetRefBonePositionsAndRotations(DataAsset->GetSkeletalMesh(), Bake.BoneRefPositions, BoneRefRotations_NoUse);
 
-	TArray<FVector3f> BonePositions;
-	TArray<FVector4f> BoneRotations;
-	
-	DataAsset->NumBones = GetRefBonePositionsAndRotations(DataAsset->GetSkeletalMesh(), BoneRefPositions, BoneRefRotations_NoUse);
+	// ---------------------------------------------------------------------------
+	// Skin Weights of the StaticMesh, Bone Mode only
+	//
+	const bool bBoneMode = Bake.IsBoneMode();
+	const bool bDualQuaternion = Bake.IsDualQuaternion();
+	Bake.NumInfluences = GetNumBoneInfluences(DataAsset);
+	TArray<FStaticMeshLODSkinWeights> StaticMeshLODs;
 
+	// RefPose of the Bones in the Bone Textures. BoneRefPositions keeps all Raw Bones, they are all sampled
+	Bake.BakedBoneRefPositions = Bake.BoneRefPositions;
+	Bake.BakedBoneRefRotations = BoneRefRotations_NoUse;
 
-	// --------------------------------------------------------------------------
+	Mapping.GetSourceVertices(Bake.SourceVertices);
+	if (bBoneMode)
+	{
+		GetBoneSkinWeights(Mapping, SocketIndex, NumVertices, Bake.SkinWeights);
+		GetStaticMeshLODSkinWeights(DataAsset, SocketIndex, StaticMeshLODs);
 
-	// Create Temp Actor
-	check(GEditor);
-	UWorld* World = GEditor->GetEditorWorldContext().World();
-	check(World);
+		// 只烘焙影响顶点的骨骼，每帧采样后压缩掉其余骨骼. 其他LOD的顶点也要算进去
+		if (DataAsset->bStripUnusedBones)
+		{
+			TArray<VertexSkinWeightFour> AllLODSkinWeights = Bake.SkinWeights;
+			for (const FStaticMeshLODSkinWeights& LOD : StaticMeshLODs)
+			{
+				AllLODSkinWeights.Append(LOD.SkinWeights);
+			}
 
-	AActor* Actor = World->SpawnActor<AActor>();
-	check(Actor);
+			GetInfluencingBones(DataAsset, AllLODSkinWeights, Bake.NumInfluences, DataAsset->BakedBones);
+			CompactBoneFrame(DataAsset->BakedBones, Bake.BakedBoneRefPositions, Bake.BakedBoneRefRotations);
+			DataAsset->NumBones = DataAsset->BakedBones.Num();
+		}
 
-	// Create Temp SkeletalMesh Component
-	USkeletalMeshComponent* SkeletalMeshComponent = NewObject<USkeletalMeshComponent>(Actor);
-	SkeletalMeshComponent->SetSkeletalMesh(DataAsset->GetSkeletalMesh());
-	SkeletalMeshComponent->SetForcedLOD(1); // Force to LOD0;
-	SkeletalMeshComponent->SetAnimationMode(EAnimationMode::AnimationSingleNode);
-	SkeletalMeshComponent->SetUpdateAnimationInEditor(true);
-	SkeletalMeshComponent->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
-	SkeletalMeshComponent->RegisterComponent();
+		if (!RemapToBakedBones(DataAsset, Bake.SkinWeights))
+		{
+			return false;
+		}
+	}
 
 	// ---------------------------------------------------------------------------
-	// Get Vertex Data (for all frames)
-	//		
-	TArray<FVector3f> VertexDeltas;
-	TArray<FVector3f> VertexNormals;
+	// Frame Layout
+	// 每个动画的帧范围在采样前就能确定，因此可以先算好贴图分辨率，第二遍采样时直接写入对应的像素行
+	//
+	TArray<FAnim2TextureAnimSequenceInfo>& AnimSequences = DataAsset->AnimSequences;
+	TArray<TArray<FTransform>> InterestTransformsPerAnim;
+	for (FAnim2TextureAnimSequenceInfo& AnimSequenceInfo : AnimSequences)
+	{
+		const float AnimSampleRate = AnimSequenceInfo.bOverrideSampleRate ? AnimSequenceInfo.SampleRate : DataAsset->SampleRate;
+
+		float AnimStartTime;
+		const int32 AnimNumFrames = GetAnimationNumSamples(AnimSequenceInfo, AnimSampleRate, AnimStartTime);
+
+		// Store Anim Info Data
+		FAnim2TextureAnimInfo AnimInfo;
+		AnimInfo.StartFrame = DataAsset->NumFrames;
+		AnimInfo.EndFrame = DataAsset->NumFrames + AnimNumFrames - 1;
+		AnimInfo.SampleRate = AnimSampleRate;
+		if (DataAsset->bBakeRootMotion)
+		{
+			GetAnimationRootMotion(AnimSequenceInfo, AnimNumFrames, AnimSampleRate, AnimStartTime, DataAsset->RootTransform, AnimInfo.RootMotion);
+		}
+		DataAsset->Animations.Add(AnimInfo);
+
+		// Accumulate Frames
+		DataAsset->NumFrames += AnimNumFrames;
 
+		// 缓存部分骨骼的Transform到CPU侧，第一遍采样后量化
+		const int32 TotalNum = AnimSequenceInfo.BoneOrSocketsOfInterest.Num() + DataAsset->BoneOrSocketsOfInterestForAllAnimSequences.Num();
+		InterestTransformsPerAnim.AddDefaulted_GetRef().SetNumUninitialized(TotalNum * AnimNumFrames);
+	}
+
+	// 每个动画(或每BoundsFramesPerRange帧)的包围盒，在第一遍采样时收集
+	FAnimationBoundsBuilder BoundsBuilder;
+	BoundsBuilder.Init(DataAsset, bBoneMode ? DataAsset->NumBones : 0);
+
+	// PerElement 量化范围储存在RefPose之后的两帧: Min, Size
+	// 按误差预算选择编码时，采样前还不知道是否为PerElement，先预留这两帧(Global时不会被读取)
+	DataAsset->NumLookupFrames = Bake.HasPerElementRanges() || DataAsset->bSelectPrecisionFromErrorBudget ? 2 : 0;
+
+	// Find Best Resolution for Vertex or Bone Data
+	if (!FindBakeResolution(Bake))
+	{
+		return false;
+	}
+
+	// --------------------------------------------------------------------------
+
+	FAnimationFrameSampler Sampler(DataAsset);
+	USkeletalMeshComponent* SkeletalMeshComponent = Sampler.GetSkeletalMeshComponent();
 
 	TMap<int32, int32> BoneId2InterestListId;
 	TMap<FName, int32> SocketName2InterestListId;
@@ -123,162 +243,217 @@ bool UVATInstancingBPLibrary::AnimationToTexture(UMyAnimToTextureDataAsset* Data
 			UE_LOG(LogTemp, Log, TEXT("Not a bone name or socket name"));
 		}
 	}
-	
-	// Get Animation Frames Data
-	TArray<FAnim2TextureAnimSequenceInfo>& AnimSequences = DataAsset->AnimSequences;
+
+	TArray<TMap<int32, int32>> BoneId2InterestListIdPerAnim;
+	TArray<TMap<FName, int32>> SocketName2InterestListIdPerAnim;
+	BoneId2InterestListIdPerAnim.Init(BoneId2InterestListId, AnimSequences.Num());
+	SocketName2InterestListIdPerAnim.Init(SocketName2InterestListId, AnimSequences.Num());
+	const int32 Offset = DataAsset->BoneOrSocketsOfInterestForAllAnimSequences.Num();
 	for (int32 AnimSequenceIndex = 0; AnimSequenceIndex < AnimSequences.Num(); AnimSequenceIndex++)
 	{
-		FAnim2TextureAnimSequenceInfo& AnimSequenceInfo = AnimSequences[AnimSequenceIndex];
-
-		// Set Animation
-		UAnimSequence* AnimSequence = AnimSequenceInfo.AnimSequence;
-		SkeletalMeshComponent->SetAnimation(AnimSequence);
-
-		// Get Number of Frames
-		int32 AnimStartFrame;
-		int32 AnimEndFrame;
-		const int32 AnimNumFrames = GetAnimationFrameRange(AnimSequenceInfo, AnimStartFrame, AnimEndFrame);
-		const float AnimStartTime = AnimSequence->GetTimeAtFrame(AnimStartFrame);
-
-		// 缓存部分骨骼的Transform到CPU侧。
-		const int32 TotalNum = AnimSequenceInfo.BoneOrSocketsOfInterest.Num() + DataAsset->BoneOrSocketsOfInterestForAllAnimSequences.Num();
-		AnimSequenceInfo.BoneComponentSpaceTransforms.SetNumUninitialized(TotalNum * AnimNumFrames);
-		TMap<int32, int32> BoneId2InterestListIdThisAnim = BoneId2InterestListId;
-		TMap<FName, int32> SocketName2InterestListIdThisAnim = SocketName2InterestListId;
-		const int32 Offset = DataAsset->BoneOrSocketsOfInterestForAllAnimSequences.Num();
+		const FAnim2TextureAnimSequenceInfo& AnimSequenceInfo = AnimSequences[AnimSequenceIndex];
 		for (int j = 0; j < AnimSequenceInfo.BoneOrSocketsOfInterest.Num(); ++j)
 		{
 			auto BoneOrSocketName = AnimSequenceInfo.BoneOrSocketsOfInterest[j];
 			if (int32 BoneIndex = SkeletalMeshComponent->GetBoneIndex(BoneOrSocketName); BoneIndex != INDEX_NONE)
 			{
-				BoneId2InterestListIdThisAnim.Add(BoneIndex, Offset + j);
+				BoneId2InterestListIdPerAnim[AnimSequenceIndex].Add(BoneIndex, Offset + j);
 			}
 			else if (SkeletalMeshComponent->GetSocketByName(BoneOrSocketName))
 			{
-				SocketName2InterestListIdThisAnim.Add(BoneOrSocketName, Offset + j);
+				SocketName2InterestListIdPerAnim[AnimSequenceIndex].Add(BoneOrSocketName, Offset + j);
 			}
 			else
 			{
 				UE_LOG(LogTemp, Log, TEXT("Not a bone name or socket name"));
 			}
 		}
+	}
 
+	// Per-Frame scratch buffers, reused by every frame
+	TArray<FVector3f> VertexFrameDeltas;
+	TArray<FVector3f> VertexFrameNormals;
+	TArray<FVector3f> BoneFramePositions;
+	TArray<FVector4f> BoneFrameRotations;
 
-		int32 SampleIndex = 0;
-		const float SampleInterval = 1.f / DataAsset->SampleRate;
+	// ---------------------------------------------------------------------------
+	// Pass 1: Bounding Boxes and cached transforms of BoneOrSocketsOfInterest
+	//
 
-		// Progress Bar
-		FFormatNamedArguments Args;
-		Args.Add(TEXT("AnimSequenceIndex"), AnimSequenceIndex+1);
-		Args.Add(TEXT("NumAnimSequences"), AnimSequences.Num());
-		Args.Add(TEXT("AnimSequence"), FText::FromString(*AnimSequence->GetFName().ToString()));
-		FScopedSlowTask AnimProgressBar(AnimNumFrames, FText::Format(LOCTEXT("ProcessingAnimSequence", "Processing AnimSequence: {AnimSequence} [{AnimSequenceIndex}/{NumAnimSequences}]"), Args), true /*Enabled*/);
-		AnimProgressBar.MakeDialog(false /*bShowCancelButton*/, false /*bAllowInPIE*/);
+	// Per Bone or Vertex Bounding Boxes, only gathered for PerElement ranges (or when any range mode may be selected)
+	const bool bGatherElementRanges = Bake.HasPerElementRanges() || DataAsset->bSelectPrecisionFromErrorBudget;
 
-		while (SampleIndex < AnimNumFrames)
-		{
-			AnimProgressBar.EnterProgressFrame();
+	// RefPose 也存在Bone Position Texture中，需要包含在BoundingBox内
+	if (bBoneMode)
+	{
+		AccumulateBoundingBox(Bake.BakedBoneRefPositions, Bake.MinBBox, Bake.MaxBBox);
+	}
 
-			const float Time = AnimStartTime + (static_cast<float>(SampleIndex) * SampleInterval);
-			
-			SkeletalMeshComponent->SetPosition(Time);
-			SkeletalMeshComponent->TickAnimation(0.f, false /*bNeedsValidRootMotion*/);
-			SkeletalMeshComponent->RefreshBoneTransforms(nullptr /*TickFunction*/);
-			
+	// Morph Targets with a non-zero weight in any frame, only their vertices are baked
+	const bool bBakeMorphTargets = bBoneMode && DataAsset->bBakeMorphTargets;
+	TArray<bool> ActiveMorphTargets;
+	TArray<float> MorphTargetWeights;
+
+	Sampler.ForEachFrame(LOCTEXT("AnalyzingPass", "Analyzing"), [&](int32 AnimSequenceIndex, int32 SampleIndex, int32 Frame)
+	{
+		FAnim2TextureAnimSequenceInfo& AnimSequenceInfo = AnimSequences[AnimSequenceIndex];
+
+		if (!bBoneMode)
+		{
+			GetVertexDeltasAndNormals(SkeletalMeshComponent, DataAsset->SkeletalLODIndex,
+				Mapping, DataAsset->RootTransform,
+				VertexFrameDeltas, VertexFrameNormals);
 
-			if (DataAsset->Mode == EAnim2TextureMode::Vertex)
+			AccumulateBoundingBox(VertexFrameDeltas, Bake.MinBBox, Bake.MaxBBox);
+			if (bGatherElementRanges)
 			{
-				TArray<FVector3f> VertexFrameDeltas;
-				TArray<FVector3f> VertexFrameNormals;
-				
-				GetVertexDeltasAndNormals(SkeletalMeshComponent, DataAsset->SkeletalLODIndex,
-					Mapping, DataAsset->RootTransform,
-					VertexFrameDeltas, VertexFrameNormals);
-					
-				VertexDeltas.Append(VertexFrameDeltas);
-				VertexNormals.Append(VertexFrameNormals);
+				AccumulateElementBoundingBoxes(VertexFrameDeltas, Bake.ElementMinBBoxes, Bake.ElementMaxBBoxes);
 			}
+			BoundsBuilder.AddVertexFrame(AnimSequenceIndex, SampleIndex, Bake.SourceVertices, VertexFrameDeltas);
+		}
 
-			// 假如需要将感兴趣的骨骼和Socket的ComponentSpaceTransform存储，那么即使是vertex模式也得执行GetBonePositionsAndRotations
-			if (DataAsset->Mode == EAnim2TextureMode::Bone || TotalNum > 0)
+		// 假如需要将感兴趣的骨骼和Socket的ComponentSpaceTransform存储，那么即使是vertex模式也得执行GetBonePositionsAndRotations
+		TArray<FTransform>& InterestTransforms = InterestTransformsPerAnim[AnimSequenceIndex];
+		if (bBoneMode || InterestTransforms.Num() > 0)
+		{
+			const int32 TotalNum = Offset + AnimSequenceInfo.BoneOrSocketsOfInterest.Num();
+			GetBonePositionsAndRotations(SkeletalMeshComponent, Bake.BoneRefPositions, BoneFramePositions, BoneFrameRotations,
+										 MakeArrayView(InterestTransforms).Slice(SampleIndex * TotalNum, TotalNum),
+										 BoneId2InterestListIdPerAnim[AnimSequenceIndex],
+										 SocketName2InterestListIdPerAnim[AnimSequenceIndex]);
+
+			if (bBoneMode)
 			{
-				TArray<FVector3f> BoneFramePositions;
-				TArray<FVector4f> BoneFrameRotations;
+				if (!DataAsset->BakedBones.IsEmpty())
+				{
+					CompactBoneFrame(DataAsset->BakedBones, BoneFramePositions, BoneFrameRotations);
+				}
 
-				GetBonePositionsAndRotations(SkeletalMeshComponent, BoneRefPositions, BoneFramePositions, BoneFrameRotations, SampleIndex, AnimSequenceInfo, Offset,
-											 BoneId2InterestListIdThisAnim,
-											 SocketName2InterestListIdThisAnim);
+				AccumulateBoundingBox(BoneFramePositions, Bake.MinBBox, Bake.MaxBBox);
+				if (bGatherElementRanges)
+				{
+					AccumulateElementBoundingBoxes(BoneFramePositions, Bake.ElementMinBBoxes, Bake.ElementMaxBBoxes);
+				}
+				BoundsBuilder.AddBoneFrame(AnimSequenceIndex, SampleIndex, Bake.BakedBoneRefPositions, BoneFramePositions);
 
-				BonePositions.Append(BoneFramePositions);
-				BoneRotations.Append(BoneFrameRotations);
+				// Dual texels are normalized with the largest Dual component of all frames
+				if (bDualQuaternion)
+				{
+					DataAsset->BoneDualQuaternionScale = FMath::Max(DataAsset->BoneDualQuaternionScale,
+						GetMaxDualQuaternionComponent(Bake.BakedBoneRefPositions, BoneFramePositions, BoneFrameRotations));
+				}
 			}
+		}
 
-			SampleIndex++;
-		} // End Frame
+		if (bBakeMorphTargets)
+		{
+			GetMorphTargetWeights(SkeletalMeshComponent, MorphTargetWeights);
+			ActiveMorphTargets.SetNumZeroed(MorphTargetWeights.Num());
+			for (int32 MorphIndex = 0; MorphIndex < MorphTargetWeights.Num(); ++MorphIndex)
+			{
+				ActiveMorphTargets[MorphIndex] |= !FMath::IsNearlyZero(MorphTargetWeights[MorphIndex]);
+			}
+		}
+	});
 
-		// Store Anim Info Data
-		FAnim2TextureAnimInfo AnimInfo;
-		AnimInfo.StartFrame = DataAsset->NumFrames;
-		AnimInfo.EndFrame = DataAsset->NumFrames + AnimNumFrames - 1;
-		DataAsset->Animations.Add(AnimInfo);
+	if (bDualQuaternion && DataAsset->BoneDualQuaternionScale <= 0.f)
+	{
+		DataAsset->BoneDualQuaternionScale = 1.f;
+	}
 
-		// Accumulate Frames
-		DataAsset->NumFrames += AnimNumFrames;
+	for (int32 AnimSequenceIndex = 0; AnimSequenceIndex < AnimSequences.Num(); ++AnimSequenceIndex)
+	{
+		AnimSequences[AnimSequenceIndex].PackSocketTransforms(InterestTransformsPerAnim[AnimSequenceIndex], Offset + AnimSequences[AnimSequenceIndex].BoneOrSocketsOfInterest.Num(),
+			DataAsset->SocketFramesPerKey);
+	}
+	InterestTransformsPerAnim.Empty();
 
-	} // End Anim
-		
-	// Destroy Temp Component & Actor
-	SkeletalMeshComponent->UnregisterComponent();
-	SkeletalMeshComponent->DestroyComponent();
-	Actor->Destroy();
-	
 	// ---------------------------------------------------------------------------
+	// Position Error: reconstructs the StaticMesh from quantized texels
+	//
 
-	if (DataAsset->Mode == EAnim2TextureMode::Vertex)
+	// 测量所有候选编码，选出误差不超过预算的最便宜的一个
+	if (DataAsset->bSelectPrecisionFromErrorBudget)
 	{
-		// Find Best Resolution for Vertex Data
-		int32 Height, Width;
-		if (!FindBestResolution(DataAsset->NumFrames, NumVertices, 
-								Height, Width, DataAsset->VertexRowsPerFrame, 
-								DataAsset->MaxHeight, DataAsset->MaxWidth))
-		{
-			UE_LOG(LogVATInstancingEditor, Warning, TEXT("Vertex Animation data cannot be fit in a %ix%i texture."), DataAsset->MaxHeight, DataAsset->MaxWidth);
-			return false;
-		}
+		SelectEncodingFromErrorBudget(Bake, Sampler);
+	}
 
-		// Normalize Vertex Data
-		TArray<FVector3f> NormalizedVertexDeltas;
-		TArray<FVector3f> NormalizedVertexNormals;
-		NormalizeVertexData(
-			VertexDeltas, VertexNormals,
-			DataAsset->VertexMinBBox, DataAsset->VertexSizeBBox,
-			NormalizedVertexDeltas, NormalizedVertexNormals);
+	// Error of the encoding actually baked, measured while writing
+	FQuantizationErrorAnalyzer ErrorAnalyzer = Bake.MakeErrorAnalyzer(FTextureEncoding::FromDataAsset(DataAsset));
 
-		// Write Textures
-		if (DataAsset->PositionPrecision == EAnim2TexturePrecision::SixteenBits)
-		{
-			WriteVectorsToTexture<FVector3f, FHighPrecision>(NormalizedVertexDeltas, DataAsset->NumFrames, DataAsset->VertexRowsPerFrame, Height, Width, DataAsset->GetVertexPositionTexture());
-		}
-		else
-		{
-			WriteVectorsToTexture<FVector3f, FLowPrecision>(NormalizedVertexDeltas, DataAsset->NumFrames, DataAsset->VertexRowsPerFrame, Height, Width, DataAsset->GetVertexPositionTexture());
-		}
+	// PerElement ranges are quantized themselves, relative to the global Bounding Box
+	Bake.QuantizeRanges();
 
-		if (DataAsset->RotationPrecision == EAnim2TexturePrecision::SixteenBits)
+	// ---------------------------------------------------------------------------
+	// Pass 2: Quantize each frame straight into its texture rows
+	//
+
+	// Bone Mode Morph Targets: RefPose deltas of the moved vertices, one texel per vertex and frame
+	FMorphTargetDeltas MorphTargetDeltas;
+	int32 MorphHeight = 0;
+	int32 MorphWidth = 0;
+	if (bBakeMorphTargets)
+	{
+		ActiveMorphTargets.SetNumZeroed(DataAsset->GetSkeletalMesh()->GetMorphTargets().Num());
+		MorphTargetDeltas.Update(Mapping, DataAsset->GetSkeletalMesh(), DataAsset->SkeletalLODIndex, ActiveMorphTargets);
+		DataAsset->NumMorphVertices = MorphTargetDeltas.GetNumMorphVertices();
+
+		if (!DataAsset->NumMorphVertices)
 		{
-			WriteVectorsToTexture<FVector3f, FHighPrecision>(NormalizedVertexNormals, DataAsset->NumFrames, DataAsset->VertexRowsPerFrame, Height, Width, DataAsset->GetVertexNormalTexture());
+			UE_LOG(LogVATInstancingEditor, Display, TEXT("No Morph Target of %s moves the StaticMesh, MorphDeltaTexture is not written"), *DataAsset->GetName());
 		}
-		else
+		else if (!FindBestResolution(DataAsset->NumFrames, DataAsset->NumMorphVertices,
+			MorphHeight, MorphWidth, DataAsset->MorphRowsPerFrame,
+			DataAsset->MaxHeight, DataAsset->MaxWidth))
 		{
-			WriteVectorsToTexture<FVector3f, FLowPrecision>(NormalizedVertexNormals, DataAsset->NumFrames, DataAsset->VertexRowsPerFrame, Height, Width, DataAsset->GetVertexNormalTexture());
+			UE_LOG(LogVATInstancingEditor, Warning, TEXT("Morph Target data cannot be fit in a %ix%i texture."), DataAsset->MaxHeight, DataAsset->MaxWidth);
+			return false;
 		}
+	}
+
+	SIZE_T PeakBakeMemory = 0;
+	bool bFitsInTexture = false;
+	if (!bBoneMode && DataAsset->bCompressVertexFrames)
+	{
+		bFitsInTexture = WriteCompressedVertexTextures(Bake, Sampler, ErrorAnalyzer, PeakBakeMemory);
+	}
+	else if (!bBoneMode)
+	{
+		bFitsInTexture = WriteVertexTextures(Bake, Sampler, ErrorAnalyzer, PeakBakeMemory);
+	}
+	else
+	{
+		bFitsInTexture = WriteBoneTextures(Bake, Sampler, ErrorAnalyzer, DataAsset->NumMorphVertices ? &MorphTargetDeltas : nullptr, MorphHeight, MorphWidth,
+			BoundsBuilder, PeakBakeMemory);
+	}
 
+	PeakBakeMemory += VertexFrameDeltas.GetAllocatedSize() + VertexFrameNormals.GetAllocatedSize()
+		+ BoneFramePositions.GetAllocatedSize() + BoneFrameRotations.GetAllocatedSize();
 
+	// StaticMesh -> SkeletalMesh Mapping and Skin Weights, alive for the whole bake
+	PeakBakeMemory += Mapping.GetAllocatedSize() + Bake.SourceVertices.GetAllocatedSize() + Bake.SkinWeights.GetAllocatedSize();
+	for (const FStaticMeshLODSkinWeights& LOD : StaticMeshLODs)
+	{
+		PeakBakeMemory += LOD.SkinWeights.GetAllocatedSize();
+	}
+
+	ErrorAnalyzer.WriteReport(DataAsset);
+
+	if (!bFitsInTexture)
+	{
+		return false;
+	}
+	
+	// ---------------------------------------------------------------------------
+
+	if (!bBoneMode)
+	{
 		// Add Vertex UVChannel
-		WriteVtxIdToNewUvChannel(DataAsset->GetStaticMesh(), DataAsset->StaticLODIndex, DataAsset->UVChannel, Height, Width);
+		WriteVtxIdToNewUvChannel(DataAsset->GetStaticMesh(), DataAsset->StaticLODIndex, DataAsset->UVChannel, Bake.Height, Bake.Width);
 
 		// Update Bounds
-		SetBoundsExtensions(DataAsset->GetStaticMesh(), static_cast<FVector>(DataAsset->VertexMinBBox), static_cast<FVector>(DataAsset->VertexSizeBBox));
+		BoundsBuilder.WriteVertexBounds(DataAsset);
+		GrowBoundsWithoutAnimationBounds(DataAsset, DataAsset->VertexMinBBox, DataAsset->VertexSizeBBox);
 
 		// Done with StaticMesh
 		DataAsset->GetStaticMesh()->PostEditChange();
@@ -286,103 +461,62 @@ bool UVATInstancingBPLibrary::AnimationToTexture(UMyAnimToTextureDataAsset* Data
 
 	// ---------------------------------------------------------------------------
 	
-	if (DataAsset->Mode == EAnim2TextureMode::Bone)
+	if (bBoneMode)
 	{
-		// Find Best Resolution for Bone Data
-		int32 Height, Width;
-
-		// Write Bone Position and Rotation Textures
-		{
-			// Note we are adding +1 frame for the ref pose
-			if (!FindBestResolution(DataAsset->NumFrames + 1, DataAsset->NumBones,
-				Height, Width, DataAsset->BoneRowsPerFrame,
-				DataAsset->MaxHeight, DataAsset->MaxWidth))
-			{
-				UE_LOG(LogVATInstancingEditor, Warning, TEXT("Bone Animation data cannot be fit in a %ix%i texture."), DataAsset->MaxHeight, DataAsset->MaxWidth);
-				return false;
-			}
-
-			// 把RefPose放在Bone Position Texture的最后一帧. RefPose Rotation在顶点着色器中其实用不到，单纯占位罢了
-			// Note: Epic官方把refPose放到第零帧，导致将Frame归一化为SampleUV前要+1，并非最优
-			BonePositions.Append(BoneRefPositions);
-			BoneRotations.Append(BoneRefRotations_NoUse);
-
-			// Normalize Bone Data
-			TArray<FVector3f> NormalizedBonePositions;
-			TArray<FVector4f> NormalizedBoneRotations;
-			NormalizeBoneData(
-				BonePositions, BoneRotations,
-				DataAsset->BoneMinBBox, DataAsset->BoneSizeBBox,
-				NormalizedBonePositions, NormalizedBoneRotations);
-
-			// Write Textures
-			if (DataAsset->PositionPrecision == EAnim2TexturePrecision::SixteenBits)
-			{
-				WriteVectorsToTexture<FVector3f, FHighPrecision>(NormalizedBonePositions, DataAsset->NumFrames + 1, DataAsset->BoneRowsPerFrame, Height, Width, DataAsset->GetBonePositionTexture());
-			}
-			else
-			{
-				WriteVectorsToTexture<FVector3f, FLowPrecision>(NormalizedBonePositions, DataAsset->NumFrames + 1, DataAsset->BoneRowsPerFrame, Height, Width, DataAsset->GetBonePositionTexture());
-			}
-
-			if (DataAsset->RotationPrecision == EAnim2TexturePrecision::SixteenBits)
-			{
-				WriteVectorsToTexture<FVector4f, FHighPrecision>(NormalizedBoneRotations, DataAsset->NumFrames + 1, DataAsset->BoneRowsPerFrame, Height, Width, DataAsset->GetBoneRotationTexture());
-			}
-			else
-			{
-				WriteVectorsToTexture<FVector4f, FLowPrecision>(NormalizedBoneRotations, DataAsset->NumFrames + 1, DataAsset->BoneRowsPerFrame, Height, Width, DataAsset->GetBoneRotationTexture());
-			}
-
-			// Update Bounds
-			SetBoundsExtensions(DataAsset->GetStaticMesh(), static_cast<FVector>(DataAsset->BoneMinBBox), static_cast<FVector>(DataAsset->BoneSizeBBox));
-		}
+		// Update Bounds
+		BoundsBuilder.WriteBoneBounds(DataAsset, Bake.SourceVertices, Bake.SkinWeights, Bake.NumInfluences, Bake.BakedBoneRefPositions);
+		GrowBoundsWithoutAnimationBounds(DataAsset, DataAsset->BoneMinBBox, DataAsset->BoneSizeBBox);
 
 		// ---------------------------------------------------------------------------
 		
 		// Write Bone Influences
+		if (!WriteBoneWeights(DataAsset, Bake.SkinWeights, NumVertices))
 		{
-			// Find Best Resolution for Bone Weights Texture
-			if (!FindBestResolution(2, NumVertices,
-				Height, Width, DataAsset->BoneWeightRowsPerFrame,
-				DataAsset->MaxHeight, DataAsset->MaxWidth))
-			{
-				UE_LOG(LogVATInstancingEditor, Warning, TEXT("Weights Data cannot be fit in a %ix%i texture."), DataAsset->MaxHeight, DataAsset->MaxWidth);
-				return false;
-			}
-
-			TArray<TVertexSkinWeight<4>> SkinWeights;
-
-			// Reduce BoneWeights to 4 Influences.
-			if (SocketIndex == INDEX_NONE)
-			{
-				// Project SkinWeights from SkeletalMesh to StaticMesh
-				TArray<VertexSkinWeightMax> StaticMeshSkinWeights;
-				Mapping.ProjectSkinWeights(StaticMeshSkinWeights);
-
-				// Reduce Weights to 4 highest influences.
-				ReduceSkinWeights(StaticMeshSkinWeights, SkinWeights);
-			}
-			// If Valid Socket, set all influences to same index.
-			else
-			{
-				// Set all indices and weights to same SocketIndex
-				SkinWeights.SetNumUninitialized(NumVertices);
-				for (TVertexSkinWeight<4>& SkinWeight : SkinWeights)
-				{
-					SkinWeight.BoneWeights = TStaticArray<uint8, 4>(InPlace, 255);
-					SkinWeight.MeshBoneIndices = TStaticArray<uint16, 4>(InPlace, SocketIndex);
-				}
-			}
+			return false;
+		}
 
-			WriteSkinWeightsToColorAndBoneIdToUvChannel(SkinWeights, DataAsset);
+		// Morph slots, after the Bone Id UVChannels
+		if (bBakeMorphTargets && !WriteMorphSlotsToUvChannel(DataAsset->GetStaticMesh(), DataAsset->StaticLODIndex, DataAsset->MorphUVChannel,
+			MorphTargetDeltas.GetVertexSlots(), DataAsset->NumMorphVertices))
+		{
+			return false;
+		}
 
+		// Other StaticMesh LODs share the Bone Textures
+		if (!WriteStaticMeshLODBoneWeights(DataAsset, StaticMeshLODs, NumVertices))
+		{
+			return false;
 		}
 
 		// Done with StaticMesh
 		DataAsset->GetStaticMesh()->PostEditChange();
 	}
 
+	// Bake Report
+	DataAsset->BakePeakMemoryMB = PeakBakeMemory / (1024.f * 1024.f);
+	UE_LOG(LogVATInstancingEditor, Display, TEXT("Baked %s: %i frames (%i stored), %ix%i texels per texture. Peak bake memory: %.2f MB"),
+		*DataAsset->GetName(), DataAsset->NumFrames, DataAsset->GetNumStoredFrames(), Bake.Width, Bake.Height, DataAsset->BakePeakMemoryMB);
+	if (DataAsset->NumTextureSlices)
+	{
+		UE_LOG(LogVATInstancingEditor, Display, TEXT("Texture Array: %i slices of %i frames"), DataAsset->NumTextureSlices, DataAsset->GetNumTextureFrames());
+	}
+	if (DataAsset->IsStreamingTexturePages())
+	{
+		UE_LOG(LogVATInstancingEditor, Display, TEXT("Streamed Texture Pages: %i, %i resident at once"), DataAsset->NumTextureSlices, FMath::Min(DataAsset->MaxResidentTexturePages, DataAsset->NumTextureSlices));
+	}
+	if (bBakeMorphTargets)
+	{
+		UE_LOG(LogVATInstancingEditor, Display, TEXT("Morph Targets: %i of %i vertices baked, %ix%i texels"), DataAsset->NumMorphVertices, NumVertices, MorphWidth, MorphHeight);
+	}
+	if (DataAsset->Mode == EAnim2TextureMode::Bone && DataAsset->RotationFormat == EAnim2TextureRotationFormat::Quaternion)
+	{
+		UE_LOG(LogVATInstancingEditor, Display, TEXT("Max bone rotation error: %.4f degrees"), DataAsset->MaxRotationErrorDegrees);
+	}
+	UE_LOG(LogVATInstancingEditor, Display, TEXT("Position error: max %.4f cm, RMS %.4f cm (%s)"),
+		DataAsset->MaxPositionError, DataAsset->RMSPositionError, *FTextureEncoding::FromDataAsset(DataAsset).ToString(DataAsset->Mode));
+
+	// DataAssets using this one as AnimationLibrary are stale until rebaked
+	DataAsset->BakeGuid = FGuid::NewGuid();
 	DataAsset->MarkPackageDirty();
 	return true;
 }
@@ -393,6 +527,13 @@ int32 UVATInstancingBPLibrary::BatchUpdateAnimToTextureAssets(TArray<FString>& F
 	TArray<FAssetData> AssetDataList;
 	AssetRegistryModule.Get().GetAssetsByClass(UMyAnimToTextureDataAsset::StaticClass()->GetClassPathName(), AssetDataList);
 
+	// AnimationLibraries need to be baked before the DataAssets sharing them
+	Algo::StableSortBy(AssetDataList, [](const FAssetData& AssetData)
+	{
+		const UMyAnimToTextureDataAsset* DataAsset = Cast<UMyAnimToTextureDataAsset>(AssetData.GetAsset());
+		return DataAsset && DataAsset->GetAnimationLibrary();
+	});
+
 	int32 SuccessCount = 0;
 	FScopedSlowTask SlowTask(AssetDataList.Num(), LOCTEXT("BatchUpdateAnimToTexture", "Batch Updating AnimToTexture Assets..."));
 	SlowTask.MakeDialog();
@@ -470,6 +611,23 @@ UPerInstanceCustomDataLayout* GetLayoutFromMaterialInterface(UMaterialInterface*
 	return nullptr;
 }
 
+/* Static switches the bake needs, but the parent Material does not expose (setting them has no effect) */
+static void LogMissingStaticSwitches(const UMyAnimToTextureDataAsset* DataAsset, const UMaterialInstanceConstant* MaterialInstance, const TArray<FName>& RequiredSwitches)
+{
+	TArray<FMaterialParameterInfo> SwitchInfos;
+	TArray<FGuid> SwitchIds;
+	MaterialInstance->GetAllStaticSwitchParameterInfo(SwitchInfos, SwitchIds);
+
+	for (const FName& SwitchName : RequiredSwitches)
+	{
+		if (!SwitchInfos.ContainsByPredicate([&](const FMaterialParameterInfo& Info) { return Info.Name == SwitchName; }))
+		{
+			UE_LOG(LogVATInstancingEditor, Error, TEXT("%s needs the Static Switch %s, but the Material of %s has none. The baked textures will be read wrong: add the switch to the Material or bake without this option."),
+				*DataAsset->GetName(), *SwitchName.ToString(), *MaterialInstance->GetName());
+		}
+	}
+}
+
 void UVATInstancingBPLibrary::UpdateMaterialInstanceFromDataAsset(UMyAnimToTextureDataAsset* DataAsset, UMaterialInstanceConstant* MaterialInstance, 
 	const EMaterialParameterAssociation MaterialParameterAssociation)
 {
@@ -529,23 +687,50 @@ void UVATInstancingBPLibrary::UpdateMaterialInstanceFromDataAsset(UMyAnimToTextu
 	// Update Vertex Params
 	if (DataAsset->Mode == EAnim2TextureMode::Vertex)
 	{
-		UMaterialEditingLibrary::SetMaterialInstanceVectorParameterValue(MaterialInstance, AnimToTextureParamNames::MinBBox, FLinearColor(DataAsset->VertexMinBBox), MaterialParameterAssociation);
-		UMaterialEditingLibrary::SetMaterialInstanceVectorParameterValue(MaterialInstance, AnimToTextureParamNames::SizeBBox, FLinearColor(DataAsset->VertexSizeBBox), MaterialParameterAssociation);
+		UMaterialEditingLibrary::SetMaterialInstanceVectorParameterValue(MaterialInstance, AnimToTextureParamNames::MinBBox, FLinearColor(DataAsset->GetMaterialMinBBox()), MaterialParameterAssociation);
+		UMaterialEditingLibrary::SetMaterialInstanceVectorParameterValue(MaterialInstance, AnimToTextureParamNames::SizeBBox, FLinearColor(DataAsset->GetMaterialSizeBBox()), MaterialParameterAssociation);
 		UMaterialEditingLibrary::SetMaterialInstanceScalarParameterValue(MaterialInstance, AnimToTextureParamNames::RowsPerFrame, DataAsset->VertexRowsPerFrame, MaterialParameterAssociation);
 		UMaterialEditingLibrary::SetMaterialInstanceTextureParameterValue(MaterialInstance, AnimToTextureParamNames::VertexPositionTexture, DataAsset->GetVertexPositionTexture(), MaterialParameterAssociation);
 		UMaterialEditingLibrary::SetMaterialInstanceTextureParameterValue(MaterialInstance, AnimToTextureParamNames::VertexNormalTexture, DataAsset->GetVertexNormalTexture(), MaterialParameterAssociation);
+
+		const bool bVertexPCA = DataAsset->bCompressVertexFrames && DataAsset->NumVertexBasis > 0;
+		UMaterialEditingLibrary::SetMaterialInstanceStaticSwitchParameterValue(MaterialInstance, AnimToTextureParamNames::UseVertexPCA, bVertexPCA, MaterialParameterAssociation);
+		if (bVertexPCA)
+		{
+			UMaterialEditingLibrary::SetMaterialInstanceScalarParameterValue(MaterialInstance, AnimToTextureParamNames::NumVertexBasis, DataAsset->NumVertexBasis, MaterialParameterAssociation);
+			UMaterialEditingLibrary::SetMaterialInstanceTextureParameterValue(MaterialInstance, AnimToTextureParamNames::VertexCoefficientTexture, DataAsset->GetVertexCoefficientTexture(), MaterialParameterAssociation);
+		}
 	}
 
 	// Update Bone Params
 	else if (DataAsset->Mode == EAnim2TextureMode::Bone)
 	{
 		UMaterialEditingLibrary::SetMaterialInstanceScalarParameterValue(MaterialInstance, AnimToTextureParamNames::NumBones, DataAsset->NumBones, MaterialParameterAssociation);
-		UMaterialEditingLibrary::SetMaterialInstanceVectorParameterValue(MaterialInstance, AnimToTextureParamNames::MinBBox, FLinearColor(DataAsset->BoneMinBBox), MaterialParameterAssociation);
-		UMaterialEditingLibrary::SetMaterialInstanceVectorParameterValue(MaterialInstance, AnimToTextureParamNames::SizeBBox, FLinearColor(DataAsset->BoneSizeBBox), MaterialParameterAssociation);
+		UMaterialEditingLibrary::SetMaterialInstanceVectorParameterValue(MaterialInstance, AnimToTextureParamNames::MinBBox, FLinearColor(DataAsset->GetMaterialMinBBox()), MaterialParameterAssociation);
+		UMaterialEditingLibrary::SetMaterialInstanceVectorParameterValue(MaterialInstance, AnimToTextureParamNames::SizeBBox, FLinearColor(DataAsset->GetMaterialSizeBBox()), MaterialParameterAssociation);
 		UMaterialEditingLibrary::SetMaterialInstanceScalarParameterValue(MaterialInstance, AnimToTextureParamNames::RowsPerFrame, DataAsset->BoneRowsPerFrame, MaterialParameterAssociation);
 		UMaterialEditingLibrary::SetMaterialInstanceScalarParameterValue(MaterialInstance, AnimToTextureParamNames::BoneWeightRowsPerFrame, DataAsset->BoneWeightRowsPerFrame, MaterialParameterAssociation);
 		UMaterialEditingLibrary::SetMaterialInstanceTextureParameterValue(MaterialInstance, AnimToTextureParamNames::BonePositionTexture, DataAsset->GetBonePositionTexture(), MaterialParameterAssociation);
 		UMaterialEditingLibrary::SetMaterialInstanceTextureParameterValue(MaterialInstance, AnimToTextureParamNames::BoneRotationTexture, DataAsset->GetBoneRotationTexture(), MaterialParameterAssociation);
+		UMaterialEditingLibrary::SetMaterialInstanceStaticSwitchParameterValue(MaterialInstance, AnimToTextureParamNames::UseQuaternionRotation, DataAsset->RotationFormat == EAnim2TextureRotationFormat::Quaternion, MaterialParameterAssociation);
+		UMaterialEditingLibrary::SetMaterialInstanceStaticSwitchParameterValue(MaterialInstance, AnimToTextureParamNames::UseDualQuaternion, DataAsset->RotationFormat == EAnim2TextureRotationFormat::DualQuaternion, MaterialParameterAssociation);
+		UMaterialEditingLibrary::SetMaterialInstanceScalarParameterValue(MaterialInstance, AnimToTextureParamNames::DualQuaternionScale, DataAsset->BoneDualQuaternionScale, MaterialParameterAssociation);
+
+		const bool bMorphTargets = DataAsset->bBakeMorphTargets && DataAsset->NumMorphVertices > 0;
+		UMaterialEditingLibrary::SetMaterialInstanceStaticSwitchParameterValue(MaterialInstance, AnimToTextureParamNames::UseMorphTargets, bMorphTargets, MaterialParameterAssociation);
+		if (bMorphTargets)
+		{
+			UMaterialEditingLibrary::SetMaterialInstanceScalarParameterValue(MaterialInstance, AnimToTextureParamNames::NumMorphVertices, DataAsset->NumMorphVertices, MaterialParameterAssociation);
+			UMaterialEditingLibrary::SetMaterialInstanceScalarParameterValue(MaterialInstance, AnimToTextureParamNames::MorphRowsPerFrame, DataAsset->MorphRowsPerFrame, MaterialParameterAssociation);
+			UMaterialEditingLibrary::SetMaterialInstanceTextureParameterValue(MaterialInstance, AnimToTextureParamNames::MorphDeltaTexture, DataAsset->GetMorphDeltaTexture(), MaterialParameterAssociation);
+		}
+		UMaterialEditingLibrary::SetMaterialInstanceStaticSwitchParameterValue(MaterialInstance, AnimToTextureParamNames::UseTextureArray, DataAsset->NumTextureSlices > 0, MaterialParameterAssociation);
+		// Streamed Texture Arrays are bound at runtime (VATTexturePageStreaming), referencing them here would keep all pages loaded
+		if (DataAsset->NumTextureSlices && !DataAsset->IsStreamingTexturePages())
+		{
+			UMaterialEditingLibrary::SetMaterialInstanceTextureParameterValue(MaterialInstance, AnimToTextureParamNames::BonePositionTextureArray, DataAsset->GetBonePositionTextureArray(), MaterialParameterAssociation);
+			UMaterialEditingLibrary::SetMaterialInstanceTextureParameterValue(MaterialInstance, AnimToTextureParamNames::BoneRotationTextureArray, DataAsset->GetBoneRotationTextureArray(), MaterialParameterAssociation);
+		}
 
 		// Num Influences
 		switch (DataAsset->NumBoneInfluences)
@@ -567,10 +752,50 @@ void UVATInstancingBPLibrary::UpdateMaterialInstanceFromDataAsset(UMyAnimToTextu
 
 	
 	// NumFrames
-	UMaterialEditingLibrary::SetMaterialInstanceScalarParameterValue(MaterialInstance, AnimToTextureParamNames::NumFrames, DataAsset->NumFrames, MaterialParameterAssociation);
+	// 去重后贴图中只有GetNumStoredFrames()帧动画，RefPose紧随其后
+	UMaterialEditingLibrary::SetMaterialInstanceScalarParameterValue(MaterialInstance, AnimToTextureParamNames::NumFrames, DataAsset->GetNumStoredFrames(), MaterialParameterAssociation);
+	UMaterialEditingLibrary::SetMaterialInstanceScalarParameterValue(MaterialInstance, AnimToTextureParamNames::NumTextureFrames, DataAsset->GetNumTextureFrames(), MaterialParameterAssociation);
+
+	// Quantization Range
+	UMaterialEditingLibrary::SetMaterialInstanceStaticSwitchParameterValue(MaterialInstance, AnimToTextureParamNames::UsePerElementRanges, DataAsset->PositionRangeMode == EAnim2TextureRangeMode::PerElement, MaterialParameterAssociation);
 
 	// SampleRate
 	UMaterialEditingLibrary::SetMaterialInstanceScalarParameterValue(MaterialInstance, AnimToTextureParamNames::SampleRate, DataAsset->SampleRate, MaterialParameterAssociation);
+	UMaterialEditingLibrary::SetMaterialInstanceStaticSwitchParameterValue(MaterialInstance, AnimToTextureParamNames::InterpolateFrames, DataAsset->bInterpolateFrames, MaterialParameterAssociation);
+
+	// 自带材质没有这些开关(VATMaterialParameterName.h), 资产用到时报错
+	TArray<FName> RequiredSwitches;
+	if (DataAsset->PositionRangeMode == EAnim2TextureRangeMode::PerElement)
+	{
+		RequiredSwitches.Add(AnimToTextureParamNames::UsePerElementRanges);
+	}
+	if (DataAsset->Mode == EAnim2TextureMode::Vertex)
+	{
+		if (DataAsset->bCompressVertexFrames && DataAsset->NumVertexBasis > 0)
+		{
+			RequiredSwitches.Add(AnimToTextureParamNames::UseVertexPCA);
+		}
+	}
+	else if (DataAsset->Mode == EAnim2TextureMode::Bone)
+	{
+		if (DataAsset->RotationFormat == EAnim2TextureRotationFormat::Quaternion)
+		{
+			RequiredSwitches.Add(AnimToTextureParamNames::UseQuaternionRotation);
+		}
+		else if (DataAsset->RotationFormat == EAnim2TextureRotationFormat::DualQuaternion)
+		{
+			RequiredSwitches.Add(AnimToTextureParamNames::UseDualQuaternion);
+		}
+		if (DataAsset->bBakeMorphTargets && DataAsset->NumMorphVertices > 0)
+		{
+			RequiredSwitches.Add(AnimToTextureParamNames::UseMorphTargets);
+		}
+		if (DataAsset->NumTextureSlices > 0)
+		{
+			RequiredSwitches.Add(AnimToTextureParamNames::UseTextureArray);
+		}
+	}
+	LogMissingStaticSwitches(DataAsset, MaterialInstance, RequiredSwitches);
 
 	// Update Material
 	UMaterialEditingLibrary::UpdateMaterialInstance(MaterialInstance);
@@ -706,23 +931,83 @@ UStaticMesh* UVATInstancingBPLibrary::ConvertSkeletalMeshToStaticMesh(USkeletalM
 }
 
 
-TArray<int32> GetWedgeUniqueIndexMap(FRawMesh& Mesh)
+// Maps every RawMesh vertex to the first vertex sharing its position.
+// With WeldThreshold > 0, vertices closer than WeldThreshold are welded together.
+TArray<int32> GetWedgeUniqueIndexMap(const FRawMesh& Mesh, const float WeldThreshold = 0.f)
 {
+	const int32 NumVertices = Mesh.VertexPositions.Num();
+
 	TArray<int32> MeshWedgeUniqueIds;
+	MeshWedgeUniqueIds.SetNumUninitialized(NumVertices);
 	int32 Duplicates = 0;
-	//UE_LOG(LogTemp, Display, TEXT("[UVertexAnimationBPLibrary::GetWedgeUniqueIndexMap] Wedge Position duplicate check, mesh vertex list: %d"), Mesh.VertexPositions.Num());
-	for (int32 i = 0; i < Mesh.VertexPositions.Num(); i++)
+
+	if (WeldThreshold <= 0.f)
 	{
-		const FVector3f& v = Mesh.VertexPositions[i];
+		TMap<FVector3f, int32> PositionToUniqueId;
+		PositionToUniqueId.Reserve(NumVertices);
 
-		int32 VertId = Mesh.VertexPositions.Find(v);
-		if (VertId != i)
+		for (int32 i = 0; i < NumVertices; i++)
 		{
-			//UE_LOG(LogTemp, Display, TEXT("[UVertexAnimationBPLibrary::GetWedgeUniqueIndexMap] Wedge Position duplicate: %d = %d"), i, VertId);
-			Duplicates++;
+			// Adding 0 turns -0.f into +0.f, so both hash the same (they compare equal)
+			const FVector3f v = Mesh.VertexPositions[i] + FVector3f::ZeroVector;
+
+			const int32 VertId = PositionToUniqueId.FindOrAdd(v, i);
+			if (VertId != i)
+			{
+				Duplicates++;
+			}
+
+			MeshWedgeUniqueIds[i] = VertId;
 		}
+	}
+	else
+	{
+		// Spatial hash with cells of WeldThreshold size. Neighbour cells are searched as well,
+		// since two close vertices may fall on either side of a cell boundary.
+		const float InvCellSize = 1.f / WeldThreshold;
+		const float WeldThresholdSquared = WeldThreshold * WeldThreshold;
+
+		TMultiMap<FIntVector, int32> CellToUniqueIds;
+		CellToUniqueIds.Reserve(NumVertices);
+
+		TArray<int32, TInlineAllocator<8>> CellUniqueIds;
+		for (int32 i = 0; i < NumVertices; i++)
+		{
+			const FVector3f& v = Mesh.VertexPositions[i];
+			const FIntVector Cell(FMath::FloorToInt(v.X * InvCellSize), FMath::FloorToInt(v.Y * InvCellSize), FMath::FloorToInt(v.Z * InvCellSize));
+
+			int32 VertId = i;
+			for (int32 z = -1; z <= 1 && VertId == i; z++)
+			{
+				for (int32 y = -1; y <= 1 && VertId == i; y++)
+				{
+					for (int32 x = -1; x <= 1 && VertId == i; x++)
+					{
+						CellUniqueIds.Reset();
+						CellToUniqueIds.MultiFind(Cell + FIntVector(x, y, z), CellUniqueIds);
+						for (const int32 UniqueId : CellUniqueIds)
+						{
+							if (FVector3f::DistSquared(v, Mesh.VertexPositions[UniqueId]) <= WeldThresholdSquared)
+							{
+								VertId = UniqueId;
+								break;
+							}
+						}
+					}
+				}
+			}
+
+			if (VertId != i)
+			{
+				Duplicates++;
+			}
+			else
+			{
+				CellToUniqueIds.Add(Cell, i);
+			}
 
-		MeshWedgeUniqueIds.Add(VertId);
+			MeshWedgeUniqueIds[i] = VertId;
+		}
 	}
 
 	//UE_LOG(LogTemp, Display, TEXT("[UVertexAnimationBPLibrary::GetWedgeUniqueIndexMap] Wedge Position duplicates: %d"), Duplicates);
@@ -730,14 +1015,18 @@ TArray<int32> GetWedgeUniqueIndexMap(FRawMesh& Mesh)
 	return MeshWedgeUniqueIds;
 }
 
-bool WriteSkinWeightsToColorAndBoneIdToUvChannel(TArray<TVertexSkinWeight<4>>& SkinWeights, UMyAnimToTextureDataAsset* DataAsset)
+bool WriteSkinWeightsToColorAndBoneIdToUvChannel(TArray<TVertexSkinWeight<4>>& SkinWeights, UMyAnimToTextureDataAsset* DataAsset, const int32 LODIndex)
 {
 	UStaticMesh* StaticMesh = DataAsset->GetStaticMesh();
-	const int32 LODIndex = DataAsset->StaticLODIndex;
 	const int32 UVChannelIndex = DataAsset->UVChannel;
 	float TextureSizeX = DataAsset->NumBones;
 
-	TMap<FVertexInstanceID, FVector2D> TexCoordsBone12, TexCoordsBone34;
+	// 需要2个UVChannel，储存4个BoneId
+	if (UVChannelIndex < 0 || UVChannelIndex + 1 >= MAX_MESH_TEXTURE_COORDS)
+	{
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("UVChannel: %i Out of Range. Bone Ids need UVChannels %i and %i"), UVChannelIndex, UVChannelIndex, UVChannelIndex + 1);
+		return false;
+	}
 
 	// 曾尝试用下面api修改颜色的值，但是发现会自动做gamma校正，修改我的值。
 	// FMeshDescription* MeshDescription = StaticMesh->GetMeshDescription(LODIndex);
@@ -745,16 +1034,33 @@ bool WriteSkinWeightsToColorAndBoneIdToUvChannel(TArray<TVertexSkinWeight<4>>& S
 
 	FRawMesh Mesh;
 	StaticMesh->GetSourceModel(LODIndex).LoadRawMesh(Mesh);
+	const int32 NumWedges = Mesh.WedgeIndices.Num();
+
 	// Map wedge vertex index to unique dataset
-	TArray<int32> WedgeUniqueIndexMap = GetWedgeUniqueIndexMap(Mesh);
+	TArray<int32> WedgeUniqueIndexMap = GetWedgeUniqueIndexMap(Mesh, DataAsset->WeldThreshold);
 	// Reserve space for the new vertex colors.
-	if (Mesh.WedgeColors.Num() == 0 || Mesh.WedgeColors.Num() != Mesh.WedgeIndices.Num())
+	if (Mesh.WedgeColors.Num() == 0 || Mesh.WedgeColors.Num() != NumWedges)
+	{
+		Mesh.WedgeColors.Empty(NumWedges);
+		Mesh.WedgeColors.AddUninitialized(NumWedges);
+	}
+
+	// UVChannels are stored per wedge in the RawMesh, so they are written in place.
+	// Lower channels that don't exist yet are zero filled, as InsertUVChannel would do.
+	for (int32 Id = 0; Id < UVChannelIndex; ++Id)
 	{
-		Mesh.WedgeColors.Empty(Mesh.WedgeIndices.Num());
-		Mesh.WedgeColors.AddUninitialized(Mesh.WedgeIndices.Num());
+		if (Mesh.WedgeTexCoords[Id].Num() != NumWedges)
+		{
+			Mesh.WedgeTexCoords[Id].SetNumZeroed(NumWedges);
+		}
 	}
+	TArray<FVector2f>& TexCoordsBone12 = Mesh.WedgeTexCoords[UVChannelIndex];
+	TArray<FVector2f>& TexCoordsBone34 = Mesh.WedgeTexCoords[UVChannelIndex + 1];
+	TexCoordsBone12.SetNumUninitialized(NumWedges);
+	TexCoordsBone34.SetNumUninitialized(NumWedges);
+
 	// Build a mapping of vertex positions to vertex colors.
-	for (int32 WedgeIndex = 0; WedgeIndex < Mesh.WedgeIndices.Num(); ++WedgeIndex)
+	for (int32 WedgeIndex = 0; WedgeIndex < NumWedges; ++WedgeIndex)
 	{
 		int32 VertID = Mesh.WedgeIndices[WedgeIndex];
 		VertID = WedgeUniqueIndexMap[VertID];
@@ -765,27 +1071,156 @@ bool WriteSkinWeightsToColorAndBoneIdToUvChannel(TArray<TVertexSkinWeight<4>>& S
 		Mesh.WedgeColors[WedgeIndex] = FColor(w[0], w[1], w[2], w[3]);
 
 		// 在这里完成BoneId到SampleUV.x的转换, 以减少shader指令数
-		TexCoordsBone12.Add(WedgeIndex, FVector2D(b[0] + 0.5f, b[1] + 0.5f) / TextureSizeX);
-		TexCoordsBone34.Add(WedgeIndex, FVector2D(b[2] + 0.5f, b[3] + 0.5f) / TextureSizeX);
+		// Full precision UVs keep all 16 bits of the BoneId: floor(UV * NumBones) is exact up to 65535 bones.
+		// When bones don't fit in a row (BoneRowsPerFrame > 1), the Material splits it in column and row of the frame
+		TexCoordsBone12[WedgeIndex] = FVector2f(b[0] + 0.5f, b[1] + 0.5f) / TextureSizeX;
+		TexCoordsBone34[WedgeIndex] = FVector2f(b[2] + 0.5f, b[3] + 0.5f) / TextureSizeX;
 	}
 
 	// Save the new raw mesh.
 	StaticMesh->GetSourceModel(LODIndex).SaveRawMesh(Mesh);
 	StaticMesh->ImportVersion = EImportStaticMeshVersion::LastVersion;
+	SetFullPrecisionUVs(StaticMesh, LODIndex, true);
 
-	// 需要2个UVChannel，储存4个BoneId
-	int32 NumUVChannels = StaticMesh->GetNumUVChannels(LODIndex);
-	int32 NumUVChannelsToInsert = UVChannelIndex - NumUVChannels + 2;
-	for (int32 Id = NumUVChannels; Id < NumUVChannels + NumUVChannelsToInsert; ++Id)
+	return true;
+}
+
+bool WriteBoneWeights(UMyAnimToTextureDataAsset* DataAsset, TArray<VertexSkinWeightFour>& SkinWeights, const int32 NumVertices)
+{
+	// Find Best Resolution for Bone Weights Texture
+	int32 WeightsHeight, WeightsWidth;
+	if (!FindBestResolution(2, NumVertices,
+		WeightsHeight, WeightsWidth, DataAsset->BoneWeightRowsPerFrame,
+		DataAsset->MaxHeight, DataAsset->MaxWidth))
 	{
-		StaticMesh->InsertUVChannel(LODIndex, Id);
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("Weights Data cannot be fit in a %ix%i texture."), DataAsset->MaxHeight, DataAsset->MaxWidth);
+		return false;
+	}
+
+	return WriteSkinWeightsToColorAndBoneIdToUvChannel(SkinWeights, DataAsset, DataAsset->StaticLODIndex);
+}
+
+void GetStaticMeshLODSkinWeights(const UMyAnimToTextureDataAsset* DataAsset, const int32 SocketIndex, TArray<FStaticMeshLODSkinWeights>& OutLODs)
+{
+	OutLODs.Reset();
+	if (!DataAsset->bBakeAllStaticMeshLODs)
+	{
+		return;
+	}
+
+	const UStaticMesh* StaticMesh = DataAsset->GetStaticMesh();
+	for (int32 LODIndex = 0; LODIndex < StaticMesh->GetNumSourceModels(); ++LODIndex)
+	{
+		if (LODIndex == DataAsset->StaticLODIndex || !StaticMesh->IsSourceModelValid(LODIndex))
+		{
+			continue;
+		}
+
+		// Every LOD is bound to the same SkeletalMesh LOD the Bone Textures were sampled with
+		FSourceMeshToDriverMesh Mapping;
+		Mapping.Update(StaticMesh, LODIndex,
+			DataAsset->GetSkeletalMesh(), DataAsset->SkeletalLODIndex, DataAsset->NumDriverTriangles, DataAsset->Sigma);
+
+		FStaticMeshLODSkinWeights& LOD = OutLODs.AddDefaulted_GetRef();
+		LOD.LODIndex = LODIndex;
+		GetBoneSkinWeights(Mapping, SocketIndex, Mapping.GetNumSourceVertices(), LOD.SkinWeights);
+	}
+}
+
+bool WriteStaticMeshLODBoneWeights(UMyAnimToTextureDataAsset* DataAsset, TArray<FStaticMeshLODSkinWeights>& LODs, const int32 NumVertices)
+{
+	DataAsset->BakedLODNumVertices.Init(0, DataAsset->GetStaticMesh()->GetNumSourceModels());
+	DataAsset->BakedLODNumVertices[DataAsset->StaticLODIndex] = NumVertices;
+
+	for (FStaticMeshLODSkinWeights& LOD : LODs)
+	{
+		if (!RemapToBakedBones(DataAsset, LOD.SkinWeights) || !WriteSkinWeightsToColorAndBoneIdToUvChannel(LOD.SkinWeights, DataAsset, LOD.LODIndex))
+		{
+			return false;
+		}
+
+		// Morph deltas are only baked for StaticLODIndex, the other LODs skip them
+		if (DataAsset->bBakeMorphTargets && !WriteMorphSlotsToUvChannel(DataAsset->GetStaticMesh(), LOD.LODIndex, DataAsset->MorphUVChannel, TArray<int32>(), DataAsset->NumMorphVertices))
+		{
+			return false;
+		}
+
+		DataAsset->BakedLODNumVertices[LOD.LODIndex] = LOD.SkinWeights.Num();
+	}
+
+	for (int32 LODIndex = 0; LODIndex < DataAsset->BakedLODNumVertices.Num(); ++LODIndex)
+	{
+		if (DataAsset->BakedLODNumVertices[LODIndex])
+		{
+			UE_LOG(LogVATInstancingEditor, Display, TEXT("StaticMesh LOD %i: %i vertices"), LODIndex, DataAsset->BakedLODNumVertices[LODIndex]);
+		}
 	}
-	StaticMesh->SetUVChannel(LODIndex, UVChannelIndex, TexCoordsBone12);
-	StaticMesh->SetUVChannel(LODIndex, UVChannelIndex + 1, TexCoordsBone34);
-	SetFullPrecisionUVs(StaticMesh, LODIndex, true);
 
 	return true;
 }
 
+void GrowBoundsWithoutAnimationBounds(const UMyAnimToTextureDataAsset* DataAsset, const FVector3f& MinBBox, const FVector3f& SizeBBox)
+{
+	// 有动画包围盒时由ISMC按实例剔除，不再扩大StaticMesh包围盒(否则静止的实例也用全部动画的包围盒剔除)
+	for (const FAnim2TextureAnimInfo& AnimInfo : DataAsset->Animations)
+	{
+		if (!AnimInfo.Bounds.IsValid)
+		{
+			SetBoundsExtensions(DataAsset->GetStaticMesh(), static_cast<FVector>(MinBBox), static_cast<FVector>(SizeBBox));
+			return;
+		}
+	}
+	UStaticMesh* StaticMesh = DataAsset->GetStaticMesh();
+	StaticMesh->SetPositiveBoundsExtension(FVector::ZeroVector);
+	StaticMesh->SetNegativeBoundsExtension(FVector::ZeroVector);
+	StaticMesh->CalculateExtendedBounds();
+}
+
+bool RemapToBakedBones(const UMyAnimToTextureDataAsset* DataAsset, TArray<VertexSkinWeightFour>& InOutSkinWeights)
+{
+	// All Bones are baked, Bone Ids are the Raw Bone indices
+	if (DataAsset->BakedBones.IsEmpty())
+	{
+		return true;
+	}
+
+	int32 MissingBone;
+	if (!RemapSkinWeightsToBakedBones(DataAsset->BakedBones, GetNumBoneInfluences(DataAsset), InOutSkinWeights, MissingBone))
+	{
+		TArray<FName> BoneNames;
+		GetBoneNames(DataAsset->GetSkeletalMesh(), BoneNames);
+		UE_LOG(LogVATInstancingEditor, Warning, TEXT("Bone: %s influences StaticMesh: %s but is not baked. Disable bStripUnusedBones on AnimationLibrary: %s and rebake it"),
+			*BoneNames[MissingBone].ToString(), *DataAsset->GetStaticMesh()->GetName(), DataAsset->GetAnimationLibrary() ? *DataAsset->GetAnimationLibrary()->GetName() : TEXT("None"));
+		return false;
+	}
+
+	return true;
+}
+
+void GetBoneSkinWeights(const FSourceMeshToDriverMesh& Mapping, const int32 SocketIndex, const int32 NumVertices, TArray<VertexSkinWeightFour>& OutSkinWeights)
+{
+	// Reduce BoneWeights to 4 Influences.
+	if (SocketIndex == INDEX_NONE)
+	{
+		// Project SkinWeights from SkeletalMesh to StaticMesh
+		TArray<VertexSkinWeightMax> StaticMeshSkinWeights;
+		Mapping.ProjectSkinWeights(StaticMeshSkinWeights);
+
+		// Reduce Weights to 4 highest influences.
+		ReduceSkinWeights(StaticMeshSkinWeights, OutSkinWeights);
+	}
+	// If Valid Socket, set all influences to same index.
+	else
+	{
+		// Set all indices and weights to same SocketIndex
+		OutSkinWeights.SetNumUninitialized(NumVertices);
+		for (TVertexSkinWeight<4>& SkinWeight : OutSkinWeights)
+		{
+			SkinWeight.BoneWeights = TStaticArray<uint8, 4>(InPlace, 255);
+			SkinWeight.MeshBoneIndices = TStaticArray<uint16, 4>(InPlace, SocketIndex);
+		}
+	}
+}
+
 
 #undef LOCTEXT_NAMESPACE
\ No newline at end of file
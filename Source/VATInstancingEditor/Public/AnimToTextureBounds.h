@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include "AnimToTextureSkeletalMesh.h"
+#include "CoreMinimal.h"
+#include "MyAnimToTextureDataAsset.h"
+
+namespace AnimToTexture_Private
+{
+
+/** Local bounds of every animation and frame range (BoundsFramesPerRange), stored in FAnim2TextureAnimInfo.
+*   Vertex Mode: bounds of the deformed vertices.
+*   Bone Mode: a linearly blended vertex is a weighted average of the vertex rotated around each of its Bones, so it stays
+*   inside the spheres centered on the animated Bone positions, whose radius is the RefPose distance to the vertex.
+*   Frames only gather the bounds of the Bone positions, the radii of the StaticMesh vertices are added once all frames are in. */
+class FAnimationBoundsBuilder
+{
+public:
+	/* The frame ranges of the Animations of DataAsset must be known. NumBones is zero in Vertex Mode */
+	void Init(const UMyAnimToTextureDataAsset* DataAsset, const int32 InNumBones);
+
+	/* Bone Mode: Positions relative to RefPose, as returned by GetBonePositionsAndRotations */
+	void AddBoneFrame(const int32 AnimIndex, const int32 SampleIndex, const TArray<FVector3f>& BoneRefPositions, const TArray<FVector3f>& BonePositions);
+
+	/* Vertex Mode: Deltas as returned by GetVertexDeltasAndNormals */
+	void AddVertexFrame(const int32 AnimIndex, const int32 SampleIndex, const TArray<FVector3f>& Vertices, const TArray<FVector3f>& VertexDeltas);
+
+	/* Bone Mode: Morph Target deltas of a frame, added to the vertices before skinning */
+	void AddMorphDeltas(const TArray<int32>& VertexSlots, const TArray<FVector3f>& MorphDeltas);
+
+	/* Bone Mode: bounds of the StaticMesh Vertices skinned by the gathered Bone positions. Also keeps the Bone bounds for AnimationLibrary users */
+	void WriteBoneBounds(UMyAnimToTextureDataAsset* DataAsset, const TArray<FVector3f>& Vertices, const TArray<VertexSkinWeightFour>& SkinWeights,
+		const int32 NumInfluences, const TArray<FVector3f>& BoneRefPositions) const;
+
+	void WriteVertexBounds(UMyAnimToTextureDataAsset* DataAsset) const;
+
+	/* Bounds of a DataAsset using an AnimationLibrary, from the Bone bounds baked by the Library. Returns false if the Library has none */
+	static bool WriteBoundsFromLibrary(UMyAnimToTextureDataAsset* DataAsset, const TArray<FVector3f>& Vertices, const TArray<VertexSkinWeightFour>& SkinWeights);
+
+private:
+	int32 GetRange(const int32 AnimIndex, const int32 SampleIndex) const;
+
+	/* Radius of the vertices skinned by every Bone, negative for Bones skinning no vertex */
+	void GetBoneRadii(const TArray<FVector3f>& Vertices, const TArray<VertexSkinWeightFour>& SkinWeights, const int32 NumInfluences,
+		const TArray<FVector3f>& BoneRefPositions, TArray<float>& OutRadii) const;
+
+	/* Writes the bounds of every range to the Animations, the bounds of an animation are the union of its ranges */
+	static void WriteRangeBounds(UMyAnimToTextureDataAsset* DataAsset, const TArray<FBox3f>& InRangeBounds);
+
+	int32 FramesPerRange = 0;
+	int32 NumBones = 0;
+	TArray<int32> AnimFirstRanges;
+
+	// Vertex Mode: per range. Bone Mode: per range and Bone
+	TArray<FBox3f> RangeBounds;
+
+	// Largest Morph Target delta of every vertex
+	TArray<float> MorphExtents;
+};
+
+} // end namespace AnimToTexture_Private
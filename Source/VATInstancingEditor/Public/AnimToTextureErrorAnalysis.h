@@ -0,0 +1,167 @@
+﻿#pragma once
+
+#include "AnimToTextureSkeletalMesh.h"
+#include "CoreMinimal.h"
+#include "MyAnimToTextureDataAsset.h"
+
+namespace AnimToTexture_Private
+{
+
+/* Precision and format of the Position and Rotation (or Normal) Textures */
+struct FTextureEncoding
+{
+	EAnim2TexturePrecision PositionPrecision = EAnim2TexturePrecision::SixteenBits;
+	EAnim2TextureRangeMode PositionRangeMode = EAnim2TextureRangeMode::Global;
+	EAnim2TextureRotationFormat RotationFormat = EAnim2TextureRotationFormat::AxisAngle;
+	EAnim2TexturePrecision RotationPrecision = EAnim2TexturePrecision::SixteenBits;
+
+	static FTextureEncoding FromDataAsset(const UMyAnimToTextureDataAsset* DataAsset);
+	void ApplyToDataAsset(UMyAnimToTextureDataAsset* DataAsset) const;
+
+	/* Bytes of a Bone (or Vertex) per frame. Vertex Mode only counts positions, its Normals keep RotationPrecision */
+	int32 GetBytesPerElement(const EAnim2TextureMode Mode) const;
+
+	FString ToString(const EAnim2TextureMode Mode) const;
+};
+
+/* Encodings the error budget selects from, cheapest first. Vertex Mode only varies positions */
+TArray<FTextureEncoding> GetCandidateEncodings(const UMyAnimToTextureDataAsset* DataAsset);
+
+/* Round-trips positions through the Position Texture texels, as decoded by the Material */
+class FPositionQuantizer
+{
+public:
+	/* ElementMin/MaxBBoxes are only used with PerElement ranges */
+	FPositionQuantizer(const FTextureEncoding& Encoding, const FVector3f& InMinBBox, const FVector3f& InSizeBBox,
+		const TArray<FVector3f>& ElementMinBBoxes, const TArray<FVector3f>& ElementMaxBBoxes);
+
+	/* Position of Element (Bone or Vertex) */
+	FVector3f Decode(const FVector3f& Position, const int32 Element) const;
+
+	/* RefPose is always normalized with the global Bounding Box (not normalized with HalfFloat) */
+	FVector3f DecodeRefPose(const FVector3f& Position) const;
+
+private:
+	FVector3f MinBBox;
+	FVector3f SizeBBox;
+	EAnim2TexturePrecision Precision;
+
+	// Empty with Global ranges
+	TArray<FVector3f> ElementMins;
+	TArray<FVector3f> ElementSizes;
+};
+
+/* Round-trips an AxisAndAngle Rotation through the Rotation Texture texels */
+FQuat4f DecodeQuantizedRotation(const FVector4f& AxisAndAngle, const FTextureEncoding& Encoding);
+
+/* Skinning as done by the Material: every bone rotates Vertex around its RefPose position, then moves it by its position delta.
+*  The first NumInfluences weights are used, normalized */
+FVector3f SkinVertex(const FVector3f& Vertex, const VertexSkinWeightFour& SkinWeight, const int32 NumInfluences,
+	const TArray<FVector3f>& BoneRefPositions, const TArray<FVector3f>& BonePositions, const TArray<FQuat4f>& BoneRotations);
+
+/* Dual Quaternion skinning as done by VATDualQuaternion.ush: weighted Real and Dual parts are blended, then normalized */
+FVector3f SkinVertexDualQuaternion(const FVector3f& Vertex, const VertexSkinWeightFour& SkinWeight, const int32 NumInfluences,
+	const TArray<FVector4f>& BoneReals, const TArray<FVector4f>& BoneDuals);
+
+struct FErrorAccumulator
+{
+	float Max = 0.f;
+	double SumSquared = 0.0;
+	int64 Count = 0;
+
+	void Add(const float Error)
+	{
+		Max = FMath::Max(Max, Error);
+		SumSquared += static_cast<double>(Error) * Error;
+		Count++;
+	}
+
+	float GetRMS() const { return Count ? static_cast<float>(FMath::Sqrt(SumSquared / Count)) : 0.f; }
+};
+
+/** Measures the position error (in centimetres) introduced by an encoding, frame by frame:
+*   Bone Mode: StaticMesh vertices skinned with the decoded bones, against the same vertices skinned with the unquantized ones.
+*   Vertex Mode: decoded vertex deltas against the unquantized ones.
+*   Skin Weights are the same on both sides, only texel quantization is measured. */
+class FQuantizationErrorAnalyzer
+{
+public:
+	FQuantizationErrorAnalyzer(const FTextureEncoding& InEncoding, const FPositionQuantizer& InQuantizer, const int32 NumVertices, const int32 NumAnimations);
+
+	/* Bone Mode: RefPose vertices and Skin Weights of the StaticMesh. Arrays must outlive the analyzer */
+	void SetSkinning(const TArray<FVector3f>& InVertices, const TArray<VertexSkinWeightFour>& InSkinWeights, const int32 InNumInfluences,
+		const TArray<FVector3f>& InBoneRefPositions);
+
+	/* DualQuaternion RotationFormat: range of the Dual texels (BoneDualQuaternionScale) */
+	void SetDualQuaternionScale(const float InDualQuaternionScale) { DualQuaternionScale = FMath::Max(InDualQuaternionScale, UE_SMALL_NUMBER); }
+
+	/* Bone Mode: Positions relative to RefPose and AxisAndAngle Rotations, as returned by GetBonePositionsAndRotations */
+	void AddBoneFrame(const int32 AnimIndex, const TArray<FVector3f>& BonePositions, const TArray<FVector4f>& BoneRotations);
+
+	/* Vertex Mode: Deltas as returned by GetVertexDeltasAndNormals */
+	void AddVertexFrame(const int32 AnimIndex, const TArray<FVector3f>& VertexDeltas);
+
+	/* Vertex Mode with bCompressVertexFrames: reconstruction error of a frame, as left by FVertexPCA::Quantize */
+	void AddVertexResiduals(const int32 AnimIndex, TArrayView<const FVector3f> VertexResiduals);
+
+	const FTextureEncoding& GetEncoding() const { return Encoding; }
+	const FErrorAccumulator& GetTotalError() const { return TotalError; }
+
+	/* Stores Max and RMS errors per AnimSequence, Bone and Vertex in the GeneratedInfo of DataAsset */
+	void WriteReport(UMyAnimToTextureDataAsset* DataAsset) const;
+
+private:
+	void AddVertexError(const int32 AnimIndex, const int32 VertexIndex, const float Error);
+
+	FTextureEncoding Encoding;
+	FPositionQuantizer Quantizer;
+
+	// Bone Mode
+	const TArray<FVector3f>* Vertices = nullptr;
+	const TArray<VertexSkinWeightFour>* SkinWeights = nullptr;
+	const TArray<FVector3f>* BoneRefPositions = nullptr;
+	int32 NumInfluences = 4;
+	TArray<FVector3f> DecodedBoneRefPositions;
+	TArray<int32> VertexDominantBones;
+
+	// Per-Frame scratch buffers
+	TArray<FQuat4f> BoneRotations;
+	TArray<FVector3f> DecodedBonePositions;
+	TArray<FQuat4f> DecodedBoneRotations;
+	TArray<FVector4f> DecodedBoneReals;
+	TArray<FVector4f> DecodedBoneDuals;
+	float DualQuaternionScale = 1.f;
+
+	FErrorAccumulator TotalError;
+	TArray<FErrorAccumulator> AnimationErrors;
+	TArray<FErrorAccumulator> BoneErrors;
+	TArray<FErrorAccumulator> VertexErrors;
+};
+
+/** Upper bound of the FQuantizationErrorAnalyzer error of a Bone Mode encoding, measured on the Bones only.
+*   A skinned vertex moves at most by RotationError * Reach + 2 * RefPoseError + PositionError of one of its Bones,
+*   Reach being the distance from the Bone RefPose to its farthest vertex. Not valid for Dual Quaternions (blending differs). */
+class FBoneErrorBound
+{
+public:
+	FBoneErrorBound(const FTextureEncoding& InEncoding, const FPositionQuantizer& InQuantizer,
+		const TArray<FVector3f>& Vertices, const TArray<VertexSkinWeightFour>& SkinWeights, const int32 NumInfluences,
+		const TArray<FVector3f>& BoneRefPositions);
+
+	/* Positions relative to RefPose and AxisAndAngle Rotations, as returned by GetBonePositionsAndRotations */
+	void AddBoneFrame(const TArray<FVector3f>& BonePositions, const TArray<FVector4f>& BoneRotations);
+
+	float GetMaxError() const { return MaxError; }
+
+private:
+	FTextureEncoding Encoding;
+	FPositionQuantizer Quantizer;
+
+	// Per Bone, Reach is negative for Bones without vertices
+	TArray<float> BoneReaches;
+	TArray<float> RefPoseErrors;
+
+	float MaxError = 0.f;
+};
+
+} // end namespace AnimToTexture_Private
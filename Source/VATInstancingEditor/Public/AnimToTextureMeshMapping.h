@@ -12,12 +12,37 @@ struct FSourceVertexDriverTriangleData
 {
 	uint8               TangentLocalIndex;
 	float               InverseDistanceWeight;
+	int32               DriverTriangleIndex;
 	FIntVector3         Triangle;
 	FVector3f           BarycentricCoords;
 	FMatrix44f          InvMatrix;
 	VertexSkinWeightMax SkinWeights;
 };
 
+// Frame of a Deformed Driver Triangle.
+// It only depends on the triangle, so it is computed once per pose and shared by all SourceVertices bound to it.
+struct FDriverTriangleFrame
+{
+	FVector3f Origin;           // PointA
+	FVector3f Edge1;            // PointB - PointA
+	FVector3f Edge2;            // PointC - PointA
+	FVector3f Normal;           // Edge1 x Edge2
+	FVector3f Edge1CrossNormal;
+	FVector3f Edge2CrossNormal;
+};
+
+// SourceVertex -> DriverTriangle binding with InvMatrix, Barycentric Coords and InverseDistanceWeight folded in.
+// DeformedPosition = Weight * Origin + Sum(PositionCoeffs[i] * Axis[i])
+// DeformedNormal   = Sum(NormalCoeffs[i] * Axis[i])
+// where Axis = { Edge1, Edge2, Normal, Edge1CrossNormal, Edge2CrossNormal }
+struct FDriverTriangleInfluence
+{
+	int32 FrameIndex;
+	float Weight;
+	float PositionCoeffs[5];
+	float NormalCoeffs[5];
+};
+
 class FSourceVertexData
 {
 public:
@@ -58,6 +83,9 @@ public:
 	// Project SkinWeights
 	void ProjectSkinWeights(TArray<VertexSkinWeightMax>& OutSkinWeights) const;
 
+	// Memory held by the Mapping
+	SIZE_T GetAllocatedSize() const;
+
 private:
 
 	// Size of Source Mesh
@@ -70,6 +98,13 @@ private:
 	TArray<FIntVector3> DriverTriangles;
 	TArray<VertexSkinWeightMax> DriverSkinWeights;
 
+	// Compact Deformation Data.
+	// Only the DriverTriangles used by at least one SourceVertex get a Frame.
+	TArray<FIntVector3>              BoundDriverTriangles;
+	TArray<FDriverTriangleInfluence> Influences;
+	TArray<int32>                    InfluenceOffsets; // Size of NumSourceVertices + 1
+
+	void BuildInfluences();
 };
 
 } // end namespace AnimToTexture_Private
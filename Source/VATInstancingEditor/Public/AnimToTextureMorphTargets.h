@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include "AnimToTextureMeshMapping.h"
+#include "CoreMinimal.h"
+
+class USkeletalMesh;
+class USkeletalMeshComponent;
+
+namespace AnimToTexture_Private
+{
+
+/* Weight of every Morph Target of the SkeletalMesh (GetMorphTargets order) in the evaluated pose of SkeletalMeshComponent */
+void GetMorphTargetWeights(const USkeletalMeshComponent* SkeletalMeshComponent, TArray<float>& OutWeights);
+
+/* Adds the weighted deltas of the Morph Targets at LODIndex to the RefPose Vertices of the SkeletalMesh */
+void ApplyMorphTargets(const USkeletalMesh* SkeletalMesh, const int32 LODIndex, const TArray<float>& Weights,
+	TArray<FVector3f>& InOutVertices);
+
+/** StaticMesh vertex deltas of the Morph Targets in RefPose space, for Bone Mode with bBakeMorphTargets.
+*   The Material adds them to the vertex before skinning it.
+*   Only the vertices moved by an active Morph Target get a slot, in StaticMesh vertex order. */
+class FMorphTargetDeltas
+{
+public:
+	/* ActiveMorphTargets: Morph Targets with a non-zero weight in any frame */
+	void Update(const FSourceMeshToDriverMesh& Mapping, const USkeletalMesh* SkeletalMesh, const int32 LODIndex,
+		const TArray<bool>& ActiveMorphTargets);
+
+	int32 GetNumMorphVertices() const { return MorphVertices.Num(); }
+
+	/* Slot of every StaticMesh vertex, INDEX_NONE when no Morph Target moves it */
+	const TArray<int32>& GetVertexSlots() const { return VertexSlots; }
+
+	/* Deltas of the vertices with a slot, in slot order */
+	void GetFrameDeltas(const TArray<float>& Weights, TArray<FVector3f>& OutDeltas) const;
+
+private:
+	const FSourceMeshToDriverMesh* Mapping = nullptr;
+	const USkeletalMesh* SkeletalMesh = nullptr;
+	int32 LODIndex = 0;
+
+	// RefPose Driver (SkeletalMesh) vertices and the StaticMesh vertices deformed by them
+	TArray<FVector3f> DriverRefVertices;
+	TArray<FVector3f> SourceRefVertices;
+
+	TArray<int32> VertexSlots;
+	TArray<int32> MorphVertices;
+};
+
+} // end namespace AnimToTexture_Private
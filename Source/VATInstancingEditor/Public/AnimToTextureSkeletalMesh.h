@@ -30,7 +30,7 @@ int32 GetVertices(const USkeletalMesh* SkeletalMesh, const int32 LODIndex,
 int32 GetTriangles(const USkeletalMesh* SkeletalMesh, const int32 LODIndex,
 	TArray<FIntVector3>& OutTriangles);
 
-/* Computes CPUSkinning at Pose */
+/* Computes CPUSkinning at Pose, active Morph Targets included */
 void GetSkinnedVertices(const USkeletalMeshComponent* SkeletalMeshComponent, const int32 LODIndex,
 	TArray<FVector3f>& OutPositions);
 
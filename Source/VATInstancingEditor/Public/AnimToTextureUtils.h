@@ -2,9 +2,12 @@
 
 #include "AnimToTextureSkeletalMesh.h"
 #include "CoreMinimal.h"
+#include "MyAnimToTextureDataAsset.h"
 #include "TextureResource.h"
+#include "Math/Float16Color.h"
 #include "Engine/Texture.h"
 #include "Engine/Texture2D.h"
+#include "Engine/Texture2DArray.h"
 
 namespace AnimToTexture_Private
 {
@@ -35,36 +38,146 @@ struct FHighPrecision
 	static constexpr ColorType DefaultColor = { 0, 0, 0, 0 };
 };
 
-/** Writes list of vectors into texture
-*   Note: They must be pre-normalized. */
-template<class V, class TextureSettings>
-bool WriteVectorsToTexture(const TArray<V>& Vectors,
-	const int32 NumFrames, const int32 RowsPerFrame,
-	const int32 Height, const int32 Width, 
-	UTexture2D* Texture);
-
-/* Writes list of skinweights into texture.
-*  The SkinWeights data is already in uint8 & uint16 format, no need for normalizing it.
-*/
-//template<class TextureSettings>
-//bool WriteSkinWeightsToTexture(const TArray<VertexSkinWeightFour>& SkinWeights, const int32 NumBones,
-//	const int32 RowsPerFrame,
-//	const int32 Height, const int32 Width,
-//	UTexture2D* Texture);
+/* Values are stored as they are, no clamping to [0-1] */
+struct FHalfPrecision
+{
+	using ColorType = FFloat16Color;
+	static constexpr EPixelFormat PixelFormat = EPixelFormat::PF_FloatRGBA;
+	static constexpr ETextureSourceFormat TextureSourceFormat = ETextureSourceFormat::TSF_RGBA16F;
+	static constexpr TextureCompressionSettings CompressionSettings = TextureCompressionSettings::TC_HDR;
+	static inline const ColorType DefaultColor = FFloat16Color();
+};
+
+/* Number of quantization steps of a [0-1] texture channel. HalfFloat has 11 significant bits */
+FORCEINLINE float GetQuantizationSteps(const EAnim2TexturePrecision Precision)
+{
+	switch (Precision)
+	{
+		case EAnim2TexturePrecision::EightBits:
+			return TNumericLimits<uint8>::Max();
+		case EAnim2TexturePrecision::HalfFloat:
+			return 2048.f;
+		default:
+			return TNumericLimits<uint16>::Max();
+	}
+}
+
+/* Value of a texture channel as read by the Material. UNORM channels clamp Value to [0-1] */
+FORCEINLINE float QuantizeChannel(const float Value, const EAnim2TexturePrecision Precision)
+{
+	if (Precision == EAnim2TexturePrecision::HalfFloat)
+	{
+		return FFloat16(Value).GetFloat();
+	}
+
+	const float Steps = GetQuantizationSteps(Precision);
+	return FMath::RoundToFloat(FMath::Clamp(Value, 0.f, 1.f) * Steps) / Steps;
+}
 
 /* Helper utility for writing 8 or 16 bits textures */
 template<class TextureSettings>
 bool WriteToTexture(UTexture2D* Texture, const uint32 Height, const uint32 Width, const TArray<typename TextureSettings::ColorType>& Data);
 
-template<class V /* FVector3f / FVector4f */, class C /* FColor / FVector4u16 */>
+/* Same as WriteToTexture, Data holds NumSlices slices of SliceHeight rows one after another */
+template<class TextureSettings>
+bool WriteToTextureArray(UTexture2DArray* Texture, const uint32 SliceHeight, const uint32 Width, const uint32 NumSlices, const TArray<typename TextureSettings::ColorType>& Data);
+
+template<class V /* FVector3f / FVector4f */, class C /* FColor / FVector4u16 / FFloat16Color */>
 void VectorToColor(const V& Vector, C& Color);
 
+/** Pixel buffer of a single VAT texture.
+*   Frames are quantized straight into their rows, so the vectors of all frames never need to be kept in memory.
+*   Note: They must be pre-normalized. */
+class FVectorTextureWriter
+{
+public:
+	FVectorTextureWriter(const EAnim2TexturePrecision Precision, const int32 InRowsPerFrame, const int32 InHeight, const int32 InWidth);
+
+	template<class V>
+	void WriteFrame(const int32 Frame, const TArray<V>& Vectors);
+
+	/* Already encoded texels (e.g. Quaternions), the writer must be 8 bits */
+	void WriteFrame(const int32 Frame, const TArray<FColor>& Texels);
+
+	bool WriteToTexture(UTexture2D* Texture) const;
+
+	/* Frames are split in NumSlices slices of the same height */
+	bool WriteToTextureArray(UTexture2DArray* Texture, const int32 NumSlices) const;
+
+	/* Writes a single slice of WriteToTextureArray to a Texture2D (a streamed page) */
+	bool WriteSliceToTexture(UTexture2D* Texture, const int32 NumSlices, const int32 Slice) const;
+
+	/* Hash of the texels of a frame */
+	uint32 GetFrameHash(const int32 Frame) const;
+
+	/* Whether two frames have exactly the same texels */
+	bool IsFrameEqual(const int32 FrameA, const int32 FrameB) const;
+
+	/* Only the first NumFrames will be written to the texture */
+	void SetNumFrames(const int32 NumFrames);
+
+	int32 GetHeight() const { return Height; }
+
+	SIZE_T GetAllocatedSize() const { return LowPrecisionPixels.GetAllocatedSize() + HighPrecisionPixels.GetAllocatedSize() + HalfPrecisionPixels.GetAllocatedSize(); }
+
+private:
+	const uint8* GetFrameData(const int32 Frame, SIZE_T& OutNumBytes) const;
+
+	int32 RowsPerFrame;
+	int32 Height;
+	int32 Width;
+
+	// Only one of them is allocated, depending on Precision
+	TArray<FLowPrecision::ColorType> LowPrecisionPixels;
+	TArray<FHighPrecision::ColorType> HighPrecisionPixels;
+	TArray<FHalfPrecision::ColorType> HalfPrecisionPixels;
+};
+
+/* Smallest-three Quaternion: the largest component is dropped and rebuilt from the others (sign is flipped so it is positive).
+*  The other three are in [-1/sqrt(2), 1/sqrt(2)] and stored with 10 bits each, the dropped index with 2 bits.
+*  Bits are laid out R[0-7] G[8-15] B[16-23] A[24-31], so the shader can extract them from the 8 bits channels. */
+FColor EncodeQuaternion(const FQuat4f& Quat);
+FQuat4f DecodeQuaternion(const FColor& Color);
+
+/** Dual Quaternion of a Bone relative to its RefPose: v' = R * (v - RefPosition) + RefPosition + Delta.
+*   Real and Dual parts are (X, Y, Z, W), Real.W is positive. */
+void BoneToDualQuaternion(const FVector3f& RefPosition, const FVector3f& Delta, const FVector4f& AxisAndAngle, FVector4f& OutReal, FVector4f& OutDual);
+
+/* Transforms Position as the Material does, blended Dual Quaternions are normalized first */
+FVector3f TransformByDualQuaternion(const FVector4f& Real, const FVector4f& Dual, const FVector3f& Position);
+
+/* Texels in [0-1]: Real * 0.5 + 0.5, Dual / (2 * DualScale) + 0.5 */
+void EncodeDualQuaternion(const FVector4f& Real, const FVector4f& Dual, const float DualScale, FVector4f& OutRealTexel, FVector4f& OutDualTexel);
+void DecodeDualQuaternion(const FVector4f& RealTexel, const FVector4f& DualTexel, const float DualScale, FVector4f& OutReal, FVector4f& OutDual);
+
+/** Stores each distinct frame once.
+*   Every frame is written at the next free texture frame (GetNextTextureFrame) of all Writers, then committed:
+*   if the same texels are already stored, the frame is remapped to them and its texture frame is reused. */
+class FTextureFrameDeduplicator
+{
+public:
+	FTextureFrameDeduplicator(TArray<const FVectorTextureWriter*> InWriters, const int32 NumFrames);
+
+	int32 GetNextTextureFrame() const { return NumUniqueFrames; }
+
+	void CommitFrame(const int32 Frame);
+
+	int32 GetNumUniqueFrames() const { return NumUniqueFrames; }
+
+	/* Animation Frame -> Texture Frame */
+	TArray<int32>& GetFrameRemap() { return FrameRemap; }
+
+private:
+	TArray<const FVectorTextureWriter*> Writers;
+	TMultiMap<uint32, int32> HashToTextureFrame;
+	TArray<int32> FrameRemap;
+	int32 NumUniqueFrames = 0;
+};
+
 /* Decomposes Transform in Translation and AxisAndAngle */
 void DecomposeTransformation(const FTransform& Transform, FVector3f& OutTranslation, FVector4f& OutRotation);
 void DecomposeTransformations(const TArray<FTransform>& Transforms, TArray<FVector3f>& OutTranslations, TArray<FVector4f>& OutRotations);
 
-bool WriteSkinWeightsToTexture(const TArray<VertexSkinWeightFour>& SkinWeights, const int32 RowsPerFrame, const int32 Height, const int32 Width, UTexture2D* Texture);
-
 } // end namespace AnimToTexture_Private
 
 // ----------------------------------------------------------------------------
@@ -118,40 +231,53 @@ FORCEINLINE void AnimToTexture_Private::VectorToColor(const FVector4f& Vector, F
 	Color.W = FMath::RoundToInt(FMath::Clamp(Vector.W, 0.f, 1.f) * TNumericLimits<uint16>::Max());
 }
 
-template<class V, class TextureSettings>
-FORCEINLINE_DEBUGGABLE bool AnimToTexture_Private::WriteVectorsToTexture(const TArray<V>& Vectors,
-	const int32 NumFrames, const int32 RowsPerFrame,
-	const int32 Height, const int32 Width, UTexture2D* Texture)
+// HalfPrecision
+template<>
+FORCEINLINE void AnimToTexture_Private::VectorToColor(const FVector3f& Vector, FFloat16Color& Color)
 {
-	if (!Texture || !NumFrames)
-	{
-		return false;
-	}
+	Color.R = Vector.X;
+	Color.G = Vector.Y;
+	Color.B = Vector.Z;
+	Color.A = 1.f;
+}
 
-	// NumElements Per-Frame
-	const int32 NumElements = Vectors.Num() / NumFrames;
+// HalfPrecision
+template<>
+FORCEINLINE void AnimToTexture_Private::VectorToColor(const FVector4f& Vector, FFloat16Color& Color)
+{
+	Color.R = Vector.X;
+	Color.G = Vector.Y;
+	Color.B = Vector.Z;
+	Color.A = Vector.W;
+}
 
-	// Allocate PixelData.
-	TArray<typename TextureSettings::ColorType> Pixels;
-	Pixels.Init(TextureSettings::DefaultColor, Height * Width);
+template<class V>
+FORCEINLINE_DEBUGGABLE void AnimToTexture_Private::FVectorTextureWriter::WriteFrame(const int32 Frame, const TArray<V>& Vectors)
+{
+	const int32 BlockStart = RowsPerFrame * Width * Frame;
+	check(BlockStart + Vectors.Num() <= Height * Width);
 
-	// Fillout Frame Data
-	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	if (HighPrecisionPixels.Num())
 	{
-		const int32 BlockStart = RowsPerFrame * Width * Frame;
-
-		// Set Data.
-		for (int32 Index = 0; Index < NumElements; Index++)
+		for (int32 Index = 0; Index < Vectors.Num(); Index++)
 		{
-			const V& Vector = Vectors[NumElements * Frame + Index];
-			typename TextureSettings::ColorType& Pixel = Pixels[BlockStart + Index];
-
-			VectorToColor<V, typename TextureSettings::ColorType>(Vector, Pixel);
+			VectorToColor<V, FHighPrecision::ColorType>(Vectors[Index], HighPrecisionPixels[BlockStart + Index]);
+		}
+	}
+	else if (HalfPrecisionPixels.Num())
+	{
+		for (int32 Index = 0; Index < Vectors.Num(); Index++)
+		{
+			VectorToColor<V, FHalfPrecision::ColorType>(Vectors[Index], HalfPrecisionPixels[BlockStart + Index]);
+		}
+	}
+	else
+	{
+		for (int32 Index = 0; Index < Vectors.Num(); Index++)
+		{
+			VectorToColor<V, FLowPrecision::ColorType>(Vectors[Index], LowPrecisionPixels[BlockStart + Index]);
 		}
 	}
-
-	// Write to Texture
-	return WriteToTexture<TextureSettings>(Texture, Height, Width, Pixels);
 }
 
 
@@ -229,3 +355,30 @@ FORCEINLINE_DEBUGGABLE bool AnimToTexture_Private::WriteToTexture(
 
 	return true;
 }
+
+
+template<class TextureSettings>
+FORCEINLINE_DEBUGGABLE bool AnimToTexture_Private::WriteToTextureArray(
+	UTexture2DArray* Texture,
+	const uint32 SliceHeight, const uint32 Width, const uint32 NumSlices,
+	const TArray<typename TextureSettings::ColorType>& Pixels)
+{
+	check(Texture);
+	check(Pixels.Num() >= static_cast<int32>(SliceHeight * Width * NumSlices));
+
+	Texture->PreEditChange(nullptr);
+
+	// PlatformData is built from Source
+	Texture->Source.Init(Width, SliceHeight, NumSlices, 1, TextureSettings::TextureSourceFormat, reinterpret_cast<const uint8*>(Pixels.GetData()));
+
+	// Set parameters
+	Texture->SRGB = 0;
+	Texture->Filter = TextureFilter::TF_Nearest;
+	Texture->CompressionSettings = TextureSettings::CompressionSettings;
+	Texture->MipGenSettings = TextureMipGenSettings::TMGS_NoMipmaps;
+
+	// Update and Mark to Save.
+	Texture->PostEditChange();
+
+	return true;
+}
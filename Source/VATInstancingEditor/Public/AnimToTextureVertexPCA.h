@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "MyAnimToTextureDataAsset.h"
+
+namespace AnimToTexture_Private
+{
+
+/** Vertex animation compressed with Principal Component Analysis (bCompressVertexFrames):
+*   Delta(Frame)  = Sum_k PositionBasis[k] * Coefficients[Frame][k].X
+*   Normal(Frame) = normalize(Sum_k NormalBasis[k] * Coefficients[Frame][k].Y)
+*   Basis 0 is the mean of all frames (constant coefficients), the others are the principal components of the Deltas.
+*   Normal Basis are the least squares fit of the Normals to the same coefficients.
+*   Every Basis is scaled to [-1, 1], its scale is folded into the Coefficients. */
+class FVertexPCA
+{
+public:
+	/** Compresses the frames of InOutDeltas and Normals (NumVertices per frame) with the fewest components, up to MaxComponents,
+	*   whose max position error, decoded from the texels of PositionPrecision, is under ErrorBudget (centimetres).
+	*   Basis and Coefficients are quantized, InOutDeltas is overwritten with the residuals of the decoded frames.
+	*   Returns false if MaxComponents are not enough to meet ErrorBudget, all of them are kept then. */
+	bool Compress(TArray<FVector3f>& InOutDeltas, const TArray<FVector3f>& Normals, const int32 InNumVertices, const int32 MaxComponents, const float ErrorBudget,
+		const EAnim2TexturePrecision PositionPrecision, const EAnim2TexturePrecision NormalPrecision);
+
+	void ReconstructFrame(const int32 Frame, TArray<FVector3f>& OutDeltas, TArray<FVector3f>& OutNormals) const;
+
+	int32 GetNumBasis() const { return NumBasis; }
+	int32 GetNumFrames() const { return NumFrames; }
+
+	/* Max position error of the frames decoded from the quantized texels */
+	float GetMaxError() const { return MaxError; }
+
+	/* Texels in [0-1] of a Basis, one per vertex: Basis * 0.5 + 0.5 */
+	void GetPositionBasisTexels(const int32 Basis, TArray<FVector3f>& OutTexels) const;
+	void GetNormalBasisTexels(const int32 Basis, TArray<FVector3f>& OutTexels) const;
+
+	/* Coefficients of Frame (HalfFloat), two Basis per texel: Position and Normal coefficients of Basis 2i in RG, of Basis 2i + 1 in BA */
+	void GetCoefficientTexels(const int32 Frame, TArray<FVector4f>& OutTexels) const;
+
+	/* Texels of the Coefficients of a frame */
+	static int32 GetNumCoefficientTexels(const int32 InNumBasis) { return FMath::DivideAndRoundUp(InNumBasis, 2); }
+
+private:
+	/* Max position error of the current Position Basis once quantized. Residuals are those of the unquantized Basis */
+	float GetQuantizedMaxError(const TArray<FVector3f>& Residuals, const EAnim2TexturePrecision PositionPrecision) const;
+
+	/* Rounds Basis and Coefficients to the texels of the textures. InOutResiduals get the added error */
+	void Quantize(const EAnim2TexturePrecision PositionPrecision, const EAnim2TexturePrecision NormalPrecision, TArray<FVector3f>& InOutResiduals);
+
+	int32 NumVertices = 0;
+	int32 NumFrames = 0;
+	int32 NumBasis = 0;
+	float MaxError = 0.f;
+
+	// NumBasis * NumVertices
+	TArray<FVector3f> PositionBasis;
+	TArray<FVector3f> NormalBasis;
+
+	// NumFrames * NumBasis: X Position, Y Normal
+	TArray<FVector2f> Coefficients;
+};
+
+} // end namespace AnimToTexture_Private
@@ -1,22 +1,46 @@
 ﻿#pragma once
 
 #include "CoreMinimal.h"
+#include "AnimToTextureSkeletalMesh.h"
 
 namespace AnimToTexture_Private
 {
 	class FSourceMeshToDriverMesh;
+	class FMorphTargetDeltas;
+	class FAnimationBoundsBuilder;
+	class FPositionQuantizer;
+	class FQuantizationErrorAnalyzer;
+	struct FTextureEncoding;
 }
 
 struct FAnim2TextureAnimSequenceInfo;
 class UMyAnimToTextureDataAsset;
+class UTexture2D;
+class UTexture2DArray;
+class USkeletalMeshComponent;
+class AActor;
 
 bool FindBestResolution(const int32 NumFrames, const int32 NumElements, int32& OutHeight, int32& OutWidth, int32& OutRowsPerFrame, const int32 MaxHeight, const int32 MaxWidth);
 
+// Packs animations in texture slices of the same height, an animation is never split between slices.
+// Minimizes the total number of frames (including padding and ExtraFramesPerSlice) of all slices.
+// Returns false if an animation is longer than MaxSliceFrames
+bool PackAnimationsInSlices(const TArray<int32>& NumAnimFrames, const int32 MaxSliceFrames, const int32 ExtraFramesPerSlice,
+							TArray<int32>& OutAnimSlices, TArray<int32>& OutAnimSliceStartFrames, int32& OutNumSlices, int32& OutNumSliceFrames);
+
 
 
 // Returns Start, EndFrame and NumFrames in Animation
 int32 GetAnimationFrameRange(const FAnim2TextureAnimSequenceInfo& Animation, int32& OutStartFrame, int32& OutEndFrame);
 
+// Returns Number of Frames baked from Animation Range at SampleRate, and the time of the first one
+int32 GetAnimationNumSamples(const FAnim2TextureAnimSequenceInfo& Animation, const float SampleRate, float& OutStartTime);
+
+// Root motion of every sample relative to the first one (XYZ translation and W yaw in degrees), in RootTransform space.
+// Empty if the AnimSequence has no root motion
+void GetAnimationRootMotion(const FAnim2TextureAnimSequenceInfo& Animation, const int32 NumSamples, const float SampleRate, const float StartTime,
+							const FTransform& RootTransform, TArray<FVector4f>& OutRootMotion);
+
 // Get Vertex and Normals from Current Pose
 // The VertexDelta is returned from the RefPose
 void GetVertexDeltasAndNormals(const USkeletalMeshComponent* SkeletalMeshComponent,
@@ -30,31 +54,174 @@ void SetFullPrecisionUVs(UStaticMesh* StaticMesh, const int32 LODIndex, bool bFu
 
 void SetBoundsExtensions(UStaticMesh* StaticMesh, const FVector& MinBBox, const FVector& SizeBBox);
 
-// Normalizes Deltas and Normals between [0-1] with Bounding Box
-void NormalizeVertexData(const TArray<FVector3f>& Deltas, const TArray<FVector3f>& Normals, FVector3f& OutMinBBox, FVector3f& OutSizeBBox, TArray<FVector3f>& OutNormalizedDeltas, TArray<FVector3f>& OutNormalizedNormals);
+// Grows Bounding Box so it contains all Values
+void AccumulateBoundingBox(const TArray<FVector3f>& Values, FVector3f& InOutMinBBox, FVector3f& InOutMaxBBox);
+
+// Grows per-Element (Bone or Vertex) Bounding Boxes. Values holds one entry per Element
+void AccumulateElementBoundingBoxes(const TArray<FVector3f>& Values, TArray<FVector3f>& InOutMinBBoxes, TArray<FVector3f>& InOutMaxBBoxes);
+
+// Quantizes per-Element Bounding Boxes relative to the global Bounding Box, rounding outwards so they still contain all values.
+// OutNormalizedMins/Sizes are written to the lookup frames, OutMins/Sizes are the matching ranges used for normalizing
+void QuantizeElementRanges(const TArray<FVector3f>& MinBBoxes, const TArray<FVector3f>& MaxBBoxes, const FVector3f& MinBBox, const FVector3f& SizeBBox, const float QuantizationSteps,
+						   TArray<FVector3f>& OutNormalizedMins, TArray<FVector3f>& OutNormalizedSizes, TArray<FVector3f>& OutMins, TArray<FVector3f>& OutSizes);
+
+// Normalizes Values between [0-1] with per-Element Ranges
+void NormalizeToElementRanges(const TArray<FVector3f>& Values, const TArray<FVector3f>& Mins, const TArray<FVector3f>& Sizes, TArray<FVector3f>& OutNormalizedValues);
+
+// Normalizes a single frame of Deltas and Normals between [0-1] with a precomputed Bounding Box
+void NormalizeVertexFrame(const TArray<FVector3f>& Deltas, const TArray<FVector3f>& Normals, const FVector3f& MinBBox, const FVector3f& SizeBBox, TArray<FVector3f>& OutNormalizedDeltas, TArray<FVector3f>& OutNormalizedNormals);
+
+// Normalizes a single frame of Positions and Rotations between [0-1] with a precomputed Bounding Box
+void NormalizeBoneFrame(const TArray<FVector3f>& Positions, const TArray<FVector4f>& Rotations, const FVector3f& MinBBox, const FVector3f& SizeBBox, TArray<FVector3f>& OutNormalizedPositions, TArray<FVector4f>& OutNormalizedRotations);
+
+// Number of Skin Weight influences sampled by the Material
+int32 GetNumBoneInfluences(const UMyAnimToTextureDataAsset* DataAsset);
+
+// Raw Bones weighted by the first NumInfluences Skin Weights, plus the Bones of BoneOrSocketsOfInterest. Sorted
+void GetInfluencingBones(const UMyAnimToTextureDataAsset* DataAsset, const TArray<AnimToTexture_Private::TVertexSkinWeight<4>>& SkinWeights, const int32 NumInfluences, TArray<int32>& OutBones);
+
+// Keeps the Raw Bones of BakedBones, in order
+void CompactBoneFrame(const TArray<int32>& BakedBones, TArray<FVector3f>& InOutPositions, TArray<FVector4f>& InOutRotations);
+
+// Remaps the Raw Bone indices of SkinWeights to Bone Texture columns (indices in BakedBones).
+// Returns false if a weighted Bone is not baked, OutMissingBone is its Raw index
+bool RemapSkinWeightsToBakedBones(const TArray<int32>& BakedBones, const int32 NumInfluences, TArray<AnimToTexture_Private::TVertexSkinWeight<4>>& InOutSkinWeights, int32& OutMissingBone);
+
+// Encodes AxisAndAngle Rotations as packed Quaternions.
+// Returns the max round-trip angular error in radians
+float EncodeBoneRotations(const TArray<FVector4f>& Rotations, TArray<FColor>& OutEncodedRotations);
+
+// Largest absolute Dual part component of the Bone Dual Quaternions of a frame, the range of the Dual texels
+float GetMaxDualQuaternionComponent(const TArray<FVector3f>& RefPositions, const TArray<FVector3f>& Positions, const TArray<FVector4f>& Rotations);
 
-// Normalizes Positions and Rotations between [0-1] with Bounding Box
-void NormalizeBoneData(const TArray<FVector3f>& Positions, const TArray<FVector4f>& Rotations, FVector3f& OutMinBBox, FVector3f& OutSizeBBox, TArray<FVector3f>& OutNormalizedPositions, TArray<FVector4f>& OutNormalizedRotations);
+// Encodes a frame of Bone Positions (relative to RefPose) and AxisAndAngle Rotations as Dual Quaternion texels in [0-1].
+// Every Bone writes two consecutive texels: Real, Dual
+void EncodeDualQuaternionFrame(const TArray<FVector3f>& RefPositions, const TArray<FVector3f>& Positions, const TArray<FVector4f>& Rotations, const float DualScale,
+							   TArray<FVector4f>& OutTexels);
 
 // Runs some validations for the assets in DataAsset
 // Returns false if there is any problems with the data, warnings will be printed in Log
 bool CheckDataAsset(const UMyAnimToTextureDataAsset* DataAsset, int32& OutSocketIndex);
 
+// Checks that the AnimationLibrary of DataAsset is baked and its Bones match the DataAsset SkeletalMesh
+bool CheckAnimationLibrary(const UMyAnimToTextureDataAsset* DataAsset);
+
+// Copies AnimSequences, Bone Texture settings and GeneratedInfo from the AnimationLibrary of DataAsset
+void CopyAnimationLibrary(UMyAnimToTextureDataAsset* DataAsset);
+
+// Finds or creates the Texture2D asset holding a slice of TextureArray, named <TextureArray>_Page<Page> next to it
+UTexture2D* FindOrCreateTexturePage(const UTexture2DArray* TextureArray, const int32 Page);
+
 	// Gets RefPose Bone Position and Rotations.
 int32 GetRefBonePositionsAndRotations(const USkeletalMesh* SkeletalMesh, TArray<FVector3f>& OutBoneRefPositions, TArray<FVector4f>& OutBoneRefRotations);
 
 	// Gets Bone Position and Rotations for Current Pose.
 // The BonePosition is returned relative to the RefPose
+// Component Space Transforms of the BoneOrSocketsOfInterest (one frame, by interest list id) are written to FrameInterestTransforms
 int32 GetBonePositionsAndRotations(const USkeletalMeshComponent* SkeletalMeshComponent,
 										  const TArray<FVector3f>& BoneRefPositions,
 										  TArray<FVector3f>& BonePositions,
 										  TArray<FVector4f>& BoneRotations,
-										  int32 SampleIndex,
-										  FAnim2TextureAnimSequenceInfo& SeqInfo,
-										  int32 Offset,
-										  TMap<int32, int32> BoneId2InterestListIdThisAnim,
-										  TMap<FName, int32> SocketName2InterestListIdThisAnim);
+										  TArrayView<FTransform> FrameInterestTransforms,
+										  const TMap<int32, int32>& BoneId2InterestListIdThisAnim,
+										  const TMap<FName, int32>& SocketName2InterestListIdThisAnim);
 
 
 /* 利用UV channel储存VertexId->TextureSampleUV的映射关系 */
 bool WriteVtxIdToNewUvChannel(UStaticMesh* StaticMesh, const int32 LODIndex, const int32 UVChannelIndex, const int32 Height, const int32 Width);
+
+/* UV.x = (Slot + 0.5) / NumMorphVertices of every vertex with a Morph slot, -1 for the others */
+bool WriteMorphSlotsToUvChannel(UStaticMesh* StaticMesh, const int32 LODIndex, const int32 UVChannelIndex, const TArray<int32>& VertexSlots, const int32 NumMorphVertices);
+
+// ---------------------------------------------------------------------------
+// Passes of a full bake (UVATInstancingBPLibrary::AnimationToTexture):
+// FindBakeResolution, Bounding Boxes gathered with FAnimationFrameSampler, SelectEncodingFromErrorBudget, then the writer of the Mode
+//
+
+/* Poses a temporary SkeletalMeshComponent at every baked frame of the AnimSequences of DataAsset. The frame ranges of the Animations must be known */
+class FAnimationFrameSampler
+{
+public:
+	UE_NONCOPYABLE(FAnimationFrameSampler);
+
+	explicit FAnimationFrameSampler(const UMyAnimToTextureDataAsset* InDataAsset);
+	~FAnimationFrameSampler();
+
+	USkeletalMeshComponent* GetSkeletalMeshComponent() const { return SkeletalMeshComponent; }
+
+	/* Evaluates the pose of every baked frame, in texture row order.
+	*  Every pass samples all animations again, this way only a single frame of vertex data is alive at a time */
+	void ForEachFrame(const FText& PassName, TFunctionRef<void(int32 AnimSequenceIndex, int32 SampleIndex, int32 Frame)> FrameFunc) const;
+
+private:
+	const UMyAnimToTextureDataAsset* DataAsset = nullptr;
+	AActor* Actor = nullptr;
+	USkeletalMeshComponent* SkeletalMeshComponent = nullptr;
+};
+
+/* State of a full bake, shared by its passes */
+struct FAnimToTextureBake
+{
+	UMyAnimToTextureDataAsset* DataAsset = nullptr;
+	const AnimToTexture_Private::FSourceMeshToDriverMesh* Mapping = nullptr;
+	int32 NumVertices = 0;
+
+	// Resolution of the Vertex or Bone Textures
+	int32 Height = 0;
+	int32 Width = 0;
+
+	// StaticMesh vertices. Bone Mode: their Skin Weights, remapped to the baked Bones
+	TArray<FVector3f> SourceVertices;
+	TArray<AnimToTexture_Private::VertexSkinWeightFour> SkinWeights;
+	int32 NumInfluences = 0;
+
+	// RefPose of all Raw Bones (they are all sampled), and of the Bones in the Bone Textures
+	TArray<FVector3f> BoneRefPositions;
+	TArray<FVector3f> BakedBoneRefPositions;
+	TArray<FVector4f> BakedBoneRefRotations;
+
+	// Bounding Box of the Vertex Deltas or Bone Positions, and per Bone or Vertex (only gathered when PerElement ranges may be baked)
+	FVector3f MinBBox = FVector3f(TNumericLimits<float>::Max());
+	FVector3f MaxBBox = FVector3f(TNumericLimits<float>::Lowest());
+	TArray<FVector3f> ElementMinBBoxes;
+	TArray<FVector3f> ElementMaxBBoxes;
+
+	// PerElement ranges quantized by QuantizeRanges: written to the lookup frames, and used for normalizing
+	TArray<FVector3f> ElementRangeLookupMins;
+	TArray<FVector3f> ElementRangeLookupSizes;
+	TArray<FVector3f> ElementRangeMins;
+	TArray<FVector3f> ElementRangeSizes;
+
+	bool IsBoneMode() const { return DataAsset->Mode == EAnim2TextureMode::Bone; }
+	bool IsDualQuaternion() const { return IsBoneMode() && DataAsset->RotationFormat == EAnim2TextureRotationFormat::DualQuaternion; }
+	bool HasPerElementRanges() const { return DataAsset->PositionRangeMode == EAnim2TextureRangeMode::PerElement; }
+
+	/* Quantizes the PerElement ranges relative to the Bounding Box, with the PositionPrecision of DataAsset. Nothing for Global ranges */
+	void QuantizeRanges();
+
+	AnimToTexture_Private::FPositionQuantizer MakeQuantizer(const AnimToTexture_Private::FTextureEncoding& Encoding) const;
+
+	/* Bone Mode skins SourceVertices, which must outlive the analyzer */
+	AnimToTexture_Private::FQuantizationErrorAnalyzer MakeErrorAnalyzer(const AnimToTexture_Private::FTextureEncoding& Encoding) const;
+};
+
+/* Resolution of the Vertex or Bone Textures of DataAsset, Texture Arrays also pack the animations in slices.
+*  Returns false if the frames do not fit in MaxHeight x MaxWidth */
+bool FindBakeResolution(FAnimToTextureBake& Bake);
+
+/* Measures the candidate encodings and applies the cheapest one under the PositionErrorBudget of DataAsset, or the most accurate one.
+*  Global ranges drop the lookup frames reserved for PerElement ranges */
+void SelectEncodingFromErrorBudget(FAnimToTextureBake& Bake, const FAnimationFrameSampler& Sampler);
+
+/* Vertex Mode with bCompressVertexFrames: PCA basis in the Position and Normal Textures, one row of Coefficients per frame.
+*  Returns false if the data does not fit in MaxHeight. OutPeakMemory: buffers allocated by the writer */
+bool WriteCompressedVertexTextures(FAnimToTextureBake& Bake, const FAnimationFrameSampler& Sampler, AnimToTexture_Private::FQuantizationErrorAnalyzer& ErrorAnalyzer, SIZE_T& OutPeakMemory);
+
+/* Vertex Mode: Deltas and Normals of every frame */
+bool WriteVertexTextures(FAnimToTextureBake& Bake, const FAnimationFrameSampler& Sampler, AnimToTexture_Private::FQuantizationErrorAnalyzer& ErrorAnalyzer, SIZE_T& OutPeakMemory);
+
+/* Bone Mode: Bone frames in the RotationFormat of DataAsset, followed by the RefPose and lookup frames of every slice.
+*  MorphTargetDeltas (MorphHeight x MorphWidth texels) is null when no Morph Target deltas are baked */
+bool WriteBoneTextures(FAnimToTextureBake& Bake, const FAnimationFrameSampler& Sampler, AnimToTexture_Private::FQuantizationErrorAnalyzer& ErrorAnalyzer,
+					   const AnimToTexture_Private::FMorphTargetDeltas* MorphTargetDeltas, const int32 MorphHeight, const int32 MorphWidth,
+					   AnimToTexture_Private::FAnimationBoundsBuilder& BoundsBuilder, SIZE_T& OutPeakMemory);
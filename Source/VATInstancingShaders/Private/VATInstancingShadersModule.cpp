@@ -0,0 +1,21 @@
+﻿#include "VATInstancingShadersModule.h"
+
+#include "Interfaces/IPluginManager.h"
+#include "Misc/Paths.h"
+#include "ShaderCore.h"
+
+void FVATInstancingShadersModule::StartupModule()
+{
+	const TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("VATInstancing"));
+	check(Plugin.IsValid());
+
+	// Custom nodes include "/Plugin/VATInstancing/Private/VATDualQuaternion.ush"
+	const FString ShaderDirectory = FPaths::Combine(Plugin->GetBaseDir(), TEXT("Shaders"));
+	AddShaderSourceDirectoryMapping(TEXT("/Plugin/VATInstancing"), ShaderDirectory);
+}
+
+void FVATInstancingShadersModule::ShutdownModule()
+{
+}
+
+IMPLEMENT_MODULE(FVATInstancingShadersModule, VATInstancingShaders)
\ No newline at end of file
@@ -0,0 +1,15 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Modules/ModuleManager.h"
+
+// Maps the Shaders folder of the plugin to /Plugin/VATInstancing, so Materials can include its .ush files.
+// Shader directories must be mapped before the shaders compile, this module is loaded at PostConfigInit.
+class FVATInstancingShadersModule : public IModuleInterface
+{
+public:
+	/** IModuleInterface implementation */
+	virtual void StartupModule() override;
+	virtual void ShutdownModule() override;
+};
\ No newline at end of file
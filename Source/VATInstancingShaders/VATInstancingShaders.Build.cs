@@ -0,0 +1,25 @@
+﻿using UnrealBuildTool;
+
+public class VATInstancingShaders : ModuleRules
+{
+    public VATInstancingShaders(ReadOnlyTargetRules Target) : base(Target)
+    {
+        PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+
+        PublicDependencyModuleNames.AddRange(
+            new string[]
+            {
+                "Core",
+            }
+            );
+
+
+        PrivateDependencyModuleNames.AddRange(
+            new string[]
+            {
+                "Projects",
+                "RenderCore",
+			}
+            );
+    }
+}
\ No newline at end of file